@@ -0,0 +1,52 @@
+/*
+ * File:   crio_batch_receiver.h
+ *
+ * Receives cRIO UDP packets in batches: one recvmmsg() call drains up to BATCH_SIZE queued packets into a
+ * preallocated ring of CRIOCommand buffers, and each packet carries the kernel's receive timestamp
+ * (SO_TIMESTAMPNS), so its stamp does not depend on when it is handled. Linux only.
+ */
+
+#ifndef _CRIO_BATCH_RECEIVER_H
+#define	_CRIO_BATCH_RECEIVER_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+#include <cwru_base/packets.h>
+
+namespace cwru_base {
+  class CrioBatchReceiver {
+    public:
+      static const int BATCH_SIZE = 64;
+
+      /* binds a UDP socket on port (all interfaces); rcvbuf_bytes sizes the kernel queue for bursts */
+      CrioBatchReceiver(int port, int rcvbuf_bytes = 1 << 20);
+      ~CrioBatchReceiver();
+      bool isOpen() const { return fd_ >= 0; }
+
+      /*
+       * waits up to timeout_sec for packets, then takes all that are queued (up to BATCH_SIZE).
+       * returns the number of packets received, 0 on timeout or -1 on a socket error (see errno).
+       * packets, lengths and stamps are valid until the next call
+       */
+      int receive(double timeout_sec);
+      CRIOCommand& packet(int i) { return packets_[i]; }
+      unsigned int length(int i) const { return msgs_[i].msg_len; }
+      /* kernel receive time (CLOCK_REALTIME); the time of the receive() call if the kernel gave none */
+      const struct timespec& stamp(int i) const { return stamps_[i]; }
+      /* number of recvmmsg() calls that returned packets, for throughput statistics */
+      unsigned long numBatches() const { return num_batches_; }
+
+    private:
+      int fd_;
+      unsigned long num_batches_;
+      std::vector<CRIOCommand> packets_;
+      std::vector<struct mmsghdr> msgs_;
+      std::vector<struct iovec> iovecs_;
+      std::vector<char> control_;
+      std::vector<struct timespec> stamps_;
+  };
+};
+#endif	/* _CRIO_BATCH_RECEIVER_H */
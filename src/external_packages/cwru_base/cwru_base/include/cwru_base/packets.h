@@ -8,6 +8,10 @@
 #ifndef _PACKETS_H
 #define	_PACKETS_H
 
+#include <stdint.h>
+#include <stddef.h>
+#include <endian.h>
+
 namespace cwru_base {
 	const int BUF_SIZE = 1024;
 
@@ -110,6 +114,55 @@ namespace cwru_base {
 		char commandData[BUF_SIZE - sizeof(int8_t)];
 	} CRIOCommand;
 
+	/*
+	 * The cRIO sends all fields big-endian. These convert a received packet to host order in place, so
+	 * a packet is decoded in the buffer it was received into, with no copies. Runs of 32-bit fields are
+	 * swapped as one array, in a loop the compiler can vectorize.
+	 */
+	inline void swapWords32(void* words, int nwords) {
+		uint32_t* w = (uint32_t*) words;
+		for (int i = 0; i < nwords; i++) {
+			w[i] = be32toh(w[i]);
+		}
+	}
+
+	inline void swapWords64(void* words, int nwords) {
+		uint64_t* w = (uint64_t*) words;
+		for (int i = 0; i < nwords; i++) {
+			w[i] = be64toh(w[i]);
+		}
+	}
+
+	inline void swapPosePacketInPlace(CRIOPosePacket& packet) {
+		/* x through sonar_ping_5 are contiguous floats */
+		swapWords32(&packet.x, (sizeof(CRIOPosePacket) - offsetof(CRIOPosePacket, x)) / sizeof(uint32_t));
+	}
+
+	inline void swapDiagnosticsPacketInPlace(CRIODiagnosticsPacket& packet) {
+		packet.FPGAVersion = be16toh(packet.FPGAVersion);
+		packet.VMonitor_cRIO_mV = be16toh(packet.VMonitor_cRIO_mV);
+		/* wheel and motor ticks */
+		swapWords32(&packet.LWheelTicks, 4);
+		packet.VMonitor_24V_mV = be16toh(packet.VMonitor_24V_mV);
+		packet.VMonitor_13V_mV = be16toh(packet.VMonitor_13V_mV);
+		packet.VMonitor_5V_mV = be16toh(packet.VMonitor_5V_mV);
+		packet.VMonitor_eStop_mV = be16toh(packet.VMonitor_eStop_mV);
+		packet.YawRate_mV = be16toh(packet.YawRate_mV);
+		packet.YawSwing_mV = be16toh(packet.YawSwing_mV);
+		packet.YawTemp_mV = be16toh(packet.YawTemp_mV);
+		packet.YawRef_mV = be16toh(packet.YawRef_mV);
+		packet.C1Steering = be16toh(packet.C1Steering);
+		packet.C2Throttle = be16toh(packet.C2Throttle);
+		packet.C3Mode = be16toh(packet.C3Mode);
+	}
+
+	inline void swapGPSPacketInPlace(CRIOGPSPacket& packet) {
+		/* latitude, longitude */
+		swapWords64(&packet.latitude, 2);
+		/* lat_std_dev through solution_age are contiguous 32-bit fields */
+		swapWords32(&packet.lat_std_dev, 6);
+	}
+
 };
 #endif	/* _PACKETS_H */
 
@@ -0,0 +1,86 @@
+/* Batched UDP receive of cRIO packets; see crio_batch_receiver.h */
+
+#include <cwru_base/crio_batch_receiver.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+
+namespace cwru_base {
+  static const size_t CONTROL_LEN = CMSG_SPACE(sizeof(struct timespec));
+
+  CrioBatchReceiver::CrioBatchReceiver(int port, int rcvbuf_bytes) :
+    num_batches_(0),
+    packets_(BATCH_SIZE),
+    msgs_(BATCH_SIZE),
+    iovecs_(BATCH_SIZE),
+    control_(BATCH_SIZE * CONTROL_LEN),
+    stamps_(BATCH_SIZE)
+  {
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0) {
+      return;
+    }
+    int on = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf_bytes, sizeof(rcvbuf_bytes));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd_, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+      int bind_errno = errno;
+      close(fd_);
+      fd_ = -1;
+      errno = bind_errno;
+      return;
+    }
+    memset(&msgs_[0], 0, BATCH_SIZE * sizeof(struct mmsghdr));
+    for (int i = 0; i < BATCH_SIZE; i++) {
+      iovecs_[i].iov_base = &packets_[i];
+      iovecs_[i].iov_len = sizeof(CRIOCommand);
+      msgs_[i].msg_hdr.msg_iov = &iovecs_[i];
+      msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+  }
+
+  CrioBatchReceiver::~CrioBatchReceiver() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  int CrioBatchReceiver::receive(double timeout_sec) {
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    int ready = poll(&pfd, 1, (int) (timeout_sec * 1000.0));
+    if (ready <= 0) {
+      return (ready < 0 && errno != EINTR) ? -1 : 0;
+    }
+    for (int i = 0; i < BATCH_SIZE; i++) {
+      /* the kernel overwrites these on each call */
+      msgs_[i].msg_hdr.msg_control = &control_[i * CONTROL_LEN];
+      msgs_[i].msg_hdr.msg_controllen = CONTROL_LEN;
+    }
+    int npackets = recvmmsg(fd_, &msgs_[0], BATCH_SIZE, MSG_DONTWAIT, NULL);
+    if (npackets < 0) {
+      return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    num_batches_++;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    for (int i = 0; i < npackets; i++) {
+      stamps_[i] = now;
+      struct msghdr& hdr = msgs_[i].msg_hdr;
+      for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+          memcpy(&stamps_[i], CMSG_DATA(cmsg), sizeof(struct timespec));
+        }
+      }
+    }
+    return npackets;
+  }
+};
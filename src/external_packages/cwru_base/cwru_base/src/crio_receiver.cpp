@@ -15,14 +15,12 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <endian.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
 #include <ros/ros.h>
-#include <boost/array.hpp>
-#include <boost/asio.hpp>
-#include <boost/asio/deadline_timer.hpp>
-#include <boost/bind.hpp>
-#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <cwru_base/packets.h>
+#include <cwru_base/crio_batch_receiver.h>
 #include <cwru_msgs/Pose.h>
 #include <cwru_msgs/PowerState.h>
 #include <cwru_msgs/Sonar.h>
@@ -31,41 +29,34 @@
 #include <std_msgs/Bool.h>
 #include <diagnostic_updater/diagnostic_updater.h>
 #include <diagnostic_updater/publisher.h>
-
-using boost::asio::ip::udp;
-using boost::asio::deadline_timer;
+#include <ros/callback_queue.h>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace cwru_base {
   class CrioReceiver {
     public:
       CrioReceiver();
       ~CrioReceiver();
-      void dispatchReceivedPacket(CRIOCommand packet);
-      void handlePosePacket(CRIOPosePacket packet);
-      void handleDiagnosticsPacket(CRIODiagnosticsPacket packet);
-      void handleGPSPacket(CRIOGPSPacket packet);
-      void updateDiagnostics();
+      // packets are decoded in place, in the receive buffer; stamp is the kernel receive time
+      void dispatchReceivedPacket(CRIOCommand& packet, const ros::Time& stamp);
+      void handlePosePacket(CRIOPosePacket& packet, const ros::Time& stamp);
+      void handleDiagnosticsPacket(CRIODiagnosticsPacket& packet, const ros::Time& stamp);
+      void handleGPSPacket(CRIOGPSPacket& packet, const ros::Time& stamp);
     private:
-      CRIOPosePacket swapPosePacket(CRIOPosePacket& packet);
-      CRIODiagnosticsPacket swapDiagnosticsPacket(CRIODiagnosticsPacket& packet);
-      CRIOGPSPacket swapGPSPacket(CRIOGPSPacket& packet);
+      static const int NUM_SONARS = 5;
+      // runs on its own thread, at the diagnostic period, so packet handling never waits on it
+      void updateDiagnostics(const ros::TimerEvent& event);
       void checkEncoderTicks(diagnostic_updater::DiagnosticStatusWrapper &stat);
       void checkYawSensor(diagnostic_updater::DiagnosticStatusWrapper &stat);
       void checkVoltageLevels(diagnostic_updater::DiagnosticStatusWrapper &stat);
       void checkGPSValues(diagnostic_updater::DiagnosticStatusWrapper &stat);
-      void handleSonarPing(cwru_msgs::Sonar& ping, const float ping_value, const std::string frame_id, ros::Publisher& sonar_pub);
-      float swap_float(float in);
-      double swap_double(double in);
       void setupDiagnostics();
       ros::NodeHandle nh_;
       ros::NodeHandle priv_nh_;
       ros::Publisher estop_pub_;
       ros::Publisher flipped_pose_pub_;
-      ros::Publisher sonar1_pub_;
-      ros::Publisher sonar2_pub_;
-      ros::Publisher sonar3_pub_;
-      ros::Publisher sonar4_pub_;
-      ros::Publisher sonar5_pub_;
+      ros::Publisher sonar_pubs_[NUM_SONARS];
       ros::Publisher gps_pub_;
       ros::Publisher power_pub_;
       diagnostic_updater::Updater updater_;
@@ -75,9 +66,22 @@ namespace cwru_base {
       double lenc_high_warn_, lenc_low_warn_, lenc_high_err_, lenc_low_err_;
       double renc_high_warn_, renc_low_warn_, renc_high_err_, renc_low_err_;
       bool push_casters_;
+      // latest packets, read by the diagnostics thread; guarded by diagnostics_mutex_
+      boost::mutex diagnostics_mutex_;
       CRIODiagnosticsPacket diagnostics_info_;
       CRIOPosePacket pose_packet_;
       CRIOGPSPacket gps_packet_;
+      ros::CallbackQueue diagnostics_queue_;
+      ros::AsyncSpinner diagnostics_spinner_;
+      ros::Timer diagnostics_timer_;
+      // outgoing messages, preallocated: frame_ids and constant fields are set once, in the constructor,
+      // and each packet only overwrites the values
+      cwru_msgs::Pose pose_msg_, flipped_pose_msg_;
+      cwru_msgs::Sonar sonar_msgs_[NUM_SONARS];
+      std_msgs::Bool estop_msg_;
+      cwru_msgs::PowerState power_msg_;
+      cwru_msgs::cRIOSensors sensor_msg_;
+      cwru_msgs::NavSatFix fix_msg_;
   };
 
   CrioReceiver::CrioReceiver(): 
@@ -89,7 +93,8 @@ namespace cwru_base {
     sensor_pub_(nh_.advertise<cwru_msgs::cRIOSensors>("crio_sensors",1),
         updater_,
         diagnostic_updater::FrequencyStatusParam(&desired_pose_freq_, &desired_pose_freq_, 3.0, 5),
-        diagnostic_updater::TimeStampStatusParam())
+        diagnostic_updater::TimeStampStatusParam()),
+    diagnostics_spinner_(1, &diagnostics_queue_)
   {
     priv_nh_.param("expected_pose_freq", desired_pose_freq_, 50.0);
     priv_nh_.param("push_casters", push_casters_, false);
@@ -104,13 +109,25 @@ namespace cwru_base {
     encoders_nh_.param("renc_low_err", renc_low_err_, 14.);
     flipped_pose_pub_ = nh_.advertise<cwru_msgs::Pose>("flipped_pose",1);
     estop_pub_ = nh_.advertise<std_msgs::Bool>("motors_enabled",1,true);
-    sonar1_pub_ = nh_.advertise<cwru_msgs::Sonar>("sonar_1",1);
-    sonar2_pub_ = nh_.advertise<cwru_msgs::Sonar>("sonar_2",1);
-    sonar3_pub_ = nh_.advertise<cwru_msgs::Sonar>("sonar_3",1);
-    sonar4_pub_ = nh_.advertise<cwru_msgs::Sonar>("sonar_4",1);
-    sonar5_pub_ = nh_.advertise<cwru_msgs::Sonar>("sonar_5",1);
+    for (int i = 0; i < NUM_SONARS; i++) {
+      char name[16];
+      snprintf(name, sizeof(name), "sonar_%d", i + 1);
+      sonar_pubs_[i] = nh_.advertise<cwru_msgs::Sonar>(name,1);
+      sonar_msgs_[i].header.frame_id = std::string(name) + "_link";
+    }
     gps_pub_ = nh_.advertise<cwru_msgs::NavSatFix>("gps_fix",1);
     power_pub_ = nh_.advertise<cwru_msgs::PowerState>("power_state",1);
+
+    pose_msg_.header.frame_id = "crio";
+    flipped_pose_msg_.header.frame_id = "flipped_crio";
+    power_msg_.header.frame_id = "crio";
+    sensor_msg_.header.frame_id = "crio";
+    fix_msg_.header.frame_id = "crio_gps";
+    fix_msg_.status.service = cwru_msgs::NavSatStatus::SERVICE_GPS;
+    fix_msg_.position_covariance_type = cwru_msgs::NavSatFix::COVARIANCE_TYPE_DIAGONAL_KNOWN;
+    memset(&diagnostics_info_, 0, sizeof(diagnostics_info_));
+    memset(&pose_packet_, 0, sizeof(pose_packet_));
+    memset(&gps_packet_, 0, sizeof(gps_packet_));
     setupDiagnostics();
   }
 
@@ -121,10 +138,20 @@ namespace cwru_base {
     updater_.add("Yaw Sensor", this, &CrioReceiver::checkYawSensor);
     updater_.add("Voltages", this, &CrioReceiver::checkVoltageLevels);
     updater_.add("GPS", this, &CrioReceiver::checkGPSValues);
+
+    // diagnostics are published once per diagnostic_period, by a timer on a separate queue and thread,
+    // rather than the receive loop calling the updater after every packet
+    double diagnostic_period;
+    priv_nh_.param("diagnostic_period", diagnostic_period, 1.0);
+    ros::TimerOptions timer_options(ros::Duration(diagnostic_period),
+        boost::bind(&CrioReceiver::updateDiagnostics, this, _1), &diagnostics_queue_);
+    diagnostics_timer_ = nh_.createTimer(timer_options);
+    diagnostics_spinner_.start();
   }
 
-  void CrioReceiver::updateDiagnostics() {
-    updater_.update();
+  void CrioReceiver::updateDiagnostics(const ros::TimerEvent& event) {
+    boost::mutex::scoped_lock lock(diagnostics_mutex_);
+    updater_.force_update(); // the timer sets the rate
   }
   void CrioReceiver::checkYawSensor(diagnostic_updater::DiagnosticStatusWrapper &stat) {
     stat.add("Yaw Rate", diagnostics_info_.YawRate_mV / 1000.0); 
@@ -302,100 +329,35 @@ namespace cwru_base {
   }
 
   CrioReceiver::~CrioReceiver() {
+    diagnostics_timer_.stop();
+    diagnostics_spinner_.stop();
   }
 
-  void CrioReceiver::dispatchReceivedPacket(CRIOCommand packet) {
+  void CrioReceiver::dispatchReceivedPacket(CRIOCommand& packet, const ros::Time& stamp) {
     if (packet.type == POSE_t) {
-      handlePosePacket(*((CRIOPosePacket*) &packet));
+      handlePosePacket(*((CRIOPosePacket*) &packet), stamp);
     } else if (packet.type == DIAGNOSTICS_t) {
-      handleDiagnosticsPacket(*((CRIODiagnosticsPacket*) &packet));
+      handleDiagnosticsPacket(*((CRIODiagnosticsPacket*) &packet), stamp);
     } else if (packet.type == GPS_t) {
-      handleGPSPacket(*((CRIOGPSPacket*) &packet));
+      handleGPSPacket(*((CRIOGPSPacket*) &packet), stamp);
     } else {
       ROS_WARN("Unhandled packet type received: %d", packet.type);
     }	
   }
 
-  float CrioReceiver::swap_float(float in) {
-    uint32_t temp = *((uint32_t *)&in); 
-    temp = ntohl(temp);
-    return *((float *) &temp);
-  }
-
-  double CrioReceiver::swap_double(double in) {
-    uint64_t temp = *((uint64_t *)&in);
-    temp = be64toh(temp);
-    return *((double *) &temp);
-  }
-
-  CRIOPosePacket CrioReceiver::swapPosePacket(CRIOPosePacket& packet) {
-    CRIOPosePacket swapped_packet = packet;
-    swapped_packet.x = swap_float(packet.x);
-    swapped_packet.y = swap_float(packet.y);
-    swapped_packet.theta = swap_float(packet.theta);
-    swapped_packet.vel = swap_float(packet.vel);
-    swapped_packet.omega = swap_float(packet.omega);
-    swapped_packet.yaw_bias = swap_float(packet.yaw_bias);
-    swapped_packet.x_variance = swap_float(packet.x_variance);
-    swapped_packet.y_variance = swap_float(packet.y_variance);
-    swapped_packet.theta_variance = swap_float(packet.theta_variance);
-    swapped_packet.omega_variance = swap_float(packet.omega_variance);
-    swapped_packet.vel_variance = swap_float(packet.vel_variance);
-    swapped_packet.yaw_bias_variance = swap_float(packet.yaw_bias_variance);
-    swapped_packet.sonar_ping_1 = swap_float(packet.sonar_ping_1);
-    swapped_packet.sonar_ping_2 = swap_float(packet.sonar_ping_2);
-    swapped_packet.sonar_ping_3 = swap_float(packet.sonar_ping_3);
-    swapped_packet.sonar_ping_4 = swap_float(packet.sonar_ping_4);
-    swapped_packet.sonar_ping_5 = swap_float(packet.sonar_ping_5);
-    return swapped_packet;
-  }
-
-  CRIODiagnosticsPacket CrioReceiver::swapDiagnosticsPacket(CRIODiagnosticsPacket& packet) {
-    CRIODiagnosticsPacket swapped_packet = packet;
-    swapped_packet.FPGAVersion = be16toh(packet.FPGAVersion);
-    swapped_packet.VMonitor_cRIO_mV = be16toh(packet.VMonitor_cRIO_mV);
-    swapped_packet.LWheelTicks = be32toh(packet.LWheelTicks);
-    swapped_packet.RWheelTicks = be32toh(packet.RWheelTicks);
-    swapped_packet.LMotorTicks = be32toh(packet.LMotorTicks);
-    swapped_packet.RMotorTicks = be32toh(packet.RMotorTicks);
-    swapped_packet.VMonitor_24V_mV = be16toh(packet.VMonitor_24V_mV);
-    swapped_packet.VMonitor_13V_mV = be16toh(packet.VMonitor_13V_mV);
-    swapped_packet.VMonitor_5V_mV = be16toh(packet.VMonitor_5V_mV);
-    swapped_packet.VMonitor_eStop_mV = be16toh(packet.VMonitor_eStop_mV);
-    swapped_packet.YawRate_mV = be16toh(packet.YawRate_mV);
-    swapped_packet.YawSwing_mV = be16toh(packet.YawSwing_mV);
-    swapped_packet.YawTemp_mV = be16toh(packet.YawTemp_mV);
-    swapped_packet.YawRef_mV = be16toh(packet.YawRef_mV);
-    swapped_packet.C1Steering = be16toh(packet.C1Steering);
-    swapped_packet.C2Throttle = be16toh(packet.C2Throttle);
-    swapped_packet.C3Mode = be16toh(packet.C3Mode);
-    return swapped_packet;
-  }
-
-  CRIOGPSPacket CrioReceiver::swapGPSPacket(CRIOGPSPacket& packet) {
-    CRIOGPSPacket swapped_packet = packet;
-    swapped_packet.latitude = swap_double(packet.latitude);
-    swapped_packet.longitude = swap_double(packet.longitude);
-    swapped_packet.lat_std_dev = swap_float(packet.lat_std_dev);
-    swapped_packet.long_std_dev = swap_float(packet.long_std_dev);
-    swapped_packet.solution_status = be32toh(packet.solution_status);
-    swapped_packet.position_type = be32toh(packet.position_type);
-    swapped_packet.differential_age = swap_float(packet.differential_age);
-    swapped_packet.solution_age = swap_float(packet.solution_age);
-    return swapped_packet;
-  }
-
-  void CrioReceiver::handlePosePacket(CRIOPosePacket packet) {
-    ros::Time current_time = ros::Time::now();
-    CRIOPosePacket swapped_packet = swapPosePacket(packet);
+  void CrioReceiver::handlePosePacket(CRIOPosePacket& swapped_packet, const ros::Time& current_time) {
+    swapPosePacketInPlace(swapped_packet);
     if (push_casters_) {
       swapped_packet.x = -swapped_packet.x;
       swapped_packet.y = -swapped_packet.y;
       swapped_packet.theta = swapped_packet.theta + M_PI;
       swapped_packet.vel = -swapped_packet.vel;
     }
-    pose_packet_ = swapped_packet;
-    cwru_msgs::Pose p, p2;
+    {
+      boost::mutex::scoped_lock lock(diagnostics_mutex_);
+      pose_packet_ = swapped_packet;
+    }
+    cwru_msgs::Pose& p = pose_msg_;
     p.x = swapped_packet.x;
     p.y = swapped_packet.y;
     p.theta = swapped_packet.theta;
@@ -408,73 +370,69 @@ namespace cwru_base {
     p.vel_var = swapped_packet.vel_variance;
     p.omega_var = swapped_packet.omega_variance;
     ROS_DEBUG("Yaw bias variance: %f", swapped_packet.yaw_bias_variance);
-    p.header.frame_id = "crio";
     p.header.stamp = current_time;
-    p2 = p;
-    p2.y = -p2.y;
-    p2.theta = -p2.theta;
-    p2.omega = -p2.omega;
-    p2.header.frame_id = "flipped_crio";
+    cwru_msgs::Pose& p2 = flipped_pose_msg_;
+    p2.x = p.x;
+    p2.y = -p.y;
+    p2.theta = -p.theta;
+    p2.vel = p.vel;
+    p2.omega = -p.omega;
+    p2.x_var = p.x_var;
+    p2.y_var = p.y_var;
+    p2.theta_var = p.theta_var;
+    p2.vel_var = p.vel_var;
+    p2.omega_var = p.omega_var;
+    p2.header.stamp = current_time;
     pose_pub_.publish(p);
     flipped_pose_pub_.publish(p2);
 
-    cwru_msgs::Sonar ping;
-    ping.header.stamp = current_time;
-    handleSonarPing(ping, swapped_packet.sonar_ping_1, std::string("sonar_1_link"), sonar1_pub_);
-    handleSonarPing(ping, swapped_packet.sonar_ping_2, std::string("sonar_2_link"), sonar2_pub_);
-    handleSonarPing(ping, swapped_packet.sonar_ping_3, std::string("sonar_3_link"), sonar3_pub_);
-    handleSonarPing(ping, swapped_packet.sonar_ping_4, std::string("sonar_4_link"), sonar4_pub_);
-    handleSonarPing(ping, swapped_packet.sonar_ping_5, std::string("sonar_5_link"), sonar5_pub_);
+    // sonar_ping_1..5 are contiguous in the packet
+    const float* ping_values = &swapped_packet.sonar_ping_1;
+    for (int i = 0; i < NUM_SONARS; i++) {
+      sonar_msgs_[i].header.stamp = current_time;
+      sonar_msgs_[i].dist = ping_values[i];
+      sonar_pubs_[i].publish(sonar_msgs_[i]);
+    }
     ROS_DEBUG("Handled a Pose Packet");
   }
 
-  void CrioReceiver::handleSonarPing(cwru_msgs::Sonar& ping, const float ping_value, const std::string frame_id, ros::Publisher& sonar_pub) {
-    ping.header.frame_id = frame_id;
-    ping.dist = ping_value;
-    sonar_pub.publish(ping);
-  }
-
-  void CrioReceiver::handleDiagnosticsPacket(CRIODiagnosticsPacket packet) {
-    ros::Time current_time = ros::Time::now();
-    CRIODiagnosticsPacket swapped_packet = swapDiagnosticsPacket(packet);
-    diagnostics_info_ = swapped_packet;
-    std_msgs::Bool msg;
-    msg.data = !diagnostics_info_.eStopTriggered;
-    estop_pub_.publish(msg);
+  void CrioReceiver::handleDiagnosticsPacket(CRIODiagnosticsPacket& packet, const ros::Time& current_time) {
+    swapDiagnosticsPacketInPlace(packet);
+    {
+      boost::mutex::scoped_lock lock(diagnostics_mutex_);
+      diagnostics_info_ = packet;
+    }
+    estop_msg_.data = !packet.eStopTriggered;
+    estop_pub_.publish(estop_msg_);
 	
-	cwru_msgs::PowerState power_msg;
-	power_msg.header.stamp = current_time;
-	power_msg.header.frame_id = "crio";
-	power_msg.battery_voltage = diagnostics_info_.VMonitor_24V_mV / 1000.0;
-	power_msg.v13_8_voltage = diagnostics_info_.VMonitor_13V_mV / 1000.0;
-	power_msg.motor_voltage = diagnostics_info_.VMonitor_eStop_mV / 1000.0;
-	power_msg.cRIO_voltage = diagnostics_info_.VMonitor_cRIO_mV / 1000.0;
-	power_pub_.publish(power_msg);
+	power_msg_.header.stamp = current_time;
+	power_msg_.battery_voltage = packet.VMonitor_24V_mV / 1000.0;
+	power_msg_.v13_8_voltage = packet.VMonitor_13V_mV / 1000.0;
+	power_msg_.motor_voltage = packet.VMonitor_eStop_mV / 1000.0;
+	power_msg_.cRIO_voltage = packet.VMonitor_cRIO_mV / 1000.0;
+	power_pub_.publish(power_msg_);
 	
-    cwru_msgs::cRIOSensors sensor_msg;
-    sensor_msg.header.stamp = current_time;
-    sensor_msg.header.frame_id = "crio";
-    sensor_msg.left_wheel_encoder = diagnostics_info_.LWheelTicks;
-    sensor_msg.right_wheel_encoder = diagnostics_info_.RWheelTicks;
-    sensor_msg.left_motor_encoder = diagnostics_info_.LMotorTicks;
-    sensor_msg.right_motor_encoder = diagnostics_info_.RMotorTicks;
-    sensor_msg.yaw_rate = diagnostics_info_.YawRate_mV;
-    sensor_msg.yaw_temp = diagnostics_info_.YawTemp_mV;
-    sensor_msg.yaw_ref = diagnostics_info_.YawRef_mV;
-    sensor_pub_.publish(sensor_msg);
+    sensor_msg_.header.stamp = current_time;
+    sensor_msg_.left_wheel_encoder = packet.LWheelTicks;
+    sensor_msg_.right_wheel_encoder = packet.RWheelTicks;
+    sensor_msg_.left_motor_encoder = packet.LMotorTicks;
+    sensor_msg_.right_motor_encoder = packet.RMotorTicks;
+    sensor_msg_.yaw_rate = packet.YawRate_mV;
+    sensor_msg_.yaw_temp = packet.YawTemp_mV;
+    sensor_msg_.yaw_ref = packet.YawRef_mV;
+    sensor_pub_.publish(sensor_msg_);
   }
 
-  void CrioReceiver::handleGPSPacket(CRIOGPSPacket packet) {
+  void CrioReceiver::handleGPSPacket(CRIOGPSPacket& swapped_packet, const ros::Time& current_time) {
     ROS_DEBUG("Got a GPS Packet. Now broadcasting as a ROS topic");
-    ros::Time current_time = ros::Time::now();
-    CRIOGPSPacket swapped_packet = swapGPSPacket(packet);
-    gps_packet_ = swapped_packet;
+    swapGPSPacketInPlace(swapped_packet);
+    {
+      boost::mutex::scoped_lock lock(diagnostics_mutex_);
+      gps_packet_ = swapped_packet;
+    }
 
-    cwru_msgs::NavSatFix fix_msg;
+    cwru_msgs::NavSatFix& fix_msg = fix_msg_;
     fix_msg.header.stamp = current_time;
-    fix_msg.header.frame_id = "crio_gps";
-    fix_msg.status.service = cwru_msgs::NavSatStatus::SERVICE_GPS;
-    fix_msg.position_covariance_type = cwru_msgs::NavSatFix::COVARIANCE_TYPE_DIAGONAL_KNOWN;
 
     fix_msg.longitude = swapped_packet.longitude;
     fix_msg.latitude = swapped_packet.latitude;
@@ -506,20 +464,6 @@ namespace cwru_base {
   }
 };
 
-void check_deadline(deadline_timer& deadline, udp::socket& socket) {
-  if (deadline.expires_at() <= deadline_timer::traits_type::now()) {
-    socket.cancel();
-    deadline.expires_at(boost::posix_time::pos_infin);
-  }
-  deadline.async_wait(boost::bind(&check_deadline, boost::ref(deadline), boost::ref(socket)));
-}
-
-static void handle_receive(const boost::system::error_code& input_ec, std::size_t input_len,
-    boost::system::error_code* output_ec, std::size_t* output_len) {
-  *output_ec = input_ec;
-  *output_len = input_len;
-}
-
 int main(int argc, char *argv[]) {
   ros::init(argc, argv, "crio_receiver");
   ros::NodeHandle nh;
@@ -527,42 +471,23 @@ int main(int argc, char *argv[]) {
   int timeout_val;
   priv_nh.param("socket_timeout", timeout_val, 10);
   cwru_base::CrioReceiver from_crio;
-  boost::asio::io_service io_service;
-  udp::socket socket(io_service, udp::endpoint(udp::v4(), 50000));
-  deadline_timer deadline(io_service);
-  deadline.expires_at(boost::posix_time::pos_infin);
-  check_deadline(deadline, socket);
-  boost::posix_time::seconds timeout(timeout_val);
+  // each wakeup takes every packet queued since the last one, in one syscall
+  cwru_base::CrioBatchReceiver receiver(50000);
+  if (!receiver.isOpen()) {
+    ROS_FATAL("cRIO receiver could not open UDP port 50000: %s", strerror(errno));
+    return 1;
+  }
   while (nh.ok()) {
-    try {
-      boost::array<cwru_base::CRIOCommand, 1> recv_buf;
-      udp::endpoint remote_endpoint;
-
-      deadline.expires_from_now(timeout);
-
-      boost::system::error_code error = boost::asio::error::would_block;
-      std::size_t length = 0;
-
-      socket.async_receive_from(boost::asio::buffer(recv_buf), remote_endpoint, 
-          boost::bind(&handle_receive, _1, _2, &error, &length));
-
-      do {
-        io_service.run_one();
-      } while (error == boost::asio::error::would_block);
-
-      if (error) {
-        if (error == boost::asio::error::operation_aborted) {
-          ROS_WARN("Socket receive timed out. Are you sure you are connected to the cRIO?");
-          from_crio.updateDiagnostics();
-        } else {
-          throw boost::system::system_error(error);
-        }
-      } else {
-        from_crio.dispatchReceivedPacket(recv_buf[0]);
-        from_crio.updateDiagnostics();
+    int npackets = receiver.receive(timeout_val);
+    if (npackets < 0) {
+      ROS_ERROR("cRIO receiver socket error: %s", strerror(errno));
+    } else if (npackets == 0) {
+      ROS_WARN("Socket receive timed out. Are you sure you are connected to the cRIO?");
+    } else {
+      for (int i = 0; i < npackets; i++) {
+        const struct timespec& stamp = receiver.stamp(i);
+        from_crio.dispatchReceivedPacket(receiver.packet(i), ros::Time(stamp.tv_sec, stamp.tv_nsec));
       }
-    } catch (std::exception& e) {
-      ROS_ERROR_STREAM("cRIO receiver threw an exception: " << e.what());
     }
   }
 }
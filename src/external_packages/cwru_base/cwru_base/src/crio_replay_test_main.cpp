@@ -0,0 +1,274 @@
+/* crio_replay_test_main: loopback replay test of cRIO packet ingest; does not need ROS or a cRIO
+ *
+ * A sender thread replays a cRIO packet stream (pose packets at every tick, diagnostics every 5th, GPS every 50th,
+ * all big-endian, as the cRIO sends them) to a local UDP port, in bursts, at several rates. The stream is
+ * received twice at each rate:
+ *   per-packet: one recvfrom() per packet, decoded by copying each field, as crio_receiver used to;
+ *   batched:    CrioBatchReceiver (recvmmsg, kernel timestamps), decoded in place.
+ * For each, it reports packets received, syscalls per packet, receiver CPU time per packet and, for the batched
+ * receiver, the delay from kernel receive to decode. Decoded pose packets are checked against the stream.
+ *
+ * usage: crio_replay_test_main [port (default 50123)]
+ */
+
+#include <cwru_base/crio_batch_receiver.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace cwru_base;
+
+static const int BURST_SIZE = 16; // packets sent back-to-back, as after a stall on the cRIO side
+
+static double now_sec(clockid_t clock) {
+  struct timespec t;
+  clock_gettime(clock, &t);
+  return t.tv_sec + 1.0e-9 * t.tv_nsec;
+}
+
+static float be_float(float x) {
+  uint32_t w;
+  memcpy(&w, &x, sizeof(w));
+  w = htobe32(w);
+  memcpy(&x, &w, sizeof(w));
+  return x;
+}
+
+/* the stream, as the cRIO would send it: pose x holds the sequence number, so decoding can be checked */
+struct Stream {
+  std::vector<CRIOCommand> packets;
+  std::vector<int> lengths;
+};
+
+static void make_stream(int npackets, Stream& stream) {
+  stream.packets.resize(npackets);
+  stream.lengths.resize(npackets);
+  for (int i = 0; i < npackets; i++) {
+    CRIOCommand& cmd = stream.packets[i];
+    memset(&cmd, 0, sizeof(cmd));
+    if (i % 50 == 49) {
+      CRIOGPSPacket* gps = (CRIOGPSPacket*) &cmd;
+      gps->type = GPS_t;
+      double lat = 41.5;
+      uint64_t w;
+      memcpy(&w, &lat, sizeof(w));
+      w = htobe64(w);
+      memcpy(&gps->latitude, &w, sizeof(w));
+      gps->solution_age = be_float(0.5f);
+      stream.lengths[i] = sizeof(CRIOGPSPacket);
+    } else if (i % 5 == 4) {
+      CRIODiagnosticsPacket* diag = (CRIODiagnosticsPacket*) &cmd;
+      diag->type = DIAGNOSTICS_t;
+      diag->VMonitor_24V_mV = htobe16(25000);
+      diag->LWheelTicks = htobe32(i);
+      stream.lengths[i] = sizeof(CRIODiagnosticsPacket);
+    } else {
+      CRIOPosePacket* pose = (CRIOPosePacket*) &cmd;
+      pose->type = POSE_t;
+      pose->x = be_float((float) i);
+      pose->y = be_float(0.001f * i);
+      pose->theta = be_float(0.5f);
+      pose->sonar_ping_5 = be_float(2.0f);
+      stream.lengths[i] = sizeof(CRIOPosePacket);
+    }
+  }
+}
+
+struct SenderArgs {
+  const Stream* stream;
+  int port;
+  double rate; // packets/sec; 0 for as fast as possible
+};
+
+static void* send_stream(void* arg) {
+  SenderArgs* args = (SenderArgs*) arg;
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(args->port);
+  int npackets = args->stream->packets.size();
+  double t_start = now_sec(CLOCK_MONOTONIC);
+  for (int i = 0; i < npackets; i++) {
+    if (args->rate > 0 && i % BURST_SIZE == 0) {
+      double t_due = t_start + i / args->rate;
+      while (now_sec(CLOCK_MONOTONIC) < t_due) {
+        usleep(50);
+      }
+    }
+    sendto(fd, &args->stream->packets[i], args->stream->lengths[i], 0, (struct sockaddr*) &addr, sizeof(addr));
+  }
+  close(fd);
+  return NULL;
+}
+
+struct Result {
+  int received;
+  int bad;
+  unsigned long syscalls;
+  double cpu_sec;
+  double mean_delay_us, max_delay_us;
+};
+
+/* the former decode: by-value copies of each packet */
+static CRIOPosePacket copy_swap_pose(const CRIOPosePacket& packet) {
+  CRIOPosePacket swapped = packet;
+  float* src = (float*) &packet.x;
+  float* dst = (float*) &swapped.x;
+  for (int k = 0; k < 17; k++) {
+    uint32_t w;
+    memcpy(&w, &src[k], sizeof(w));
+    w = be32toh(w);
+    memcpy(&dst[k], &w, sizeof(w));
+  }
+  return swapped;
+}
+
+static bool check_pose(const CRIOPosePacket& pose, int& expected_seq) {
+  int seq = (int) pose.x;
+  bool ok = (seq >= expected_seq && pose.theta == 0.5f && pose.sonar_ping_5 == 2.0f);
+  expected_seq = seq + 1;
+  return ok;
+}
+
+/* plain UDP socket w/ the same receive buffer as CrioBatchReceiver, for the per-packet baseline */
+static int open_udp_port(int port) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  int rcvbuf = 1 << 20;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static void receive_per_packet(int fd, int npackets, Result& result) {
+  CRIOCommand packet;
+  CRIOPosePacket pose_sink;
+  int expected_seq = 0;
+  double cpu_start = now_sec(CLOCK_THREAD_CPUTIME_ID);
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  while (result.received < npackets && poll(&pfd, 1, 200) > 0) {
+    ssize_t len = recvfrom(fd, &packet, sizeof(packet), 0, NULL, NULL);
+    result.syscalls += 2;
+    if (len <= 0) continue;
+    result.received++;
+    if (packet.type == POSE_t) {
+      pose_sink = copy_swap_pose(*((CRIOPosePacket*) &packet));
+      if (!check_pose(pose_sink, expected_seq)) result.bad++;
+    }
+  }
+  result.cpu_sec = now_sec(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+}
+
+static void receive_batched(CrioBatchReceiver& receiver, int npackets, Result& result) {
+  int expected_seq = 0;
+  double delay_sum = 0.0;
+  unsigned long batches_start = receiver.numBatches();
+  double cpu_start = now_sec(CLOCK_THREAD_CPUTIME_ID);
+  while (result.received < npackets) {
+    int n = receiver.receive(0.2);
+    result.syscalls++; // poll
+    if (n <= 0) break;
+    for (int i = 0; i < n; i++) {
+      CRIOCommand& packet = receiver.packet(i);
+      if (packet.type == POSE_t) {
+        CRIOPosePacket& pose = *((CRIOPosePacket*) &packet);
+        swapPosePacketInPlace(pose);
+        if (!check_pose(pose, expected_seq)) result.bad++;
+      } else if (packet.type == DIAGNOSTICS_t) {
+        swapDiagnosticsPacketInPlace(*((CRIODiagnosticsPacket*) &packet));
+      } else if (packet.type == GPS_t) {
+        swapGPSPacketInPlace(*((CRIOGPSPacket*) &packet));
+      }
+    }
+    double t_decoded = now_sec(CLOCK_REALTIME);
+    for (int i = 0; i < n; i++) {
+      double delay_us = 1.0e6 * (t_decoded - (receiver.stamp(i).tv_sec + 1.0e-9 * receiver.stamp(i).tv_nsec));
+      delay_sum += delay_us;
+      if (delay_us > result.max_delay_us) result.max_delay_us = delay_us;
+    }
+    result.received += n;
+  }
+  result.cpu_sec = now_sec(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+  result.syscalls += receiver.numBatches() - batches_start;
+  result.mean_delay_us = result.received > 0 ? delay_sum / result.received : 0.0;
+}
+
+static void print_result(const char* mode, double rate, int npackets, const Result& r) {
+  printf("%-10s rate %8.0f pkt/s: received %6d/%d, bad %d, syscalls/pkt %5.2f, cpu/pkt %6.2f us",
+      mode, rate, r.received, npackets, r.bad, r.received ? (double) r.syscalls / r.received : 0.0,
+      r.received ? 1.0e6 * r.cpu_sec / r.received : 0.0);
+  if (r.mean_delay_us > 0.0) {
+    printf(", rx->decode delay mean %.1f us, max %.1f us", r.mean_delay_us, r.max_delay_us);
+  }
+  printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+  int port = (argc > 1) ? atoi(argv[1]) : 50123;
+  const double rates[] = {1000.0, 10000.0, 50000.0, 0.0};
+  const int nrates = sizeof(rates) / sizeof(rates[0]);
+  int nfailed = 0;
+
+  for (int irate = 0; irate < nrates; irate++) {
+    double rate = rates[irate];
+    int npackets = (rate > 0) ? (int) (rate / 2) : 100000; // half-second streams
+    Stream stream;
+    make_stream(npackets, stream);
+    SenderArgs args;
+    args.stream = &stream;
+    args.port = port;
+    args.rate = rate;
+    pthread_t sender;
+
+    for (int mode = 0; mode < 2; mode++) {
+      Result result;
+      memset(&result, 0, sizeof(result));
+      // open the receiving socket before the sender starts, so nothing is lost to an unbound port
+      if (mode == 0) {
+        int fd = open_udp_port(port);
+        if (fd < 0) {
+          perror("could not open receive port");
+          return 1;
+        }
+        pthread_create(&sender, NULL, send_stream, &args);
+        receive_per_packet(fd, npackets, result);
+        close(fd);
+      } else {
+        CrioBatchReceiver receiver(port);
+        if (!receiver.isOpen()) {
+          perror("could not open receive port");
+          return 1;
+        }
+        pthread_create(&sender, NULL, send_stream, &args);
+        receive_batched(receiver, npackets, result);
+      }
+      pthread_join(sender, NULL);
+      print_result(mode == 0 ? "per-packet" : "batched", rate, npackets, result);
+      if (result.bad > 0) nfailed++;
+    }
+  }
+  if (nfailed > 0) {
+    printf("FAILED: %d runs decoded bad pose packets\n", nfailed);
+    return 1;
+  }
+  printf("all decoded pose packets matched the stream\n");
+  return 0;
+}
@@ -32,43 +32,124 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  *********************************************************************/
 #include <ros/ros.h>
-#include <sensor_msgs/PointCloud.h>
+#include <sensor_msgs/PointCloud2.h>
 #include <nav_msgs/OccupancyGrid.h>
-#include <geometry_msgs/Point32.h>
 #include <tf/transform_listener.h>
+#include <tf_conversions/tf_eigen.h>
+#include <Eigen/Geometry>
 #include <string>
-#include <list>
-
-std::list<geometry_msgs::Point32> points;
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+
+//Obstacle cells of the static map are held in a grid of square tiles (tile_size meters on a side).
+//Each cycle, only the tiles that overlap the rolling window around the robot are visited, and the
+//points inside the window are transformed into target_frame with a single batched affine multiply.
+//Cost per cycle therefore scales with the window size, not with the size of the map.
+struct ObstacleTiles {
+	double origin_x, origin_y; //map-frame coords of the lower-left corner of tile (0,0)
+	double tile_size;
+	int n_tiles_x, n_tiles_y;
+	std::vector<std::vector<Eigen::Vector2f> > tiles; //obstacle points (map frame), tile-major; index = ty*n_tiles_x+tx
+	int n_points;
+};
+
+ObstacleTiles obstacle_tiles;
+double tile_size=2.0;
 std::string frame_id;
 bool recieved_map;
-bool updated_map;
 
 void mapOccupancyGridCallback(const  nav_msgs::OccupancyGrid::ConstPtr& msg)
 {
-	points.clear();
 	recieved_map=true;
-	updated_map=true;
 	frame_id=msg->header.frame_id;
-	geometry_msgs::Point32 p;
+	double res=msg->info.resolution;
+	obstacle_tiles.origin_x=msg->info.origin.position.x;
+	obstacle_tiles.origin_y=msg->info.origin.position.y;
+	obstacle_tiles.tile_size=tile_size;
+	obstacle_tiles.n_tiles_x=(int)ceil(msg->info.width*res/tile_size);
+	obstacle_tiles.n_tiles_y=(int)ceil(msg->info.height*res/tile_size);
+	if(obstacle_tiles.n_tiles_x<1) obstacle_tiles.n_tiles_x=1;
+	if(obstacle_tiles.n_tiles_y<1) obstacle_tiles.n_tiles_y=1;
+	obstacle_tiles.tiles.clear();
+	obstacle_tiles.tiles.resize(obstacle_tiles.n_tiles_x*obstacle_tiles.n_tiles_y);
+	obstacle_tiles.n_points=0;
 	for(unsigned int m=0;m<msg->info.height;m++){
+		int ty=std::min((int)(m*res/tile_size), obstacle_tiles.n_tiles_y-1);
 		for(unsigned int n=0;n<msg->info.width;n++){
 			//currently 100 is the only value used for obsticles in the map
 			if(msg->data[m*msg->info.width+n]==100){
-				p.x=n*msg->info.resolution+msg->info.origin.position.x;
-				p.y=m*msg->info.resolution+msg->info.origin.position.y;
-				points.push_back(p);
+				int tx=std::min((int)(n*res/tile_size), obstacle_tiles.n_tiles_x-1);
+				obstacle_tiles.tiles[ty*obstacle_tiles.n_tiles_x+tx].push_back(
+					Eigen::Vector2f(n*res+obstacle_tiles.origin_x, m*res+obstacle_tiles.origin_y));
+				obstacle_tiles.n_points++;
 			}
 		}
 	}
+	ROS_INFO("map_as_sensor: indexed %d obstacle points in %d x %d tiles",
+		obstacle_tiles.n_points, obstacle_tiles.n_tiles_x, obstacle_tiles.n_tiles_y);
+}
+
+//collect the obstacle points within half_width of (x,y) (an axis-aligned square, in the map frame) as columns of pts
+int query_window(double x, double y, double half_width, double height, Eigen::Matrix3Xf &pts){
+	const ObstacleTiles &ot=obstacle_tiles;
+	float x_min=x-half_width, x_max=x+half_width;
+	float y_min=y-half_width, y_max=y+half_width;
+	int tx_min=(int)floor((x_min-ot.origin_x)/ot.tile_size);
+	int tx_max=(int)floor((x_max-ot.origin_x)/ot.tile_size);
+	int ty_min=(int)floor((y_min-ot.origin_y)/ot.tile_size);
+	int ty_max=(int)floor((y_max-ot.origin_y)/ot.tile_size);
+	if(tx_min<0) tx_min=0;
+	if(ty_min<0) ty_min=0;
+	if(tx_max>=ot.n_tiles_x) tx_max=ot.n_tiles_x-1;
+	if(ty_max>=ot.n_tiles_y) ty_max=ot.n_tiles_y-1;
+
+	//size the buffer for the worst case (all points of the overlapped tiles); it only grows
+	int n_candidates=0;
+	for(int ty=ty_min;ty<=ty_max;ty++)
+		for(int tx=tx_min;tx<=tx_max;tx++)
+			n_candidates+=ot.tiles[ty*ot.n_tiles_x+tx].size();
+	if(pts.cols()<n_candidates) pts.resize(3,n_candidates);
+
+	int npts=0;
+	for(int ty=ty_min;ty<=ty_max;ty++){
+		for(int tx=tx_min;tx<=tx_max;tx++){
+			const std::vector<Eigen::Vector2f> &tile=ot.tiles[ty*ot.n_tiles_x+tx];
+			for(size_t k=0;k<tile.size();k++){
+				const Eigen::Vector2f &p=tile[k];
+				if(p.x()>=x_min && p.x()<=x_max && p.y()>=y_min && p.y()<=y_max){
+					pts(0,npts)=p.x();
+					pts(1,npts)=p.y();
+					pts(2,npts)=height;
+					npts++;
+				}
+			}
+		}
+	}
+	return npts;
+}
+
+//x, y, z and intensity, all float32
+void init_cloud(sensor_msgs::PointCloud2 &cloud, const std::string &channel_name){
+	const char *names[4]={"x","y","z",channel_name.c_str()};
+	cloud.fields.resize(4);
+	for(int i=0;i<4;i++){
+		cloud.fields[i].name=names[i];
+		cloud.fields[i].offset=4*i;
+		cloud.fields[i].datatype=sensor_msgs::PointField::FLOAT32;
+		cloud.fields[i].count=1;
+	}
+	cloud.is_bigendian=false;
+	cloud.is_dense=true;
+	cloud.point_step=16;
+	cloud.height=1;
 }
 
 
 int main(int argc, char *argv[]){
 	//boolean switch for if we have ever recieved a map
 	recieved_map=false;
-	//boolean switch that triggers every time the map is updated
-	updated_map=false;
 
 
 	//intensity of all points in the cloud
@@ -79,6 +160,9 @@ int main(int argc, char *argv[]){
 	double height=8.;
 	//name of the channel the points are in, for the cloud
 	std::string channel_name="intensity";
+	//edge length of the (square) window of map points to publish, centered on the robot;
+	//should cover the local costmap's rolling window
+	double window_size=12.0;
 
 	//name of the tf frame to put the point cloud in so that the origin of the point cloud will be within the rolling window for the local costmap
 	std::string target_frame="base_link";
@@ -94,12 +178,13 @@ int main(int argc, char *argv[]){
 	priv_nh_.param("channel_name",channel_name, std::string("intensity"));
 	priv_nh_.param("height",height, 1.9);
 	priv_nh_.param("target_frame", target_frame, std::string("base_link"));
+	priv_nh_.param("window_size", window_size, 12.0);
+	priv_nh_.param("tile_size", tile_size, 2.0);
 
 	ros::Subscriber sub = n.subscribe("input_map", 1, &mapOccupancyGridCallback);
 
-	ros::Publisher cloud_pub = n.advertise<sensor_msgs::PointCloud>("map_cloud",1);
+	ros::Publisher cloud_pub = n.advertise<sensor_msgs::PointCloud2>("map_cloud",1);
 
-	sensor_msgs::PointCloud * sensor_points=NULL;
 	//continuously publish the point cloud at a set rate
 	ros::Rate r(sensor_rate);
 
@@ -111,42 +196,52 @@ int main(int argc, char *argv[]){
 	}
 	tf::TransformListener listener;
 	listener.waitForTransform(target_frame, frame_id, ros::Time::now(), ros::Duration(10));
-	sensor_msgs::PointCloud temp_out;
+
+	//buffers reused every cycle
+	sensor_msgs::PointCloud2 cloud_out;
+	init_cloud(cloud_out, channel_name);
+	Eigen::Matrix3Xf window_pts, window_pts_out;
+	//the window may be rotated w/rt the map axes, so query the square that encloses it at any heading
+	double half_width=0.5*window_size*sqrt(2.0);
 
 	while(n.ok()){
 		if(recieved_map){
-			if(updated_map){
-				updated_map=false;
-
-				if(sensor_points!=NULL){ delete(sensor_points);}
-
-				sensor_points=NULL;
-				sensor_points=new sensor_msgs::PointCloud;
-
-				sensor_points->points.resize(points.size());
-
-				//sensor_points->set_channels_size(1);
-				sensor_points->channels.resize(1);
-				sensor_points->channels[0].name = channel_name;
-				sensor_points->channels[0].values.resize(points.size());
-
-				sensor_points->header.frame_id =frame_id;
-				//for everything in list points, set the x and y value to the right stuff, and set intensity to intensity
-				int point_number=0;
-				for(std::list<geometry_msgs::Point32>::const_iterator iterator = points.begin(), end = points.end(); iterator != end; ++iterator){
-					sensor_points->points[point_number].x = (*iterator).x;
-					sensor_points->points[point_number].y = (*iterator).y;
-					sensor_points->points[point_number].z = height;
-					sensor_points->channels[0].values[point_number] = (float)intensity;
-					++point_number;
-				}
-			}
-
 			ros::Time latest_transform_time = ros::Time::now();
 			listener.getLatestCommonTime(frame_id, target_frame, latest_transform_time, NULL);
-			sensor_points->header.stamp = latest_transform_time;
-			listener.transformPointCloud(target_frame, *sensor_points, temp_out);
-			cloud_pub.publish(temp_out);
+			tf::StampedTransform map_to_target;
+			try{
+				listener.lookupTransform(target_frame, frame_id, latest_transform_time, map_to_target);
+			}catch(tf::TransformException &ex){
+				ROS_WARN("%s",ex.what());
+				ros::spinOnce();
+				r.sleep();
+				continue;
+			}
+			Eigen::Affine3d A_d;
+			tf::transformTFToEigen(map_to_target, A_d);
+			Eigen::Affine3f A=A_d.cast<float>();
+			//robot position in the map frame is the origin of target_frame
+			Eigen::Vector3f robot_in_map=A.inverse(Eigen::Isometry)*Eigen::Vector3f::Zero();
+
+			int npts=query_window(robot_in_map.x(), robot_in_map.y(), half_width, height, window_pts);
+			if(window_pts_out.cols()<npts) window_pts_out.resize(3,window_pts.cols());
+			window_pts_out.leftCols(npts).noalias()=A.linear()*window_pts.leftCols(npts);
+			window_pts_out.leftCols(npts).colwise()+=A.translation();
+
+			cloud_out.header.frame_id=target_frame;
+			cloud_out.header.stamp=latest_transform_time;
+			cloud_out.width=npts;
+			cloud_out.row_step=cloud_out.point_step*npts;
+			cloud_out.data.resize(cloud_out.row_step);
+			float xyzi[4];
+			xyzi[3]=(float)intensity;
+			for(int i=0;i<npts;i++){
+				xyzi[0]=window_pts_out(0,i);
+				xyzi[1]=window_pts_out(1,i);
+				xyzi[2]=window_pts_out(2,i);
+				memcpy(&cloud_out.data[16*i], xyzi, 16);
+			}
+			cloud_pub.publish(cloud_out);
 		}
 
 		ros::spinOnce();
@@ -155,4 +250,3 @@ int main(int argc, char *argv[]){
 
 	return 0;
 }
-
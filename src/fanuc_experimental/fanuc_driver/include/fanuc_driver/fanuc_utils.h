@@ -65,6 +65,8 @@ void linkage_transform(const std::vector<double>& joints_in,
 /**
  * \brief Corrects for parallel linkage coupling between joints.
  *
+ * Positions, velocities and accelerations are all corrected.
+ *
  * \param[in] pt_in input joint trajectory point
  * \param[out] pt_out output joint trajectory point
  * \param[in] J23_factor  Linkage factor for J2-J3.
@@ -73,6 +75,21 @@ void linkage_transform(const std::vector<double>& joints_in,
 void linkage_transform(const trajectory_msgs::JointTrajectoryPoint& pt_in,
     trajectory_msgs::JointTrajectoryPoint* pt_out, double J23_factor = 0);
 
+/**
+ * \brief Corrects for parallel linkage coupling between joints, for all
+ *   points of a trajectory, in place.
+ *
+ * Positions, velocities and accelerations are all corrected, in a single pass
+ * over the points and without copying them. Points must be in robot joint
+ * order (J1 first).
+ *
+ * \param[in,out] traj joint trajectory
+ * \param[in] J23_factor  Linkage factor for J2-J3.
+ *   J3_out = J3_in + j23_factor * J2_in
+ */
+void linkage_transform(trajectory_msgs::JointTrajectory* traj,
+    double J23_factor = 0);
+
 
 } //fanuc
 } //utils
@@ -44,12 +44,17 @@
 
 
 using industrial_robot_client::joint_trajectory_streamer::JointTrajectoryStreamer;
+using industrial::joint_traj_pt_message::JointTrajPtMessage;
 
 
 class Fanuc_JointTrajectoryStreamer : public JointTrajectoryStreamer
 {
   int J23_factor_;
 
+  // robot-ordered copy of the last trajectory; reused, so its points keep
+  // their storage from one trajectory to the next
+  trajectory_msgs::JointTrajectory rbt_traj_;
+
 
 public:
   Fanuc_JointTrajectoryStreamer() : JointTrajectoryStreamer(), J23_factor_(0)
@@ -75,6 +80,49 @@ public:
 
     return true;
   }
+
+
+  /*
+   * Same as the base class, but the linkage transform is applied to the
+   * whole trajectory at once, before any point is converted, rather than
+   * to a copy of each point in turn.
+   */
+  bool trajectory_to_msgs(const trajectory_msgs::JointTrajectoryConstPtr& traj,
+      std::vector<JointTrajPtMessage>* msgs)
+  {
+    msgs->clear();
+
+    if (!is_valid(*traj))
+      return false;
+
+    // select / reorder joints for sending to robot
+    const size_t num_points = traj->points.size();
+    rbt_traj_.points.resize(num_points);
+    for (size_t i = 0; i < num_points; ++i)
+    {
+      if (!select(traj->joint_names, traj->points[i], this->all_joint_names_,
+          &rbt_traj_.points[i]))
+        return false;
+    }
+
+    // sending points back to the Fanuc, so invert factor
+    fanuc::utils::linkage_transform(&rbt_traj_, -J23_factor_);
+
+    msgs->reserve(num_points);
+    for (size_t i = 0; i < num_points; ++i)
+    {
+      double vel, duration;
+
+      // reduce velocity to a single scalar, for robot command
+      if (!calc_speed(rbt_traj_.points[i], &vel, &duration))
+        return false;
+
+      msgs->push_back(create_message(i, rbt_traj_.points[i].positions, vel,
+          duration));
+    }
+
+    return true;
+  }
 };
 
 
@@ -47,13 +47,22 @@ namespace utils
 {
 
 
-// TBD: This transform should also account for velocity/acceleration affects
-//      due to linkage, so that velocity calculation is accurate
+// J3 += J23_factor * J2; the coupling is linear, so the same relation holds
+// for positions, velocities and accelerations. Empty fields are left alone.
+static inline void couple_J23(std::vector<double>& v, double J23_factor)
+{
+  if (v.size() > 2)
+    v[2] += J23_factor * v[1];
+}
+
+
 void linkage_transform(const trajectory_msgs::JointTrajectoryPoint& pt_in,
     trajectory_msgs::JointTrajectoryPoint* pt_out, double J23_factor)
 {
   *pt_out = pt_in;
-  linkage_transform(pt_in.positions, &(pt_out->positions), J23_factor);
+  couple_J23(pt_out->positions, J23_factor);
+  couple_J23(pt_out->velocities, J23_factor);
+  couple_J23(pt_out->accelerations, J23_factor);
 }
 
 
@@ -63,7 +72,22 @@ void linkage_transform(const std::vector<double>& points_in,
   ROS_ASSERT(points_in.size() > 3);
 
   *points_out = points_in;
-  points_out->at(2) += J23_factor * points_out->at(1);
+  couple_J23(*points_out, J23_factor);
+}
+
+
+void linkage_transform(trajectory_msgs::JointTrajectory* traj, double J23_factor)
+{
+  if (J23_factor == 0)
+    return;
+
+  std::vector<trajectory_msgs::JointTrajectoryPoint>& points = traj->points;
+  for (size_t i = 0; i < points.size(); ++i)
+  {
+    couple_J23(points[i].positions, J23_factor);
+    couple_J23(points[i].velocities, J23_factor);
+    couple_J23(points[i].accelerations, J23_factor);
+  }
 }
 
 
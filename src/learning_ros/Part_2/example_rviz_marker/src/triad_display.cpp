@@ -3,161 +3,196 @@
 // node to assist display of triads (axes) in rviz
 // this node subscribes to topic "triad_display_pose", from which it receives geometry_msgs/PoseStamped poses
 // it uses this info to populate and publish axes, using whatever frame_id is in the pose header
-// To see the result, add a "Marker" display in rviz and subscribe to the marker topic "/triad_display"
+// To see the result, add a "MarkerArray" display in rviz and subscribe to the marker topic "/triad_display_array"
 // Can test this display node with the test node: "triad_display_test_node", which generates moving poses
 // corresponding to a marker origin spiraling up in z
+//
+// multi-frame triad server: any number of named triads may be displayed by publishing
+// example_rviz_marker/TriadPose messages to topic "triad_display_named_pose"; each name gets its own
+// marker namespace.  Set remove=true to erase a named triad.  Poses on "triad_display_pose" are shown
+// as the triad named "triad_namespace" (same namespace as before).
+// All triads are published together as one visualization_msgs/MarkerArray.  Only triads whose pose
+// changed are sent, at up to 20Hz; the full set is re-sent at a low keep-alive rate (param ~keep_alive_rate,
+// default 1Hz; <= 0 turns it off) so that a newly-started rviz catches up.
+// Arrow geometry is fixed (expressed in the triad frame) and set up once; an update only copies the pose
+// into the marker, and rviz applies the transform.
 
 #include <ros/ros.h>
 #include <visualization_msgs/Marker.h>
-//#include <visualization_msgs/InteractiveMarkerFeedback.h>
+#include <visualization_msgs/MarkerArray.h>
 #include <geometry_msgs/Point.h>
-#include <geometry_msgs/PointStamped.h>
 #include <geometry_msgs/PoseStamped.h>
-#include <math.h>
-#include <Eigen/Eigen>  
-#include <Eigen/Core>
-#include <Eigen/Geometry>
-#include <Eigen/Dense>
-#include <tf_conversions/tf_eigen.h>
-
-//some globals...
-geometry_msgs::Point vertex1;
-geometry_msgs::PoseStamped g_stamped_pose;
-Eigen::Affine3d g_affine_marker_pose;
-
-// create arrow markers; do this 3 times to create a triad (frame)
-visualization_msgs::Marker arrow_marker_x; //this one for the x axis
-visualization_msgs::Marker arrow_marker_y; //this one for the y axis
-visualization_msgs::Marker arrow_marker_z; //this one for the y axis
-
-//udpdate_arrows() set the frame and 
-
-void update_arrows() {
-    geometry_msgs::Point origin, arrow_x_tip, arrow_y_tip, arrow_z_tip;
-    Eigen::Matrix3d R;
-    Eigen::Quaterniond quat;
-    quat.x() = g_stamped_pose.pose.orientation.x;
-    quat.y() = g_stamped_pose.pose.orientation.y;
-    quat.z() = g_stamped_pose.pose.orientation.z;
-    quat.w() = g_stamped_pose.pose.orientation.w;
-    R = quat.toRotationMatrix();
-    Eigen::Vector3d x_vec, y_vec, z_vec;
-    double veclen = 0.2; //make the arrows this long
-    x_vec = R.col(0) * veclen;
-    y_vec = R.col(1) * veclen;
-    z_vec = R.col(2) * veclen;
-
-    //update the arrow markers w/ new pose:
-    origin = g_stamped_pose.pose.position;
-    arrow_x_tip = origin;
-    arrow_x_tip.x += x_vec(0);
-    arrow_x_tip.y += x_vec(1);
-    arrow_x_tip.z += x_vec(2);
-    arrow_marker_x.points.clear();
-    arrow_marker_x.points.push_back(origin);
-    arrow_marker_x.points.push_back(arrow_x_tip);
-    arrow_marker_x.header = g_stamped_pose.header;
-
-    arrow_y_tip = origin;
-    arrow_y_tip.x += y_vec(0);
-    arrow_y_tip.y += y_vec(1);
-    arrow_y_tip.z += y_vec(2);
-
-    arrow_marker_y.points.clear();
-    arrow_marker_y.points.push_back(origin);
-    arrow_marker_y.points.push_back(arrow_y_tip);
-    arrow_marker_y.header = g_stamped_pose.header;
-
-    arrow_z_tip = origin;
-    arrow_z_tip.x += z_vec(0);
-    arrow_z_tip.y += z_vec(1);
-    arrow_z_tip.z += z_vec(2);
-
-    arrow_marker_z.points.clear();
-    arrow_marker_z.points.push_back(origin);
-    arrow_marker_z.points.push_back(arrow_z_tip);
-    arrow_marker_z.header = g_stamped_pose.header;
+#include <example_rviz_marker/TriadPose.h> //a custom message type defined in this package
+#include <string>
+#include <map>
+
+using namespace std;
+
+const double g_veclen = 0.2; //make the arrows this long
+const string g_default_triad_name = "triad_namespace";
+
+//three arrows per triad, with geometry in the triad's own frame
+struct Triad {
+    visualization_msgs::Marker arrows[3];
+    bool changed; //true if not yet published since the last pose change
+};
+
+map<string, Triad> g_triads;
+visualization_msgs::Marker g_arrow_templates[3]; //x, y and z arrows, populated once by init_arrow_templates()
+visualization_msgs::MarkerArray g_marker_array; //reused for every publication
+bool g_any_changed = false;
+bool g_any_removed = false;
+visualization_msgs::MarkerArray g_removals; //DELETE markers pending publication
+
+//init persistent params of markers, including arrow vertices w/rt the triad frame
+void init_arrow_templates() {
+    geometry_msgs::Point origin;
+    origin.x = 0;
+    origin.y = 0;
+    origin.z = 0;
+    for (int i = 0; i < 3; i++) {
+        visualization_msgs::Marker &arrow = g_arrow_templates[i];
+        arrow.type = visualization_msgs::Marker::ARROW;
+        arrow.action = visualization_msgs::Marker::ADD; //create or modify marker
+        arrow.lifetime = ros::Duration(); //never delete
+        // make the arrow thin
+        arrow.scale.x = 0.01;
+        arrow.scale.y = 0.01;
+        arrow.scale.z = 0.01;
+        //red, green, blue for x, y, z axes
+        arrow.color.r = (i == 0) ? 1.0 : 0.0;
+        arrow.color.g = (i == 1) ? 1.0 : 0.0;
+        arrow.color.b = (i == 2) ? 1.0 : 0.0;
+        arrow.color.a = 1.0;
+        arrow.id = i;
+        geometry_msgs::Point tip = origin;
+        if (i == 0) tip.x = g_veclen;
+        if (i == 1) tip.y = g_veclen;
+        if (i == 2) tip.z = g_veclen;
+        arrow.points.push_back(origin);
+        arrow.points.push_back(tip);
+        arrow.pose.orientation.w = 1.0;
+    }
+}
+
+bool same_pose(const geometry_msgs::Pose &a, const geometry_msgs::Pose &b) {
+    return (a.position.x == b.position.x && a.position.y == b.position.y && a.position.z == b.position.z &&
+            a.orientation.x == b.orientation.x && a.orientation.y == b.orientation.y &&
+            a.orientation.z == b.orientation.z && a.orientation.w == b.orientation.w);
 }
 
-//init persistent params of markers, then variable coords    
-
-void init_markers() {
-    //initialize stamped pose for at a legal (if boring) pose
-    g_stamped_pose.header.stamp = ros::Time::now();
-    g_stamped_pose.header.frame_id = "world";
-    g_stamped_pose.pose.position.x = 0;
-    g_stamped_pose.pose.position.y = 0;
-    g_stamped_pose.pose.position.z = 0;
-    g_stamped_pose.pose.orientation.x = 0;
-    g_stamped_pose.pose.orientation.y = 0;
-    g_stamped_pose.pose.orientation.z = 0;
-    g_stamped_pose.pose.orientation.w = 1;
-
-    //the following parameters only need to get set once
-    arrow_marker_x.type = visualization_msgs::Marker::ARROW;
-    arrow_marker_x.action = visualization_msgs::Marker::ADD; //create or modify marker
-    arrow_marker_x.ns = "triad_namespace";
-    arrow_marker_x.lifetime = ros::Duration(); //never delete
-    // make the arrow thin
-    arrow_marker_x.scale.x = 0.01;
-    arrow_marker_x.scale.y = 0.01;
-    arrow_marker_x.scale.z = 0.01;
-    arrow_marker_x.color.r = 1.0; // red, for the x axis
-    arrow_marker_x.color.g = 0.0;
-    arrow_marker_x.color.b = 0.0;
-    arrow_marker_x.color.a = 1.0;
-    arrow_marker_x.id = 0;
-    arrow_marker_x.header = g_stamped_pose.header;
-
-    //y and z arrow params are the same, except for colors
-    arrow_marker_y = arrow_marker_x;
-    arrow_marker_y.color.r = 0.0;
-    arrow_marker_y.color.g = 1.0; //green for y axis
-    arrow_marker_y.color.b = 0.0;
-    arrow_marker_y.color.a = 1.0;
-    arrow_marker_y.id = 1;
-
-    arrow_marker_z = arrow_marker_x;
-    arrow_marker_z.id = 2;
-    arrow_marker_z.color.r = 0.0;
-    arrow_marker_z.color.g = 0.0;
-    arrow_marker_z.color.b = 1.0; //blue for z axis
-    arrow_marker_z.color.a = 1.0;
-    //set the poses of the arrows based on g_stamped_pose
-    update_arrows();
+//record a new pose for the named triad; flags it for publication only if something changed
+void update_triad(const string &name, const geometry_msgs::PoseStamped &stamped_pose) {
+    map<string, Triad>::iterator it = g_triads.find(name);
+    if (it == g_triads.end()) {
+        Triad triad;
+        for (int i = 0; i < 3; i++) {
+            triad.arrows[i] = g_arrow_templates[i];
+            triad.arrows[i].ns = name;
+            triad.arrows[i].header = stamped_pose.header;
+            triad.arrows[i].pose = stamped_pose.pose;
+        }
+        triad.changed = true;
+        g_triads[name] = triad;
+        g_any_changed = true;
+        ROS_INFO("triad_display: added triad %s", name.c_str());
+        return;
+    }
+    Triad &triad = it->second;
+    if (same_pose(triad.arrows[0].pose, stamped_pose.pose) &&
+            triad.arrows[0].header.frame_id == stamped_pose.header.frame_id) {
+        return; //nothing new to show
+    }
+    for (int i = 0; i < 3; i++) {
+        triad.arrows[i].header = stamped_pose.header;
+        triad.arrows[i].pose = stamped_pose.pose;
+    }
+    triad.changed = true;
+    g_any_changed = true;
+}
+
+void remove_triad(const string &name) {
+    map<string, Triad>::iterator it = g_triads.find(name);
+    if (it == g_triads.end()) return;
+    for (int i = 0; i < 3; i++) {
+        visualization_msgs::Marker arrow = it->second.arrows[i];
+        arrow.action = visualization_msgs::Marker::DELETE;
+        arrow.points.clear();
+        g_removals.markers.push_back(arrow);
+    }
+    g_triads.erase(it);
+    g_any_removed = true;
+    ROS_INFO("triad_display: removed triad %s", name.c_str());
 }
 
 void poseCB(const geometry_msgs::PoseStamped &pose_msg) {
     ROS_DEBUG("got pose message");
-    //ROS_INFO("got pose message");
-    g_stamped_pose.header = pose_msg.header;
-    g_stamped_pose.pose = pose_msg.pose;
+    update_triad(g_default_triad_name, pose_msg);
+}
+
+void namedPoseCB(const example_rviz_marker::TriadPose &triad_pose_msg) {
+    string name = triad_pose_msg.name.empty() ? g_default_triad_name : triad_pose_msg.name;
+    if (triad_pose_msg.remove) {
+        remove_triad(name);
+    } else {
+        update_triad(name, triad_pose_msg.pose);
+    }
+}
 
+//fill g_marker_array with pending deletions and the arrows of changed triads (or of all triads, if send_all)
+void publish_triads(ros::Publisher &vis_pub, bool send_all) {
+    g_marker_array.markers.clear(); //keeps its capacity
+    g_marker_array.markers.insert(g_marker_array.markers.end(), g_removals.markers.begin(), g_removals.markers.end());
+    for (map<string, Triad>::iterator it = g_triads.begin(); it != g_triads.end(); ++it) {
+        Triad &triad = it->second;
+        if (send_all || triad.changed) {
+            for (int i = 0; i < 3; i++) g_marker_array.markers.push_back(triad.arrows[i]);
+            triad.changed = false;
+        }
+    }
+    g_removals.markers.clear();
+    g_any_changed = false;
+    g_any_removed = false;
+    if (!g_marker_array.markers.empty()) vis_pub.publish(g_marker_array);
 }
 
 int main(int argc, char** argv) {
     ros::init(argc, argv, "triad_display"); // this will be the node name;
     ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+    double keep_alive_rate;
+    nh_private.param("keep_alive_rate", keep_alive_rate, 1.0);
+    bool keep_alive = (keep_alive_rate > 0.0); // a rate <= 0 turns off the keep-alive re-send
+    ros::Duration keep_alive_period(keep_alive ? 1.0 / keep_alive_rate : 0.0);
+    if (!keep_alive) ROS_INFO("keep_alive_rate <= 0: triads are sent only when they change");
 
     // subscribe to stamped-pose publications
     ros::Subscriber pose_sub = nh.subscribe("triad_display_pose", 1, poseCB);
-    ros::Publisher vis_pub = nh.advertise<visualization_msgs::Marker>("triad_display", 1);
-    init_markers();
+    //queue deep enough to accept a burst of named poses, e.g. a full set of grasp frames
+    ros::Subscriber named_pose_sub = nh.subscribe("triad_display_named_pose", 1000, namedPoseCB);
+    ros::Publisher vis_pub = nh.advertise<visualization_msgs::MarkerArray>("triad_display_array", 1);
+    init_arrow_templates();
+
+    //show the default triad at a legal (if boring) pose until a pose arrives
+    geometry_msgs::PoseStamped init_pose;
+    init_pose.header.stamp = ros::Time::now();
+    init_pose.header.frame_id = "world";
+    init_pose.pose.orientation.w = 1;
+    update_triad(g_default_triad_name, init_pose);
 
     ros::Rate timer(20); //timer to run at 20 Hz
-
-
+    ros::Time last_full_publish = ros::Time::now();
 
     while (ros::ok()) {
-        update_arrows();
-        vis_pub.publish(arrow_marker_x); //publish the marker
-        ros::Duration(0.01).sleep();
-        vis_pub.publish(arrow_marker_y); //publish the marker
-        ros::Duration(0.01).sleep();
-        vis_pub.publish(arrow_marker_z); //publish the marker
         ros::spinOnce(); //let callbacks perform an update
+        ros::Time now = ros::Time::now();
+        if (keep_alive && now - last_full_publish > keep_alive_period) {
+            publish_triads(vis_pub, true);
+            last_full_publish = now;
+        } else if (g_any_changed || g_any_removed) {
+            publish_triads(vis_pub, false);
+        }
         timer.sleep();
     }
 }
 
-
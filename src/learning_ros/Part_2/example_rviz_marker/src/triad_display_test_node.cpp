@@ -3,7 +3,7 @@
 // use this to illustrate functionality of triad_display, which displays a triad of axes as an rviz marker
 // at a published pose;  pose origin rises in a spiral while orientation points x-axis tangent to spiral
 // and z-axis up
-// view result in rviz by adding a marker on topic "/triad_display".  Set the rviz frame to "world"
+// view result in rviz by adding a MarkerArray display on topic "/triad_display_array".  Set the rviz frame to "world"
 
 #include<ros/ros.h>
 #include<geometry_msgs/PoseStamped.h>
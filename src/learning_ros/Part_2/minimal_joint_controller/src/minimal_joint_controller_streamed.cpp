@@ -0,0 +1,200 @@
+// minimal_joint_controller_streamed: a multi-joint variant of minimal_joint_controller
+// the original controller makes two blocking Gazebo service calls per cycle
+// (get_joint_properties and apply_joint_effort); here, joint state is instead
+// received from a streamed sensor_msgs/JointState topic.  All joint efforts are also
+// published once per cycle in a single message on topic "joint_effort_cmds"; note that nothing
+// in this repository subscribes to that topic--it is output only, for logging, or for a
+// topic-based effort interface, if one is added.  Efforts are applied to Gazebo via a persistent
+// connection to /gazebo/apply_joint_effort, which still costs one blocking round trip per joint
+// per cycle; that round trip, not the loop rate, limits the achievable rate
+// per-cycle latency (age of newest joint state when the effort is sent) and loop compute
+// time are published on topic "controller_latency" as a Float64MultiArray:
+//   [state_age, compute_time, max_state_age, mean_state_age] (all in seconds)
+//
+// parameters (private namespace, all optional):
+//   ~joint_names: list of joints to servo (default: [joint1])
+//   ~Kp, ~Kv: controller gains (default: 10.0, 3.0), applied to every joint
+//   ~rate: control-loop rate in Hz (default: 100, as in minimal_joint_controller)
+//   ~use_effort_service: if true, apply efforts through /gazebo/apply_joint_effort (default: true);
+//      if false, efforts are only published on joint_effort_cmds
+// command inputs:
+//   pos_cmd (std_msgs/Float64): setpoint for the first joint (same interface as minimal_joint_controller)
+//   pos_cmds (std_msgs/Float64MultiArray): setpoints for all joints, in the order of ~joint_names
+
+#include <ros/ros.h> //ALWAYS need to include this
+#include <gazebo_msgs/ApplyJointEffort.h>
+#include <sensor_msgs/JointState.h>
+#include <std_msgs/Float64.h>
+#include <std_msgs/Float64MultiArray.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <math.h>
+
+using namespace std;
+
+double min_periodicity(double theta_val) {
+    double periodic_val = theta_val;
+    while (periodic_val > M_PI) {
+        periodic_val -= 2 * M_PI;
+    }
+    while (periodic_val< -M_PI) {
+        periodic_val += 2 * M_PI;
+    }
+    return periodic_val;
+}
+
+//globals shared between callbacks and the control loop:
+vector<string> g_joint_names;
+vector<double> g_q, g_qdot; //latest joint state, in order of g_joint_names
+vector<double> g_pos_cmds; //setpoints, in order of g_joint_names
+vector<int> g_msg_to_ctl_index; //maps index in incoming JointState msg to controlled-joint index (-1 = not controlled)
+vector<string> g_cached_msg_names; //name list for which g_msg_to_ctl_index is valid
+ros::Time g_state_stamp; //stamp of most recent joint state
+bool g_got_state = false;
+
+//rebuild the name->index mapping only when the publisher's joint list changes
+void update_joint_index_map(const vector<string>& msg_names) {
+    if (msg_names == g_cached_msg_names) return; //usual case: nothing to do
+    g_cached_msg_names = msg_names;
+    map<string, int> ctl_index;
+    for (int i = 0; i < g_joint_names.size(); i++) ctl_index[g_joint_names[i]] = i;
+    g_msg_to_ctl_index.assign(msg_names.size(), -1);
+    for (int i = 0; i < msg_names.size(); i++) {
+        map<string, int>::iterator it = ctl_index.find(msg_names[i]);
+        if (it != ctl_index.end()) g_msg_to_ctl_index[i] = it->second;
+    }
+    ROS_INFO("joint_states name list changed; remapped %d joint names", (int) msg_names.size());
+}
+
+void jointStatesCB(const sensor_msgs::JointState::ConstPtr& js_msg) {
+    update_joint_index_map(js_msg->name);
+    int n_pos = js_msg->position.size();
+    int n_vel = js_msg->velocity.size();
+    for (int i = 0; i < g_msg_to_ctl_index.size(); i++) {
+        int j = g_msg_to_ctl_index[i];
+        if (j < 0) continue;
+        if (i < n_pos) g_q[j] = js_msg->position[i];
+        if (i < n_vel) g_qdot[j] = js_msg->velocity[i];
+    }
+    g_state_stamp = js_msg->header.stamp;
+    if (g_state_stamp.isZero()) g_state_stamp = ros::Time::now(); //some publishers do not stamp
+    g_got_state = true;
+}
+
+void posCmdCB(const std_msgs::Float64& pos_cmd_msg) {
+    ROS_INFO("received value of pos_cmd is: %f", pos_cmd_msg.data);
+    g_pos_cmds[0] = pos_cmd_msg.data;
+}
+
+void posCmdsCB(const std_msgs::Float64MultiArray& pos_cmds_msg) {
+    int n = pos_cmds_msg.data.size();
+    if (n != g_pos_cmds.size()) {
+        ROS_WARN("pos_cmds has %d values, but %d joints are controlled; ignoring", n, (int) g_pos_cmds.size());
+        return;
+    }
+    for (int i = 0; i < n; i++) g_pos_cmds[i] = pos_cmds_msg.data[i];
+}
+
+int main(int argc, char **argv) {
+    //initializations:
+    ros::init(argc, argv, "minimal_joint_controller_streamed");
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+
+    double Kp, Kv, loop_rate;
+    bool use_effort_service;
+    if (!nh_private.getParam("joint_names", g_joint_names) || g_joint_names.empty()) {
+        g_joint_names.clear();
+        g_joint_names.push_back("joint1");
+    }
+    nh_private.param("Kp", Kp, 10.0);
+    nh_private.param("Kv", Kv, 3.0);
+    nh_private.param("rate", loop_rate, 100.0);
+    nh_private.param("use_effort_service", use_effort_service, true);
+
+    int njnts = g_joint_names.size();
+    g_q.assign(njnts, 0.0);
+    g_qdot.assign(njnts, 0.0);
+    g_pos_cmds.assign(njnts, 0.0);
+    double dt = 1.0 / loop_rate;
+    ROS_INFO("controlling %d joints at %f Hz", njnts, loop_rate);
+
+    // persistent connection: the service link is set up once, rather than per call
+    ros::ServiceClient set_trq_client;
+    if (use_effort_service) {
+        ros::Duration half_sec(0.5);
+        while (!ros::service::exists("/gazebo/apply_joint_effort", true)) {
+            ROS_WARN("waiting for apply_joint_effort service");
+            half_sec.sleep();
+        }
+        set_trq_client = nh.serviceClient<gazebo_msgs::ApplyJointEffort>("/gazebo/apply_joint_effort", true);
+    }
+    gazebo_msgs::ApplyJointEffort effort_cmd_srv_msg;
+    effort_cmd_srv_msg.request.duration = ros::Duration(dt);
+
+    //all joint efforts go out in one message per cycle (no subscriber in this repo; see top)
+    ros::Publisher effort_publisher = nh.advertise<sensor_msgs::JointState>("joint_effort_cmds", 1);
+    ros::Publisher latency_publisher = nh.advertise<std_msgs::Float64MultiArray>("controller_latency", 1);
+    ros::Subscriber joint_state_subscriber = nh.subscribe("joint_states", 1, jointStatesCB,
+            ros::TransportHints().tcpNoDelay());
+    ros::Subscriber pos_cmd_subscriber = nh.subscribe("pos_cmd", 1, posCmdCB);
+    ros::Subscriber pos_cmds_subscriber = nh.subscribe("pos_cmds", 1, posCmdsCB);
+
+    sensor_msgs::JointState effort_msg;
+    effort_msg.name = g_joint_names;
+    effort_msg.effort.resize(njnts);
+    std_msgs::Float64MultiArray latency_msg;
+    latency_msg.data.resize(4);
+
+    double max_state_age = 0.0;
+    double sum_state_age = 0.0;
+    long int ncycles = 0;
+    ros::Rate rate_timer(loop_rate);
+
+    //here is the main controller loop:
+    while (ros::ok()) {
+        ros::spinOnce(); //pick up the newest joint state and setpoints
+        if (!g_got_state) {
+            rate_timer.sleep();
+            continue;
+        }
+        ros::Time t_start = ros::Time::now();
+        for (int i = 0; i < njnts; i++) {
+            double q_err = min_periodicity(g_pos_cmds[i] - g_q[i]); //jnt angle err; watch for periodicity
+            effort_msg.effort[i] = Kp * q_err - Kv * g_qdot[i];
+        }
+        effort_msg.header.stamp = t_start;
+        effort_publisher.publish(effort_msg);
+
+        if (use_effort_service) {
+            for (int i = 0; i < njnts; i++) {
+                effort_cmd_srv_msg.request.joint_name = g_joint_names[i];
+                effort_cmd_srv_msg.request.effort = effort_msg.effort[i];
+                if (!set_trq_client.isValid()) { //reconnect if the persistent link dropped
+                    ROS_WARN("lost connection to apply_joint_effort; reconnecting");
+                    set_trq_client = nh.serviceClient<gazebo_msgs::ApplyJointEffort>("/gazebo/apply_joint_effort", true);
+                }
+                if (!set_trq_client.call(effort_cmd_srv_msg) || !effort_cmd_srv_msg.response.success)
+                    ROS_WARN("service call to apply_joint_effort failed for %s", g_joint_names[i].c_str());
+            }
+        }
+
+        //latency bookkeeping: how old was the state we acted on, and how long did this cycle take
+        ros::Time t_end = ros::Time::now();
+        double state_age = (t_end - g_state_stamp).toSec();
+        double compute_time = (t_end - t_start).toSec();
+        ncycles++;
+        sum_state_age += state_age;
+        if (state_age > max_state_age) max_state_age = state_age;
+        latency_msg.data[0] = state_age;
+        latency_msg.data[1] = compute_time;
+        latency_msg.data[2] = max_state_age;
+        latency_msg.data[3] = sum_state_age / ncycles;
+        latency_publisher.publish(latency_msg);
+
+        if (compute_time > dt)
+            ROS_WARN_THROTTLE(1.0, "control cycle took %f sec; exceeds period of %f sec", compute_time, dt);
+        rate_timer.sleep();
+    }
+}
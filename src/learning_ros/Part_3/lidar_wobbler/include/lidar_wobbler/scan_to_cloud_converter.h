@@ -0,0 +1,68 @@
+// scan_to_cloud_converter.h header file; doxygen comments follow //
+/// Include this file in "scan_to_cloud_converter.cpp", and in any main that uses this library.
+/// This class converts LaserScan messages into 3-D points expressed in a fixed frame (e.g. "world"),
+/// for a moving (e.g. wobbling) LIDAR.
+/// Beam unit vectors are tabulated once and reused until the scan geometry changes.
+/// Since the LIDAR moves during a sweep, the LIDAR pose is looked up at the first and last ping
+/// times of the scan, and each ping is transformed by the pose interpolated to its own time stamp.
+/// Results are written into a reusable PointCloud2 (x, y, z float fields), containing only valid pings.
+
+#ifndef SCAN_TO_CLOUD_CONVERTER_H_
+#define SCAN_TO_CLOUD_CONVERTER_H_
+
+#include <string>
+#include <vector>
+#include <math.h>
+#include <ros/ros.h>
+#include <Eigen/Eigen>
+#include <Eigen/Geometry>
+#include <tf/transform_listener.h>
+#include <sensor_msgs/LaserScan.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <xform_utils/xform_utils.h>
+
+class ScanToCloudConverter {
+public:
+    /** provide a pointer to a transform listener (to be shared with the caller) and the name of the frame
+     * in which points should be expressed
+     */
+    ScanToCloudConverter(tf::TransformListener* listener_ptr, std::string target_frame = "world");
+
+    /// ignore pings beyond this range (in addition to the scan's own range_max); default 5m
+    void set_max_range(double max_range) { max_range_ = max_range; };
+    /// max time to wait for the transform at the last ping of a scan; default 0.1 sec
+    void set_tf_timeout(double timeout) { tf_timeout_ = ros::Duration(timeout); };
+
+    /** convert a scan into points w/rt the target frame; returns false if the needed transforms are not available.
+     * cloud is resized only as needed, so re-using the same cloud object avoids re-allocation
+     */
+    bool convert(const sensor_msgs::LaserScan& scan, sensor_msgs::PointCloud2& cloud);
+
+    /// points computed by the most recent (successful) convert(), as columns: w/rt target frame
+    const Eigen::Matrix3Xf& get_points() const { return pts_wrt_target_; };
+    int get_num_points() const { return npts_valid_; };
+
+private:
+    tf::TransformListener* listener_ptr_;
+    XformUtils xform_utils_;
+    std::string target_frame_;
+    double max_range_;
+    ros::Duration tf_timeout_;
+
+    //beam table: unit vectors for each ping, valid for the scan geometry recorded below
+    Eigen::Matrix2Xf beam_dirs_;
+    double table_angle_min_, table_angle_increment_;
+    int table_npts_;
+
+    //working buffers, reused from scan to scan
+    std::vector<int> valid_beams_; //beam index of each valid ping
+    Eigen::Matrix3Xf pts_wrt_lidar_;
+    Eigen::Matrix3Xf pts_wrt_target_;
+    int npts_valid_;
+
+    void update_beam_table(const sensor_msgs::LaserScan& scan);
+    bool lookup_pose(const std::string& lidar_frame, const ros::Time& stamp, Eigen::Affine3d& pose);
+    void fill_cloud(const std_msgs::Header& header, sensor_msgs::PointCloud2& cloud);
+};
+
+#endif
@@ -0,0 +1,79 @@
+// sweep_assembler.h header file; doxygen comments follow //
+/// Include this file in "sweep_assembler.cpp", and in any main that uses this library.
+/// This class assembles transformed LIDAR scans into full 3-D sweeps of a wobbling LIDAR, in-process
+/// (an alternative to polling the laser_assembler service).
+/// A sweep's time window ends each time the wobble joint reverses direction.  Each scan goes to the sweep
+/// whose window contains the scan's stamp, so scans that arrive after the reversal is seen, but were taken
+/// before it, still land in the right sweep; the sweep is complete (and available as a PointCloud2) once a scan
+/// stamped after its window arrives.  Sweeps are held in a fixed ring of buffers, and each sweep holds at most
+/// max_pts_per_sweep points, so memory is bounded.  Optionally, points are merged into voxels
+/// (one centroid per occupied voxel) as they arrive.
+
+#ifndef SWEEP_ASSEMBLER_H_
+#define SWEEP_ASSEMBLER_H_
+
+#include <vector>
+#include <string>
+#include <ros/ros.h>
+#include <Eigen/Eigen>
+#include <boost/unordered_map.hpp>
+#include <boost/cstdint.hpp>
+#include <sensor_msgs/PointCloud2.h>
+
+class SweepAssembler {
+public:
+    /** num_sweeps: number of sweeps retained in the ring (including the one in progress; at least 2)
+     * max_pts_per_sweep: points (or voxels) beyond this count are dropped from a sweep
+     * voxel_size: if >0, points are merged into cubic voxels of this edge length (in meters)
+     */
+    SweepAssembler(int num_sweeps = 3, int max_pts_per_sweep = 200000, double voxel_size = 0.0);
+
+    /** report the wobble-joint angle; returns true if this closes the time window of the sweep in progress
+     * (i.e. the joint reversed direction by more than the hysteresis angle), in which case a new one is begun.
+     * samples not stamped later than the last one accepted are ignored
+     */
+    bool update_phase(double joint_angle, const ros::Time& stamp);
+    /// min joint motion (rad) opposite the current direction to declare a reversal; default 0.01
+    void set_reversal_hysteresis(double hysteresis) { hysteresis_ = hysteresis; };
+
+    /** append the first npts columns of pts (already w/rt the assembly frame), from a scan w/ the given stamp,
+     * to the sweep whose time window contains that stamp.  scans are assumed to arrive in stamp order: returns
+     * true if this scan is past the window of a closed sweep, which completes that sweep
+     */
+    bool add_points(const Eigen::Matrix3Xf& pts, int npts, const ros::Time& stamp);
+
+    /** write a completed sweep into cloud: age=0 is the most recently completed sweep, age=1 the one before, etc.
+     * returns false if no such sweep exists.  cloud is resized only as needed
+     */
+    bool get_sweep(int age, const std::string& frame_id, sensor_msgs::PointCloud2& cloud) const;
+    int get_num_completed_sweeps() const { return num_completed_; };
+
+private:
+    //one sweep: points (or voxel sums, w/ 4th element = count), plus the voxel key->slot map
+    struct Sweep {
+        std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > pts;
+        boost::unordered_map<boost::int64_t, int> voxel_slots;
+        ros::Time t_start, t_end;
+        int num_dropped;
+    };
+    std::vector<Sweep> ring_;
+    int current_; //index of the sweep in progress
+    int num_closed_; //sweeps whose time window has ended
+    int num_completed_; //closed sweeps that will get no more scans
+    int max_pts_per_sweep_;
+    double voxel_size_;
+    float inv_voxel_size_;
+
+    //wobble phase tracking
+    double hysteresis_;
+    bool have_phase_;
+    double extreme_angle_; //furthest angle reached in the current direction
+    int direction_; //+1, -1, or 0 if not yet known
+    ros::Time last_stamp_; //of the last joint sample accepted
+
+    void start_new_sweep(const ros::Time& stamp);
+    void complete_sweep();
+    boost::int64_t voxel_key(const Eigen::Vector3f& pt) const;
+};
+
+#endif
@@ -0,0 +1,134 @@
+// scan_to_cloud_converter.cpp
+// implementation of ScanToCloudConverter; see header file for usage
+#include <lidar_wobbler/scan_to_cloud_converter.h>
+#include <string.h> //for memcpy
+using namespace std;
+
+ScanToCloudConverter::ScanToCloudConverter(tf::TransformListener* listener_ptr, string target_frame) :
+listener_ptr_(listener_ptr), target_frame_(target_frame) {
+    max_range_ = 5.0; //default: same as original lidar_transformer
+    tf_timeout_ = ros::Duration(0.1);
+    table_npts_ = 0;
+    table_angle_min_ = 0.0;
+    table_angle_increment_ = 0.0;
+    npts_valid_ = 0;
+}
+
+//recompute the cos/sin table only if the scan geometry differs from the one tabulated
+void ScanToCloudConverter::update_beam_table(const sensor_msgs::LaserScan& scan) {
+    int npts = scan.ranges.size();
+    if (npts == table_npts_ && scan.angle_min == table_angle_min_ && scan.angle_increment == table_angle_increment_) {
+        return;
+    }
+    ROS_INFO("computing beam table for %d pings", npts);
+    beam_dirs_.resize(2, npts);
+    for (int i = 0; i < npts; i++) {
+        double ang = scan.angle_min + i * scan.angle_increment; //polar angle of this ping
+        beam_dirs_(0, i) = cos(ang);
+        beam_dirs_(1, i) = sin(ang);
+    }
+    table_npts_ = npts;
+    table_angle_min_ = scan.angle_min;
+    table_angle_increment_ = scan.angle_increment;
+    pts_wrt_lidar_.resize(3, npts);
+    pts_wrt_target_.resize(3, npts);
+    valid_beams_.resize(npts);
+}
+
+bool ScanToCloudConverter::lookup_pose(const string& lidar_frame, const ros::Time& stamp, Eigen::Affine3d& pose) {
+    tf::StampedTransform stfLidar2Target;
+    try {
+        listener_ptr_->waitForTransform(target_frame_, lidar_frame, stamp, tf_timeout_);
+        listener_ptr_->lookupTransform(target_frame_, lidar_frame, stamp, stfLidar2Target);
+    } catch (tf::TransformException &exception) {
+        ROS_WARN("%s", exception.what());
+        return false;
+    }
+    pose = xform_utils_.transformTFToAffine3d(xform_utils_.get_tf_from_stamped_tf(stfLidar2Target));
+    return true;
+}
+
+bool ScanToCloudConverter::convert(const sensor_msgs::LaserScan& scan, sensor_msgs::PointCloud2& cloud) {
+    update_beam_table(scan);
+    const int npts = scan.ranges.size();
+    const float r_max = (max_range_ < scan.range_max) ? max_range_ : scan.range_max;
+    const float r_min = scan.range_min;
+
+    //gather valid pings, as points in the LIDAR frame (z=0: all pings are in the LIDAR x-y plane)
+    int nvalid = 0;
+    for (int i = 0; i < npts; i++) {
+        float r = scan.ranges[i];
+        if (r >= r_min && r < r_max) { //false for NaN and inf
+            //if range is too long, LIDAR is nearly parallel to the ground plane, so skip this ping
+            valid_beams_[nvalid] = i;
+            pts_wrt_lidar_(0, nvalid) = r * beam_dirs_(0, i);
+            pts_wrt_lidar_(1, nvalid) = r * beam_dirs_(1, i);
+            pts_wrt_lidar_(2, nvalid) = 0.0;
+            nvalid++;
+        }
+    }
+
+    //LIDAR pose at first and last ping; pings are time_increment apart
+    ros::Time t_first = scan.header.stamp;
+    ros::Time t_last = t_first + ros::Duration(scan.time_increment * (npts - 1));
+    Eigen::Affine3d pose_first, pose_last;
+    if (!lookup_pose(scan.header.frame_id, t_first, pose_first)) return false;
+    bool interpolate = (t_last > t_first);
+    if (interpolate && !lookup_pose(scan.header.frame_id, t_last, pose_last)) return false;
+
+    if (!interpolate) {
+        //all pings share one pose: transform all points with a single matrix product
+        Eigen::Affine3f A = pose_first.cast<float>();
+        pts_wrt_target_.leftCols(nvalid).noalias() = A.linear() * pts_wrt_lidar_.leftCols(nvalid);
+        pts_wrt_target_.leftCols(nvalid).colwise() += A.translation();
+    } else {
+        //interpolate the pose to the time of each ping: translation linearly, and rotation
+        //as a fraction of the (small) relative rotation between first and last poses.
+        //the pings are evenly spaced, so each one is a fixed increment (dR_ping, dp_ping) past the one before
+        Eigen::AngleAxisd dR(pose_first.linear().transpose() * pose_last.linear()); //first to last pose, in first-pose frame
+        double frac_per_ping = 1.0 / (npts - 1);
+        Eigen::Matrix3d dR_ping = Eigen::AngleAxisd(frac_per_ping * dR.angle(), dR.axis()).toRotationMatrix();
+        Eigen::Vector3d dp_ping = frac_per_ping * (pose_last.translation() - pose_first.translation());
+        Eigen::Matrix3d R = pose_first.linear();
+        Eigen::Vector3d p = pose_first.translation();
+        int i_ping = 0; //ping at which R and p apply
+        for (int j = 0; j < nvalid; j++) {
+            for (; i_ping < valid_beams_[j]; i_ping++) {
+                R = R * dR_ping;
+                p += dp_ping;
+            }
+            pts_wrt_target_.col(j) = (R * pts_wrt_lidar_.col(j).cast<double>() + p).cast<float>();
+        }
+    }
+    npts_valid_ = nvalid;
+    std_msgs::Header header = scan.header;
+    header.frame_id = target_frame_;
+    fill_cloud(header, cloud);
+    return true;
+}
+
+//write the points into a dense, unorganized cloud of (x, y, z) floats
+void ScanToCloudConverter::fill_cloud(const std_msgs::Header& header, sensor_msgs::PointCloud2& cloud) {
+    if (cloud.fields.size() != 3) {
+        const char* names[3] = {"x", "y", "z"};
+        cloud.fields.resize(3);
+        for (int i = 0; i < 3; i++) {
+            cloud.fields[i].name = names[i];
+            cloud.fields[i].offset = 4 * i;
+            cloud.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+            cloud.fields[i].count = 1;
+        }
+        cloud.is_bigendian = false;
+        cloud.point_step = 12;
+    }
+    cloud.header = header;
+    cloud.height = 1;
+    cloud.width = npts_valid_;
+    cloud.row_step = cloud.point_step * npts_valid_;
+    cloud.is_dense = true;
+    cloud.data.resize(cloud.row_step); //keeps capacity if the cloud object is re-used
+    if (npts_valid_ > 0) {
+        //Matrix3Xf is column-major, so its columns are already packed x,y,z triples
+        memcpy(&cloud.data[0], pts_wrt_target_.data(), cloud.row_step);
+    }
+}
@@ -0,0 +1,172 @@
+// sweep_assembler.cpp
+// implementation of SweepAssembler; see header file for usage
+#include <lidar_wobbler/sweep_assembler.h>
+#include <math.h>
+#include <string.h> //for memcpy
+using namespace std;
+
+SweepAssembler::SweepAssembler(int num_sweeps, int max_pts_per_sweep, double voxel_size) {
+    if (num_sweeps < 2) num_sweeps = 2; //need at least one completed sweep plus the one in progress
+    ring_.resize(num_sweeps);
+    for (int i = 0; i < num_sweeps; i++) {
+        ring_[i].num_dropped = 0;
+    }
+    current_ = 0;
+    num_closed_ = 0;
+    num_completed_ = 0;
+    max_pts_per_sweep_ = max_pts_per_sweep;
+    voxel_size_ = voxel_size;
+    inv_voxel_size_ = (voxel_size > 0.0) ? 1.0 / voxel_size : 0.0;
+    hysteresis_ = 0.01;
+    have_phase_ = false;
+    extreme_angle_ = 0.0;
+    direction_ = 0;
+}
+
+//pack 3 signed 21-bit voxel indices into one key; +/-1M voxels per axis is plenty for a LIDAR's range
+boost::int64_t SweepAssembler::voxel_key(const Eigen::Vector3f& pt) const {
+    const boost::int64_t mask = (1 << 21) - 1;
+    boost::int64_t ix = (boost::int64_t) floorf(pt[0] * inv_voxel_size_);
+    boost::int64_t iy = (boost::int64_t) floorf(pt[1] * inv_voxel_size_);
+    boost::int64_t iz = (boost::int64_t) floorf(pt[2] * inv_voxel_size_);
+    return ((ix & mask) << 42) | ((iy & mask) << 21) | (iz & mask);
+}
+
+//the oldest closed sweep will get no more scans
+void SweepAssembler::complete_sweep() {
+    int nring = ring_.size();
+    const Sweep &sweep = ring_[(current_ - (num_closed_ - num_completed_) + nring) % nring];
+    if (sweep.num_dropped > 0) {
+        ROS_WARN("sweep exceeded %d points; dropped %d", max_pts_per_sweep_, sweep.num_dropped);
+    }
+    num_completed_++;
+}
+
+void SweepAssembler::start_new_sweep(const ros::Time& stamp) {
+    ring_[current_].t_end = stamp;
+    num_closed_++;
+    current_ = (current_ + 1) % ring_.size();
+    //if no scans arrived for a whole ring of sweeps, the oldest closed one is about to be recycled
+    if (num_closed_ - num_completed_ >= (int) ring_.size()) complete_sweep();
+    //recycle the oldest buffer; clear() keeps allocated capacity
+    Sweep &sweep = ring_[current_];
+    sweep.pts.clear();
+    sweep.voxel_slots.clear();
+    sweep.num_dropped = 0;
+    sweep.t_start = stamp;
+}
+
+bool SweepAssembler::update_phase(double joint_angle, const ros::Time& stamp) {
+    if (have_phase_ && stamp <= last_stamp_) return false; //stale or repeated sample
+    last_stamp_ = stamp;
+    if (!have_phase_) {
+        have_phase_ = true;
+        extreme_angle_ = joint_angle;
+        ring_[current_].t_start = stamp;
+        return false;
+    }
+    double delta = joint_angle - extreme_angle_;
+    if (direction_ == 0) { //direction not yet established
+        if (fabs(delta) > hysteresis_) {
+            direction_ = (delta > 0) ? 1 : -1;
+            extreme_angle_ = joint_angle;
+        }
+        return false;
+    }
+    if (delta * direction_ > 0) { //still moving the same way; track the furthest excursion
+        extreme_angle_ = joint_angle;
+        return false;
+    }
+    if (fabs(delta) > hysteresis_) { //reversal: the sweep is complete
+        direction_ = -direction_;
+        extreme_angle_ = joint_angle;
+        start_new_sweep(stamp);
+        return true;
+    }
+    return false;
+}
+
+bool SweepAssembler::add_points(const Eigen::Matrix3Xf& pts, int npts, const ros::Time& stamp) {
+    //step back from the sweep in progress through the closed (not yet complete) sweeps to the one whose
+    //window contains stamp
+    int nring = ring_.size();
+    int num_open = num_closed_ - num_completed_;
+    int back = 0;
+    while (back < num_open && stamp < ring_[(current_ - back + nring) % nring].t_start) back++;
+    if (stamp < ring_[(current_ - back + nring) % nring].t_start) {
+        return false; //belongs to a sweep that is already complete; too late
+    }
+    //scans arrive in stamp order, so the closed sweeps before this one get no more scans
+    bool completed = false;
+    while (num_closed_ - num_completed_ > back) {
+        complete_sweep();
+        completed = true;
+    }
+    Sweep &sweep = ring_[(current_ - back + nring) % nring];
+    if (voxel_size_ <= 0.0) {
+        for (int i = 0; i < npts; i++) {
+            if ((int) sweep.pts.size() >= max_pts_per_sweep_) {
+                sweep.num_dropped += npts - i;
+                return completed;
+            }
+            sweep.pts.push_back(Eigen::Vector4f(pts(0, i), pts(1, i), pts(2, i), 1.0f));
+        }
+        return completed;
+    }
+    //voxelized: accumulate sums per occupied voxel; the centroid is computed on output
+    for (int i = 0; i < npts; i++) {
+        Eigen::Vector3f pt = pts.col(i);
+        boost::int64_t key = voxel_key(pt);
+        boost::unordered_map<boost::int64_t, int>::iterator it = sweep.voxel_slots.find(key);
+        if (it != sweep.voxel_slots.end()) {
+            Eigen::Vector4f &sum = sweep.pts[it->second];
+            sum.head<3>() += pt;
+            sum[3] += 1.0f;
+        } else if ((int) sweep.pts.size() < max_pts_per_sweep_) {
+            sweep.voxel_slots[key] = sweep.pts.size();
+            sweep.pts.push_back(Eigen::Vector4f(pt[0], pt[1], pt[2], 1.0f));
+        } else {
+            sweep.num_dropped++;
+        }
+    }
+    return completed;
+}
+
+bool SweepAssembler::get_sweep(int age, const std::string& frame_id, sensor_msgs::PointCloud2& cloud) const {
+    int nring = ring_.size();
+    int num_open = num_closed_ - num_completed_;
+    if (age < 0 || age >= num_completed_ || num_open + age >= nring - 1) return false;
+    int index = (current_ - 1 - num_open - age + 2 * nring) % nring;
+    const Sweep &sweep = ring_[index];
+
+    if (cloud.fields.size() != 3) {
+        const char* names[3] = {"x", "y", "z"};
+        cloud.fields.resize(3);
+        for (int i = 0; i < 3; i++) {
+            cloud.fields[i].name = names[i];
+            cloud.fields[i].offset = 4 * i;
+            cloud.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+            cloud.fields[i].count = 1;
+        }
+        cloud.is_bigendian = false;
+        cloud.point_step = 12;
+    }
+    int npts = sweep.pts.size();
+    cloud.header.frame_id = frame_id;
+    cloud.header.stamp = sweep.t_end;
+    cloud.height = 1;
+    cloud.width = npts;
+    cloud.row_step = cloud.point_step * npts;
+    cloud.is_dense = true;
+    cloud.data.resize(cloud.row_step);
+    float xyz[3];
+    for (int i = 0; i < npts; i++) {
+        const Eigen::Vector4f &p = sweep.pts[i];
+        float inv_n = 1.0f / p[3]; //1 for raw points; 1/count for voxel sums
+        xyz[0] = p[0] * inv_n;
+        xyz[1] = p[1] * inv_n;
+        xyz[2] = p[2] * inv_n;
+        memcpy(&cloud.data[12 * i], xyz, 12);
+    }
+    return true;
+}
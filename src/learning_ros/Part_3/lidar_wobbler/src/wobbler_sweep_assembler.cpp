@@ -0,0 +1,85 @@
+//wobbler_sweep_assembler: in-process alternative to laser_assembler + assemble_scans_test_client
+//each scan is converted to 3-D points w/rt world frame (see ScanToCloudConverter) and appended to the
+//sweep whose time window contains the scan's stamp; a sweep's window ends when the wobble joint reverses
+//direction, and the sweep is published on topic "wobbler_sweep_cloud" as soon as the first scan stamped
+//after that arrives--no service calls and no re-assembly of a time window
+//optional params (private namespace):
+//  ~voxel_size: if >0, merge points into voxels of this size (m); default 0 (keep all points)
+//  ~max_pts_per_sweep: bound on points (or voxels) per sweep; default 200000
+//  ~num_sweeps: number of sweep buffers in the ring; default 3
+//  ~joint_name: name of wobble joint in /lidar_wobbler/joint_states; default "joint1"
+//  ~joint_state_source: only use joint states from this node; default "/gazebo" (lidar_wobbler.launch also runs
+//    a joint_state_publisher, which publishes joint1=0 on the same topic); set to "" to accept any publisher
+#include <string>
+#include <vector>
+#include <ros/ros.h>
+#include <tf/transform_listener.h>
+#include <sensor_msgs/LaserScan.h>
+#include <sensor_msgs/JointState.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <lidar_wobbler/scan_to_cloud_converter.h>
+#include <lidar_wobbler/sweep_assembler.h>
+using namespace std;
+
+ScanToCloudConverter *g_converter_ptr;
+SweepAssembler *g_assembler_ptr;
+ros::Publisher g_sweep_publisher;
+sensor_msgs::PointCloud2 g_scan_cloud; //reused for every scan
+sensor_msgs::PointCloud2 g_sweep_cloud; //reused for every sweep
+string g_joint_name;
+string g_joint_state_source;
+int g_joint_index = -1; //index of the wobble joint in joint_states; found once
+
+void jointStateCallback(const ros::MessageEvent<sensor_msgs::JointState const>& event) {
+    if (!g_joint_state_source.empty() && event.getPublisherName() != g_joint_state_source) return;
+    const sensor_msgs::JointState::ConstPtr& js = event.getMessage();
+    int njnts = js->name.size();
+    if (g_joint_index < 0 || g_joint_index >= njnts || js->name[g_joint_index] != g_joint_name) {
+        g_joint_index = -1;
+        for (int i = 0; i < njnts; i++) {
+            if (js->name[i] == g_joint_name) g_joint_index = i;
+        }
+        if (g_joint_index < 0) return;
+    }
+    if (g_joint_index >= (int) js->position.size()) return;
+    g_assembler_ptr->update_phase(js->position[g_joint_index], js->header.stamp);
+}
+
+void scanCallback(const sensor_msgs::LaserScan::ConstPtr& scan_in) {
+    if (!g_converter_ptr->convert(*scan_in, g_scan_cloud)) {
+        ROS_WARN("could not transform scan; skipping it");
+        return;
+    }
+    if (g_assembler_ptr->add_points(g_converter_ptr->get_points(), g_converter_ptr->get_num_points(),
+            scan_in->header.stamp)) {
+        //this scan is past the end of a sweep: that sweep is complete, so publish it right away
+        g_assembler_ptr->get_sweep(0, "world", g_sweep_cloud);
+        g_sweep_publisher.publish(g_sweep_cloud);
+        ROS_INFO("published sweep %d with %d points", g_assembler_ptr->get_num_completed_sweeps(),
+                (int) g_sweep_cloud.width);
+    }
+}
+
+int main(int argc, char** argv) {
+    ros::init(argc, argv, "wobbler_sweep_assembler"); //node name
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+    double voxel_size;
+    int max_pts_per_sweep, num_sweeps;
+    nh_private.param("voxel_size", voxel_size, 0.0);
+    nh_private.param("max_pts_per_sweep", max_pts_per_sweep, 200000);
+    nh_private.param("num_sweeps", num_sweeps, 3);
+    nh_private.param<string>("joint_name", g_joint_name, "joint1");
+    nh_private.param<string>("joint_state_source", g_joint_state_source, "/gazebo");
+
+    tf::TransformListener listener;
+    g_converter_ptr = new ScanToCloudConverter(&listener, "world");
+    g_assembler_ptr = new SweepAssembler(num_sweeps, max_pts_per_sweep, voxel_size);
+    g_sweep_publisher = nh.advertise<sensor_msgs::PointCloud2>("wobbler_sweep_cloud", 1, true);
+    ros::Subscriber lidar_subscriber = nh.subscribe("/scan", 10, scanCallback);
+    ros::Subscriber joint_state_subscriber = nh.subscribe("/lidar_wobbler/joint_states", 10, jointStateCallback);
+    ROS_INFO("ready to assemble wobbler sweeps");
+    ros::spin(); //let the callbacks do all the work
+
+    return 0;
+}
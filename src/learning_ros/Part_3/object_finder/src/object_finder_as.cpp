@@ -30,8 +30,15 @@ private:
     bool find_upright_coke_can(float surface_height, geometry_msgs::PoseStamped &object_pose);
     bool find_toy_block(float surface_height, geometry_msgs::PoseStamped &object_pose);
     float find_table_height();
+    //table-plane tracking: the table does not move between goals, so keep its height, and verify it
+    //in each new snapshot with a sparse inlier check; do the full search only if the check fails
+    bool track_table_plane(bool &plane_was_cached);
+    double table_inlier_fraction(); //fraction of sampled pts in the search box that lie on the known plane
     double surface_height_;
     bool found_surface_height_;
+    double plane_inlier_fraction_; //value of table_inlier_fraction() when the plane was last found
+    int plane_check_stride_; //check every n'th kinect point
+    double plane_check_min_ratio_; //plane is verified if inlier fraction is at least this ratio of the stored fraction
 public:
     ObjectFinder(); //define the body of the constructor outside of class definition
 
@@ -50,7 +57,10 @@ object_finder_as_(nh_, "object_finder_action_service", boost::bind(&ObjectFinder
     object_finder_as_.start(); //start the server running
     tfListener_ = new tf::TransformListener; //create a transform listener
     found_surface_height_=false;
-    
+    plane_inlier_fraction_ = 0.0;
+    ros::NodeHandle nh_private("~");
+    nh_private.param("plane_check_stride", plane_check_stride_, 20);
+    nh_private.param("plane_check_min_ratio", plane_check_min_ratio_, 0.8);
 }
 
 //specialized function: DUMMY...JUST RETURN A HARD-CODED POSE; FIX THIS
@@ -126,6 +136,43 @@ float ObjectFinder::find_table_height() {
     return (table_height);
 }
 
+//hard-coded search range for the table: x= [0,1], y= [-0.5,0.5], z=[0.6,1.2] in steps of 0.005
+const double TABLE_X_MIN = 0.0, TABLE_X_MAX = 1.0, TABLE_Y_MIN = -0.5, TABLE_Y_MAX = 0.5;
+const double TABLE_Z_MIN = 0.6, TABLE_Z_MAX = 1.2, TABLE_DZ = 0.005;
+const double TABLE_INLIER_Z_EPS = 0.01; //tolerance of the sparse check; allows for sensor noise
+
+double ObjectFinder::table_inlier_fraction() {
+    int n_in_box;
+    int n_inliers = pclUtils_.count_z_plane_inliers_sampled(g_affine_kinect_wrt_base, TABLE_X_MIN, TABLE_X_MAX,
+            TABLE_Y_MIN, TABLE_Y_MAX, TABLE_Z_MIN, TABLE_Z_MAX, surface_height_, TABLE_INLIER_Z_EPS,
+            plane_check_stride_, n_in_box);
+    if (n_in_box == 0) return 0.0;
+    return ((double) n_inliers) / n_in_box;
+}
+
+//sets surface_height_, either by verifying the plane from a previous goal or by a full search;
+//returns true if the full kinect cloud was transformed (by the full search)
+bool ObjectFinder::track_table_plane(bool &plane_was_cached) {
+    plane_was_cached = false;
+    if (found_surface_height_ && plane_inlier_fraction_ > 0.0) {
+        double fraction = table_inlier_fraction();
+        ROS_INFO("table ht %f: inlier fraction %f; was %f", surface_height_, fraction, plane_inlier_fraction_);
+        if (fraction > 0.0 && fraction >= plane_check_min_ratio_ * plane_inlier_fraction_) {
+            plane_was_cached = true;
+            return false;
+        }
+        ROS_INFO("table plane check failed; searching");
+    }
+    ROS_INFO("transforming point cloud");
+    pclUtils_.transform_kinect_cloud(g_affine_kinect_wrt_base);
+    surface_height_ = pclUtils_.find_table_height(TABLE_X_MIN, TABLE_X_MAX, TABLE_Y_MIN, TABLE_Y_MAX,
+            TABLE_Z_MIN, TABLE_Z_MAX, TABLE_DZ);
+    found_surface_height_ = true; //remember this value for future goals
+    plane_inlier_fraction_ = table_inlier_fraction(); //reference value for checks of later snapshots
+    ROS_INFO("table ht: %f", surface_height_);
+    return true;
+}
+
 //specified surface height meaning is height of surface of table top
 
 void ObjectFinder::executeCB(const actionlib::SimpleActionServer<object_finder::objectFinderAction>::GoalConstPtr& goal) {
@@ -145,19 +192,24 @@ void ObjectFinder::executeCB(const actionlib::SimpleActionServer<object_finder::
         ROS_INFO("waiting for snapshot...");
     }
     
-    //if here, have a new cloud in *pclKinect_ptr_; transform this cloud to base-frame coords:
-    ROS_INFO("transforming point cloud");
-    pclUtils_.transform_kinect_cloud(g_affine_kinect_wrt_base);
-    // find tabletop...try different methods and time them
+    //if here, have a new cloud in *pclKinect_ptr_
+    bool cloud_transformed = false;
+    result_.plane_status = object_finder::objectFinderResult::PLANE_NOT_SEARCHED;
+    result_.plane_time = 0.0;
     if (!known_surface_ht) {
-        ros::Time tstart = ros::Time::now();
-        double table_ht;
-        //hard-coded search range: x= [0,1], y= [-0.5,0.5], z=[0.6,1.2] in steps of 0.005
-        table_ht = pclUtils_.find_table_height(0.0, 1, -0.5, 0.5, 0.6, 1.2, 0.005);
-        ROS_INFO("table ht: %f", table_ht);
-        ros::Time t3 = ros::Time::now();
-        surface_height_ = table_ht; //remember this value for potential future use
-        found_surface_height_ = true;
+        ros::WallTime tstart = ros::WallTime::now();
+        bool plane_was_cached;
+        cloud_transformed = track_table_plane(plane_was_cached);
+        result_.plane_time = (ros::WallTime::now() - tstart).toSec();
+        result_.plane_status = plane_was_cached ? object_finder::objectFinderResult::PLANE_CACHED
+                : object_finder::objectFinderResult::PLANE_RECOMPUTED;
+        ROS_INFO("table plane %s in %f sec", plane_was_cached ? "verified" : "recomputed", result_.plane_time);
+        surface_height = surface_height_;
+    }
+    //transform the full cloud to base-frame coords only if a finder needs it
+    if (object_id == ObjectIdCodes::TOY_BLOCK_ID && !cloud_transformed) {
+        ROS_INFO("transforming point cloud");
+        pclUtils_.transform_kinect_cloud(g_affine_kinect_wrt_base);
     }
     result_.object_id = goal->object_id; //by default, set the "found" object_id to the "requested" object_id
     //note--finder might change this ID, if warranted
@@ -0,0 +1,111 @@
+// cloud_to_image_projector.h header file; doxygen comments follow //
+/// Include this file in "cloud_to_image_projector.cpp", and in any main that uses this library.
+/// This class projects a point cloud onto a 2-D image plane (pinhole model), keeping the
+/// nearest range per pixel (a z-buffer), then renders range as gray-scale intensity.
+/// Projection and rendering are separate steps: the per-pixel ranges are cached, so changing
+/// the intensity window (range_min, range_max) only re-maps intensities and does not revisit the cloud.
+
+#ifndef CLOUD_TO_IMAGE_PROJECTOR_H_
+#define CLOUD_TO_IMAGE_PROJECTOR_H_
+
+#include <vector>
+#include <math.h>
+#include <opencv2/core/core.hpp>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+class CloudToImageProjector
+{
+public:
+    /** construct a projector for an image of width x height pixels, with a single focal length
+     * (in pixels) and the optical center at the image center
+     */
+    CloudToImageProjector(int width = 640, int height = 480, double focal_len = 520);
+    /** construct a projector with arbitrary intrinsics: fx, fy are focal lengths in pixels, and (cx, cy)
+     * is the optical center, in pixels, w/rt the upper-left corner (column, row)
+     */
+    CloudToImageProjector(int width, int height, double fx, double fy, double cx, double cy);
+
+    void set_intrinsics(int width, int height, double fx, double fy, double cx, double cy);
+    /** if enabled (default), an organized cloud with the same width and height as the image is assumed to have
+     * been captured with these intrinsics, so point (row, col) maps directly to pixel (row, col) and the
+     * per-point projection is skipped
+     */
+    void set_use_organized_layout(bool use_layout) { use_organized_layout_ = use_layout; };
+
+    /** project all points of a cloud (camera frame: z along optical axis) into the cached range image;
+     * where several points land on the same pixel, the nearest one wins.  NaN points are skipped.
+     * PointT may be any PCL point type with x, y, z fields
+     */
+    template <typename PointT>
+    void project(const pcl::PointCloud<PointT> &cloud);
+
+    /** map the cached ranges to gray levels: 255 at range_min, falling linearly to 0 at range_max;
+     * pixels with no point, or outside [range_min, range_max], are set to 0.
+     * image is (re)allocated as CV_8U, height x width, only if its size or type is wrong
+     */
+    void render(double range_min, double range_max, cv::Mat &image) const;
+
+    /// nearest range per pixel (CV_32F); 0 where no point projected
+    const cv::Mat& get_range_image() const { return range_image_; };
+    /// number of pixels that received at least one point in the most recent projection
+    int get_num_filled_pixels() const;
+
+private:
+    int width_, height_;
+    float fx_, fy_, cx_, cy_;
+    bool use_organized_layout_;
+    cv::Mat range_image_; //the z-buffer; reused from one projection to the next
+    std::vector<int> pixel_index_; //per-point target pixel (row*width+col), or -1; reused
+    std::vector<float> point_range_; //per-point range; reused
+
+    void reset_range_image();
+    void merge_into_range_image(int npts); //z-buffer pass over pixel_index_/point_range_
+};
+
+template <typename PointT>
+void CloudToImageProjector::project(const pcl::PointCloud<PointT> &cloud) {
+    reset_range_image();
+    const int npts = cloud.points.size();
+    const PointT *pts = npts > 0 ? &cloud.points[0] : NULL;
+    float *zbuf = range_image_.ptr<float>(0);
+
+    if (use_organized_layout_ && (int) cloud.height == height_ && (int) cloud.width == width_ && cloud.height > 1) {
+        //fast path: one point per pixel, no projection and no depth competition
+#pragma omp parallel for
+        for (int ipt = 0; ipt < npts; ipt++) {
+            const float x = pts[ipt].x, y = pts[ipt].y, z = pts[ipt].z;
+            const float r = sqrtf(x * x + y * y + z * z);
+            zbuf[ipt] = (r == r && z > 0.0f) ? r : 0.0f; //r==r is false for NaN
+        }
+        return;
+    }
+
+    //general path: first a data-parallel pass computing (pixel, range) per point, float precision throughout...
+    if ((int) pixel_index_.size() < npts) {
+        pixel_index_.resize(npts);
+        point_range_.resize(npts);
+    }
+    int *pix = pixel_index_.size() > 0 ? &pixel_index_[0] : NULL;
+    float *rng = point_range_.size() > 0 ? &point_range_[0] : NULL;
+    const float fx = fx_, fy = fy_, cx = cx_, cy = cy_;
+    const int width = width_, height = height_;
+#pragma omp parallel for
+    for (int ipt = 0; ipt < npts; ipt++) {
+        const float x = pts[ipt].x, y = pts[ipt].y, z = pts[ipt].z;
+        int index = -1;
+        if (z > 0.0f) { //also false for NaN
+            const float inv_z = 1.0f / z;
+            const float col = floorf(cx + fx * x * inv_z + 0.5f); //round to nearest pixel
+            const float row = floorf(cy + fy * y * inv_z + 0.5f);
+            if (col >= 0.0f && col < width && row >= 0.0f && row < height) //false for NaN x or y
+                index = (int) row * width + (int) col;
+        }
+        pix[ipt] = index;
+        rng[ipt] = sqrtf(x * x + y * y + z * z);
+    }
+    //...then a cheap serial z-buffer pass, so nearer points win regardless of order
+    merge_into_range_image(npts);
+}
+
+#endif
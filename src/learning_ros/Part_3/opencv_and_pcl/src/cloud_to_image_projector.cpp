@@ -0,0 +1,61 @@
+// cloud_to_image_projector.cpp
+// implementation of CloudToImageProjector; see header file for usage
+#include <opencv_and_pcl/cloud_to_image_projector.h>
+
+CloudToImageProjector::CloudToImageProjector(int width, int height, double focal_len) {
+    set_intrinsics(width, height, focal_len, focal_len, 0.5 * width, 0.5 * height);
+    use_organized_layout_ = true;
+}
+
+CloudToImageProjector::CloudToImageProjector(int width, int height, double fx, double fy, double cx, double cy) {
+    set_intrinsics(width, height, fx, fy, cx, cy);
+    use_organized_layout_ = true;
+}
+
+void CloudToImageProjector::set_intrinsics(int width, int height, double fx, double fy, double cx, double cy) {
+    width_ = width;
+    height_ = height;
+    fx_ = fx;
+    fy_ = fy;
+    cx_ = cx;
+    cy_ = cy;
+    range_image_.create(height_, width_, CV_32F);
+    range_image_.setTo(cv::Scalar(0));
+}
+
+void CloudToImageProjector::reset_range_image() {
+    range_image_.create(height_, width_, CV_32F); //no-op if already allocated at this size
+    range_image_.setTo(cv::Scalar(0));
+}
+
+void CloudToImageProjector::merge_into_range_image(int npts) {
+    float *zbuf = range_image_.ptr<float>(0);
+    const int *pix = npts > 0 ? &pixel_index_[0] : NULL;
+    const float *rng = npts > 0 ? &point_range_[0] : NULL;
+    for (int ipt = 0; ipt < npts; ipt++) {
+        const int index = pix[ipt];
+        if (index < 0) continue;
+        const float r = rng[ipt];
+        if (zbuf[index] == 0.0f || r < zbuf[index]) zbuf[index] = r;
+    }
+}
+
+void CloudToImageProjector::render(double range_min, double range_max, cv::Mat &image) const {
+    image.create(height_, width_, CV_8U);
+    const float r_min = range_min;
+    const float r_max = range_max;
+    const float scale = (range_max > range_min) ? 255.0 / (range_max - range_min) : 0.0;
+#pragma omp parallel for
+    for (int row = 0; row < height_; row++) {
+        const float *zrow = range_image_.ptr<float>(row);
+        uchar *irow = image.ptr<uchar>(row);
+        for (int col = 0; col < width_; col++) {
+            const float r = zrow[col];
+            irow[col] = (r >= r_min && r <= r_max && r > 0.0f) ? (uchar) (scale * (r_max - r)) : 0;
+        }
+    }
+}
+
+int CloudToImageProjector::get_num_filled_pixels() const {
+    return cv::countNonZero(range_image_);
+}
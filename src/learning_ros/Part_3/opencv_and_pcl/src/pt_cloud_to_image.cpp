@@ -24,6 +24,8 @@
 #include <pcl/common/common_headers.h>
 #include <pcl-1.7/pcl/point_cloud.h>
 #include <pcl-1.7/pcl/PCLHeader.h>
+#include <pcl/io/pcd_io.h>
+#include <opencv_and_pcl/cloud_to_image_projector.h>
 
 using namespace std;
 //will use filter objects "passthrough" and "voxel_grid" in this example
@@ -49,7 +51,6 @@ double z_max=1.5; // max dist = furthest point of interest on object; will assig
 //cv::Mat g_image(Nu,Nv,CV_8U,cv::Scalar(50)); //create image, set encoding and size, init pixels to default val
 cv::Mat g_image(Nu,Nv,CV_8U,cv::Scalar(0)); //create image, set encoding and size, init pixels to default val
 
-cv::Mat g_pts_per_cell(Nu,Nv,CV_8U,cv::Scalar(0)); //like above, but this matrix will hold num pts/cell
 
 
 static const std::string OPENCV_WINDOW = "Image window";
@@ -123,52 +124,25 @@ int main(int argc, char** argv)
   std::cout << "Loaded "
             << npts_cloud
             << " data points from file "<<fname<<std::endl;
-  Eigen::Vector3f cloud_pt; 
-  double x,y,z;
-  double v,vc,u,uc;
-  int i,j;
-  uc = Nu/2;
-  vc = Nv/2;
-  uchar gray_level;
-  double r;
- //projection:  given point (x,y,z) in CAMERA space (possibly result of filtering and zooming)
-    //compute gray-scale value based on z-coord;
-    //assign this value to pixel (i,j) in 2-D image based on: x/z = (u-u_c)/fx (where u and f are in pixels)
-    //  y/z = (v-v_c)/fy
+  //projection:  given point (x,y,z) in CAMERA space (possibly result of filtering and zooming)
+    //compute gray-scale value based on range;
+    //assign this value to pixel (row,col) in 2-D image based on: x/z = (col-c_x)/fx (where col and f are in pixels)
+    //  y/z = (row-c_y)/fy
     // choose Nu=u_max, Nv=v_max based on desired resolution,
     //and choose focal pt s.t.:  (x_max-x_min)/z_min = u_max/fx;     (y_max-y_min)/z_min = v_max/fy
    // choose x_max, x_min, y_max, y_min, z_max, z_min for (box) region of interest
-    //(nominal viewing platform)  
+    //(nominal viewing platform)
+  // the projector caches the nearest range per pixel, so the cloud is projected only once;
+  // each new (z_min, z_max) window just re-maps the cached ranges to gray levels
+  CloudToImageProjector projector(Nv, Nu, focal_len); // image is Nv wide, Nu tall
+  projector.project(*pclKinect_clr_ptr);
+  cout<<"projected points onto "<<projector.get_num_filled_pixels()<<" pixels"<<endl;
   while (z_min>0) {
       cout<<"enter z_min: ";
       cin>>z_min;
       cout<<"enter z_max: ";
       cin>>z_max;
-  for (int ipt = 0;ipt<npts_cloud;ipt++) {
-    cloud_pt = pclKinect_clr_ptr->points[ipt].getVector3fMap();
-    z = cloud_pt[2];
-    y = cloud_pt[1];
-    x = cloud_pt[0];
-    if ((z==z)&&(x==x)&&(y==y)) { // test for Nan 
-       u = uc + focal_len*x/z;
-       i = round(u);
-       v = vc + focal_len*y/z;
-       j = round(v);
-       if ((i>=0)&&(i<Nu)&&(j>=0)&&(j<Nv)) {
-           // convert z to an intensity:
-           r = sqrt(z*z+y*y+x*x);
-           if (r>z_max) gray_level=0;
-           else if (r<z_min) gray_level=0;
-           else {
-               gray_level = (uchar) (255*(z_max-r)/(z_max-z_min));
-           }
-               g_image.at<uchar>(j,i)= gray_level;
-               //cv_ptr->image.at<cv::Vec3b>(j, i)[0] = 0;
-           
-       }
-    
-  }
-  }
+      projector.render(z_min, z_max, g_image);
   std::cout << "output image size: " << g_image.size().height << " , "
   << g_image.size().width << std::endl; //initially, 0x0
   //cv::namedWindow("Original Image"); // define the window
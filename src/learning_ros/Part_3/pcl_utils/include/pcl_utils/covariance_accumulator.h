@@ -0,0 +1,97 @@
+// covariance_accumulator.h header file; doxygen comments follow //
+/// Include this file in "pcl_utils.cpp", and in any main that uses this library.
+/// Single-pass point statistics (count, mean, scatter matrix) for plane fitting.
+/// Points are added one at a time, with Welford's update, so no matrix of points is needed and
+/// the result is accurate even far from the origin.  Two accumulators are combined with merge()
+/// (Chan's pairwise formula), so a cloud can be split among threads and the partial results merged.
+/// The plane fit uses Eigen's closed-form eigen-decomposition of the symmetric 3x3 scatter matrix.
+
+#ifndef COVARIANCE_ACCUMULATOR_H_
+#define COVARIANCE_ACCUMULATOR_H_
+
+#include <vector>
+#include <algorithm>
+#include <Eigen/Eigen>
+#include <pcl/pcl_macros.h> // pcl_isfinite
+#include <pcl/point_cloud.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+class CovarianceAccumulator {
+public:
+    CovarianceAccumulator() { reset(); };
+    void reset();
+
+    /// add one point
+    void add(const Eigen::Vector3f &pt) {
+        n_++;
+        Eigen::Vector3d delta = pt.cast<double>() - mean_;
+        mean_ += delta / n_;
+        scatter_ += delta * (pt.cast<double>() - mean_).transpose();
+    };
+    /// combine the points of another accumulator with these
+    void merge(const CovarianceAccumulator &other);
+
+    int get_npts() const { return n_; };
+    Eigen::Vector3f get_centroid() const { return mean_.cast<float>(); };
+    /// sum over points of (pt-centroid)*(pt-centroid)^T
+    Eigen::Matrix3d get_scatter() const { return scatter_; };
+
+    /** best-fit plane: the normal is the eigenvector of the least eigenvalue of the scatter matrix, and the
+     * major axis that of the greatest.  The normal is chosen with negative z (i.e. toward a camera looking along +z).
+     * plane_dist is the (signed) distance of the plane from the origin.  returns false if there are fewer than 3 points
+     */
+    bool fit_plane(Eigen::Vector3f &plane_normal, double &plane_dist, Eigen::Vector3f &major_axis) const;
+
+    /// add the finite points of a cloud, or of the points of a cloud selected by indices, splitting the work among threads
+    template <typename PointT>
+    void add_cloud(const pcl::PointCloud<PointT> &cloud);
+    template <typename PointT>
+    void add_cloud(const pcl::PointCloud<PointT> &cloud, const std::vector<int> &indices);
+
+private:
+    int n_;
+    Eigen::Vector3d mean_;
+    Eigen::Matrix3d scatter_;
+
+    //below this many points, threads cost more than they save
+    static const int MIN_PTS_PER_THREAD = 5000;
+
+    template <typename PointT>
+    void add_points(const pcl::PointCloud<PointT> &cloud, const std::vector<int> *indices);
+};
+
+template <typename PointT>
+void CovarianceAccumulator::add_cloud(const pcl::PointCloud<PointT> &cloud) {
+    add_points(cloud, NULL);
+}
+
+template <typename PointT>
+void CovarianceAccumulator::add_cloud(const pcl::PointCloud<PointT> &cloud, const std::vector<int> &indices) {
+    add_points(cloud, &indices);
+}
+
+template <typename PointT>
+void CovarianceAccumulator::add_points(const pcl::PointCloud<PointT> &cloud, const std::vector<int> *indices) {
+    int npts = indices ? indices->size() : cloud.points.size();
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = std::max(1, std::min(omp_get_max_threads(), npts / MIN_PTS_PER_THREAD));
+#endif
+    //each thread accumulates a contiguous block; the partial results are merged in order
+    std::vector<CovarianceAccumulator> partial(nthreads);
+#pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+    for (int t = 0; t < nthreads; t++) {
+        int i_end = (int) (((long) npts * (t + 1)) / nthreads);
+        for (int i = (int) (((long) npts * t) / nthreads); i < i_end; i++) {
+            const PointT &p = cloud.points[indices ? (*indices)[i] : i];
+            if (pcl_isfinite(p.x) && pcl_isfinite(p.y) && pcl_isfinite(p.z)) partial[t].add(Eigen::Vector3f(p.x, p.y, p.z));
+        }
+    }
+    for (int t = 0; t < nthreads; t++) {
+        merge(partial[t]);
+    }
+}
+
+#endif
@@ -0,0 +1,64 @@
+// organized_plane_segmenter.h header file; doxygen comments follow //
+/// Include this file in "organized_plane_segmenter.cpp", and in any main that uses this library.
+/// This class finds all planar patches in an organized point cloud (e.g. a 640x480 Kinect frame) in one pass:
+/// surface normals are computed from integral images (constant time per point, using the image
+/// neighborhood rather than a search tree), then pixels with similar normals and plane offsets are grown into
+/// connected regions (pcl::OrganizedMultiPlaneSegmentation).  Each patch is returned with its plane model,
+/// centroid, major axis and inlier indices, so tables and box tops can be picked out by their geometry,
+/// with no hand-tuned x/y/z box limits.
+
+#ifndef ORGANIZED_PLANE_SEGMENTER_H_
+#define ORGANIZED_PLANE_SEGMENTER_H_
+
+#include <vector>
+#include <Eigen/Eigen>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/features/integral_image_normal.h>
+#include <pcl/segmentation/organized_multi_plane_segmentation.h>
+
+/// one planar patch; all vectors are w/rt the frame of the cloud (or the frame of the last transform_patch())
+struct PlanarPatch {
+    Eigen::Vector3f plane_normal; //unit normal, pointing toward the sensor
+    double plane_dist; //plane is: plane_normal.dot(pt) = plane_dist
+    Eigen::Vector3f centroid;
+    Eigen::Vector3f major_axis; //direction of greatest extent, in the plane
+    std::vector<int> indices; //indices of the patch points in the cloud
+};
+
+class OrganizedPlaneSegmenter {
+public:
+    OrganizedPlaneSegmenter();
+
+    /// patches with fewer points are ignored; default 1000
+    void set_min_inliers(int min_inliers) { min_inliers_ = min_inliers; };
+    /// max angle (rad) between normals of neighboring points in a patch; default 2 deg
+    void set_angular_threshold(double angular_threshold) { angular_threshold_ = angular_threshold; };
+    /// max distance (m) of a point from its patch's plane; default 0.02
+    void set_distance_threshold(double distance_threshold) { distance_threshold_ = distance_threshold; };
+    /// normals are not computed across depth jumps greater than this factor times the depth; default 0.02
+    void set_max_depth_change_factor(float factor) { max_depth_change_factor_ = factor; };
+    /// size (pixels) of the area over which normals are smoothed; default 10
+    void set_normal_smoothing_size(float size) { normal_smoothing_size_ = size; };
+
+    /** find all planar patches in cloud, which must be organized (height > 1);
+     * returns the number of patches found, or -1 if the cloud is not organized
+     */
+    int segment(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, std::vector<PlanarPatch> &patches);
+
+    /// express a patch w/rt another frame: A maps points in the cloud frame to the new frame
+    static void transform_patch(const Eigen::Affine3f &A, PlanarPatch &patch);
+
+private:
+    int min_inliers_;
+    double angular_threshold_, distance_threshold_;
+    float max_depth_change_factor_, normal_smoothing_size_;
+
+    //kept between frames, so buffers (incl. the integral images) are reused
+    pcl::IntegralImageNormalEstimation<pcl::PointXYZ, pcl::Normal> normal_estimator_;
+    pcl::OrganizedMultiPlaneSegmentation<pcl::PointXYZ, pcl::Normal, pcl::Label> plane_segmentation_;
+    pcl::PointCloud<pcl::Normal>::Ptr normals_;
+    pcl::PointCloud<pcl::Label> labels_;
+};
+
+#endif
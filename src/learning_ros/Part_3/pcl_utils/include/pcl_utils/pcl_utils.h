@@ -41,6 +41,9 @@
 #include <pcl/filters/passthrough.h>
 #include <pcl/filters/voxel_grid.h> 
 
+#include <pcl_utils/organized_plane_segmenter.h>
+class CovarianceAccumulator; //see covariance_accumulator.h
+
 using namespace std;  //just to avoid requiring std::, Eigen:: ...
 using namespace Eigen;
 using namespace pcl;
@@ -68,6 +71,9 @@ public:
     Eigen::Vector3f  compute_centroid(pcl::PointCloud<pcl::PointXYZ> &input_cloud);
     
     void fit_points_to_plane(pcl::PointCloud<pcl::PointXYZ>::Ptr input_cloud_ptr,Eigen::Vector3f &plane_normal, double &plane_dist);
+    /// as above, but fits only the points of the cloud selected by indices (no copy of the points is made)
+    void fit_points_to_plane(pcl::PointCloud<pcl::PointXYZ>::Ptr input_cloud_ptr, vector<int> &indices,
+        Eigen::Vector3f &plane_normal, double &plane_dist);
     //void fit_xformed_selected_pts_to_plane(Eigen::Vector3f &plane_normal, double &plane_dist);  
 
 // 
@@ -152,6 +158,19 @@ public:
     double find_table_height(double z_min, double z_max, double dz); //op on xformed cloud; uses pcl passthru filter
     //another fnc using passthru filter--with x, y and z limits
     double find_table_height(double x_min, double x_max, double y_min, double y_max, double z_min, double z_max, double dz_tol);
+    /**cheap check of a horizontal plane, e.g. a table found previously, against the current kinect cloud:
+     * only every stride'th kinect point is transformed (by A, kinect to plane frame), so the full cloud need not be.
+     * counts the sampled points within the x, y, z box (returned in n_in_box), and returns how many of these
+     * lie within +/- z_eps of z_plane
+     */
+    int count_z_plane_inliers_sampled(Eigen::Affine3f A, double x_min, double x_max, double y_min, double y_max,
+        double z_min, double z_max, double z_plane, double z_eps, int stride, int &n_in_box);
+    /**find all planar patches (tables, box tops, walls...) in the most recent kinect cloud, in one pass over the
+     * organized cloud, with no box limits; the patch models are then transformed by A (e.g. kinect to torso frame).
+     * returns the number of patches, or -1 if the cloud is not organized (e.g. one read from an unorganized pcd file)
+     */
+    int find_planar_patches(Eigen::Affine3f A, vector<PlanarPatch> &patches);
+    OrganizedPlaneSegmenter &get_plane_segmenter() { return plane_segmenter_; }; //to change its thresholds
 
     void box_filter(PointCloud<pcl::PointXYZ>::Ptr inputCloud, Eigen::Vector3f pt_min, Eigen::Vector3f pt_max, 
                 vector<int> &indices);
@@ -172,6 +191,7 @@ public:
                     double color_match_thresh, vector<int> &output_indices);    
 
 private:
+    void fit_accumulated_points_to_plane(const CovarianceAccumulator &acc, Eigen::Vector3f &plane_normal, double &plane_dist);
     ros::NodeHandle nh_; 
     // some objects to support subscriber, service, and publisher
     ros::Subscriber pointcloud_subscriber_; //use this to subscribe to a pointcloud topic
@@ -194,6 +214,7 @@ private:
     pcl::PointCloud<pcl::PointXYZ>::Ptr pclTransformedSelectedPoints_ptr_;
     pcl::PointCloud<pcl::PointXYZ>::Ptr pclGenPurposeCloud_ptr_;
     pcl::PassThrough<pcl::PointXYZ> pass; //create a pass-through object
+    OrganizedPlaneSegmenter plane_segmenter_; //keeps its buffers from frame to frame
     bool got_kinect_cloud_;
     bool got_selected_points_;
     bool take_snapshot_;
@@ -0,0 +1,37 @@
+// covariance_accumulator.cpp
+// implementation of CovarianceAccumulator; see header file for usage
+#include <pcl_utils/covariance_accumulator.h>
+
+void CovarianceAccumulator::reset() {
+    n_ = 0;
+    mean_ = Eigen::Vector3d::Zero();
+    scatter_ = Eigen::Matrix3d::Zero();
+}
+
+//Chan et al.: exact for any split of the points, and stable since only deviations from the means are summed
+void CovarianceAccumulator::merge(const CovarianceAccumulator &other) {
+    if (other.n_ == 0) return;
+    if (n_ == 0) {
+        *this = other;
+        return;
+    }
+    int n = n_ + other.n_;
+    Eigen::Vector3d delta = other.mean_ - mean_;
+    double weight = ((double) n_) * other.n_ / n;
+    mean_ += delta * (((double) other.n_) / n);
+    scatter_ += other.scatter_ + weight * delta * delta.transpose();
+    n_ = n;
+}
+
+bool CovarianceAccumulator::fit_plane(Eigen::Vector3f &plane_normal, double &plane_dist, Eigen::Vector3f &major_axis) const {
+    if (n_ < 3) return false;
+    //closed-form solution for symmetric 3x3 matrices; eigenvalues are in increasing order
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es;
+    es.computeDirect(scatter_);
+    plane_normal = es.eigenvectors().col(0).cast<float>();
+    major_axis = es.eigenvectors().col(2).cast<float>();
+    //if the data is w/rt the camera frame, the optical axis is z, so visible surfaces have normals w/ negative z
+    if (plane_normal(2) > 0) plane_normal = -plane_normal;
+    plane_dist = plane_normal.dot(mean_.cast<float>());
+    return true;
+}
@@ -0,0 +1,64 @@
+// organized_plane_segmenter.cpp
+// implementation of OrganizedPlaneSegmenter; see header file for usage
+#include <pcl_utils/organized_plane_segmenter.h>
+#include <ros/ros.h>
+#include <math.h>
+
+OrganizedPlaneSegmenter::OrganizedPlaneSegmenter() : normals_(new pcl::PointCloud<pcl::Normal>) {
+    min_inliers_ = 1000;
+    angular_threshold_ = 2.0 * M_PI / 180.0;
+    distance_threshold_ = 0.02;
+    max_depth_change_factor_ = 0.02f;
+    normal_smoothing_size_ = 10.0f;
+    normal_estimator_.setNormalEstimationMethod(normal_estimator_.AVERAGE_3D_GRADIENT);
+}
+
+int OrganizedPlaneSegmenter::segment(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, std::vector<PlanarPatch> &patches) {
+    patches.clear();
+    if (!cloud->isOrganized()) {
+        ROS_WARN_ONCE("OrganizedPlaneSegmenter: cloud is not organized");
+        return -1;
+    }
+    //normals from integral images: no neighbor search
+    normal_estimator_.setMaxDepthChangeFactor(max_depth_change_factor_);
+    normal_estimator_.setNormalSmoothingSize(normal_smoothing_size_);
+    normal_estimator_.setInputCloud(cloud);
+    normal_estimator_.compute(*normals_);
+
+    //grow connected regions of similar normals and plane offsets
+    plane_segmentation_.setMinInliers(min_inliers_);
+    plane_segmentation_.setAngularThreshold(angular_threshold_);
+    plane_segmentation_.setDistanceThreshold(distance_threshold_);
+    plane_segmentation_.setInputNormals(normals_);
+    plane_segmentation_.setInputCloud(cloud);
+    std::vector<pcl::ModelCoefficients> model_coefficients;
+    std::vector<pcl::PointIndices> inlier_indices;
+    std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > centroids;
+    std::vector<Eigen::Matrix3f, Eigen::aligned_allocator<Eigen::Matrix3f> > covariances;
+    std::vector<pcl::PointIndices> label_indices;
+    plane_segmentation_.segment(model_coefficients, inlier_indices, centroids, covariances, labels_, label_indices);
+
+    //coefficients are (a,b,c,d) for a*x+b*y+c*z+d=0, w/ normal (a,b,c) toward the sensor;
+    //centroids and covariances of the regions come with them, so no pass over the points is needed here
+    int npatches = model_coefficients.size();
+    patches.resize(npatches);
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> es;
+    for (int i = 0; i < npatches; i++) {
+        PlanarPatch &patch = patches[i];
+        const std::vector<float> &coeffs = model_coefficients[i].values;
+        patch.plane_normal << coeffs[0], coeffs[1], coeffs[2];
+        patch.plane_dist = -coeffs[3];
+        patch.centroid = centroids[i].head<3>();
+        es.computeDirect(covariances[i]); //eigenvalues in increasing order
+        patch.major_axis = es.eigenvectors().col(2);
+        patch.indices.swap(inlier_indices[i].indices);
+    }
+    return npatches;
+}
+
+void OrganizedPlaneSegmenter::transform_patch(const Eigen::Affine3f &A, PlanarPatch &patch) {
+    patch.plane_normal = A.linear() * patch.plane_normal;
+    patch.major_axis = A.linear() * patch.major_axis;
+    patch.centroid = A * patch.centroid;
+    patch.plane_dist = patch.plane_normal.dot(patch.centroid);
+}
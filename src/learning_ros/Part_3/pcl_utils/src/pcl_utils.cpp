@@ -2,6 +2,7 @@
 //
 
 #include <pcl_utils/pcl_utils.h>
+#include <pcl_utils/covariance_accumulator.h>
 #include <pcl-1.7/pcl/PCLHeader.h>
 //uses initializer list for member vars
 
@@ -103,138 +104,40 @@ Eigen::Affine3f PclUtils::make_affine_from_plane_params(Eigen::Vector4f plane_pa
 }
 
 
-void PclUtils::fit_points_to_plane(Eigen::MatrixXf points_mat, Eigen::Vector3f &plane_normal, double &plane_dist) {
-    //ROS_INFO("starting identification of plane from data: ");
-    int npts = points_mat.cols(); // number of points = number of columns in matrix; check the size
-    
-    // first compute the centroid of the data:
-    //Eigen::Vector3f centroid; // make this member var, centroid_
-    centroid_ = Eigen::MatrixXf::Zero(3, 1); // see http://eigen.tuxfamily.org/dox/AsciiQuickReference.txt
-    
-    //centroid = compute_centroid(points_mat);
-     for (int ipt = 0; ipt < npts; ipt++) {
-        centroid_ += points_mat.col(ipt); //add all the column vectors together
-    }
-    centroid_ /= npts; //divide by the number of points to get the centroid    
-    cout<<"centroid: "<<centroid_.transpose()<<endl;
-
-
-    // subtract this centroid from all points in points_mat:
-    Eigen::MatrixXf points_offset_mat = points_mat;
-    for (int ipt = 0; ipt < npts; ipt++) {
-        points_offset_mat.col(ipt) = points_offset_mat.col(ipt) - centroid_;
-    }
-    //compute the covariance matrix w/rt x,y,z:
-    Eigen::Matrix3f CoVar;
-    CoVar = points_offset_mat * (points_offset_mat.transpose()); //3xN matrix times Nx3 matrix is 3x3
-    //cout<<"covariance: "<<endl;
-    //cout<<CoVar<<endl;
-
-    // here is a more complex object: a solver for eigenvalues/eigenvectors;
-    // we will initialize it with our covariance matrix, which will induce computing eval/evec pairs
-    Eigen::EigenSolver<Eigen::Matrix3f> es3f(CoVar);
-
-    Eigen::VectorXf evals; //we'll extract the eigenvalues to here
-    //cout<<"size of evals: "<<es3d.eigenvalues().size()<<endl;
-    //cout<<"rows,cols = "<<es3d.eigenvalues().rows()<<", "<<es3d.eigenvalues().cols()<<endl;
-    //cout << "The eigenvalues of CoVar are:" << endl << es3d.eigenvalues().transpose() << endl;
-    //cout<<"(these should be real numbers, and one of them should be zero)"<<endl;
-    //cout << "The matrix of eigenvectors, V, is:" << endl;
-    //cout<< es3d.eigenvectors() << endl << endl;
-    //cout<< "(these should be real-valued vectors)"<<endl;
-    // in general, the eigenvalues/eigenvectors can be complex numbers
-    //however, since our matrix is self-adjoint (symmetric, positive semi-definite), we expect
-    // real-valued evals/evecs;  we'll need to strip off the real parts of the solution
-
-    evals = es3f.eigenvalues().real(); // grab just the real parts
-    //cout<<"real parts of evals: "<<evals.transpose()<<endl;
-
-    // our solution should correspond to an e-val of zero, which will be the minimum eval
-    //  (all other evals for the covariance matrix will be >0)
-    // however, the solution does not order the evals, so we'll have to find the one of interest ourselves
-
-    double min_lambda = evals[0]; //initialize the hunt for min eval
-    double max_lambda = evals[0]; // and for max eval
-    //Eigen::Vector3cf complex_vec; // here is a 3x1 vector of double-precision, complex numbers
-    //Eigen::Vector3f evec0, evec1, evec2; //, major_axis; 
-    //evec0 = es3f.eigenvectors().col(0).real();
-    //evec1 = es3f.eigenvectors().col(1).real();
-    //evec2 = es3f.eigenvectors().col(2).real();  
-    
-    
-    //((pt-centroid)*evec)*2 = evec'*points_offset_mat'*points_offset_mat*evec = 
-    // = evec'*CoVar*evec = evec'*lambda*evec = lambda
-    // min lambda is ideally zero for evec= plane_normal, since points_offset_mat*plane_normal~= 0
-    // max lambda is associated with direction of major axis
-    
-    //sort the evals:
-    
-    //complex_vec = es3f.eigenvectors().col(0); // here's the first e-vec, corresponding to first e-val
-    //cout<<"complex_vec: "<<endl;
-    //cout<<complex_vec<<endl;
-    plane_normal = es3f.eigenvectors().col(0).real(); //complex_vec.real(); //strip off the real part
-    major_axis_ = es3f.eigenvectors().col(0).real(); // starting assumptions
-    
-    //cout<<"real part: "<<est_plane_normal.transpose()<<endl;
-    //est_plane_normal = es3d.eigenvectors().col(0).real(); // evecs in columns
-
-    double lambda_test;
-    int i_normal = 0;
-    int i_major_axis=0;
-    //loop through "all" ("both", in this 3-D case) the rest of the solns, seeking min e-val
-    for (int ivec = 1; ivec < 3; ivec++) {
-        lambda_test = evals[ivec];
-        if (lambda_test < min_lambda) {
-            min_lambda = lambda_test;
-            i_normal = ivec; //this index is closer to index of min eval
-            plane_normal = es3f.eigenvectors().col(i_normal).real();
-        }
-        if (lambda_test > max_lambda) {
-            max_lambda = lambda_test;
-            i_major_axis = ivec; //this index is closer to index of min eval
-            major_axis_ = es3f.eigenvectors().col(i_major_axis).real();
-        }        
+//fit a plane to points accumulated in acc; sets centroid_ and major_axis_ as well
+void PclUtils::fit_accumulated_points_to_plane(const CovarianceAccumulator &acc, Eigen::Vector3f &plane_normal, double &plane_dist) {
+    // the normal is the eigenvector of the min eigenvalue of the covariance; ideally zero, since all points lie in the plane;
+    // the major axis is the eigenvector of the max eigenvalue
+    if (!acc.fit_plane(plane_normal, plane_dist, major_axis_)) {
+        ROS_WARN("too few points to fit a plane: %d", acc.get_npts());
     }
-    // at this point, we have the minimum eval in "min_lambda", and the plane normal
-    // (corresponding evec) in "est_plane_normal"/
-    // these correspond to the ith entry of i_normal
-    //cout<<"min eval is "<<min_lambda<<", corresponding to component "<<i_normal<<endl;
-    //cout<<"corresponding evec (est plane normal): "<<plane_normal.transpose()<<endl;
-    //cout<<"max eval is "<<max_lambda<<", corresponding to component "<<i_major_axis<<endl;
-    //cout<<"corresponding evec (est major axis): "<<major_axis_.transpose()<<endl;  
-    
-    //what is the correct sign of the normal?  If the data is with respect to the camera frame,
-    // then the camera optical axis is z axis, and thus any points reflected must be from a surface
-    // with negative z component of surface normal
-    if (plane_normal(2)>0) plane_normal = -plane_normal; // negate, if necessary
-    
-    //cout<<"correct answer is: "<<normal_vec.transpose()<<endl;
-    plane_dist = plane_normal.dot(centroid_);
-    //cout<<"est plane distance from origin = "<<est_dist<<endl;
-    //cout<<"correct answer is: "<<dist<<endl;
-    //cout<<endl<<endl;    
+    centroid_ = acc.get_centroid();
+    ROS_DEBUG("centroid: %f, %f, %f", centroid_(0), centroid_(1), centroid_(2));
     ROS_INFO("major_axis: %f, %f, %f",major_axis_(0),major_axis_(1),major_axis_(2));
     ROS_INFO("plane normal: %f, %f, %f",plane_normal(0),plane_normal(1),plane_normal(2));
 }
 
-//get pts from cloud, pack the points into an Eigen::MatrixXf, then use above
-// fit_points_to_plane fnc
+void PclUtils::fit_points_to_plane(Eigen::MatrixXf points_mat, Eigen::Vector3f &plane_normal, double &plane_dist) {
+    CovarianceAccumulator acc;
+    int npts = points_mat.cols(); // number of points = number of columns in matrix
+    for (int ipt = 0; ipt < npts; ipt++) {
+        acc.add(points_mat.col(ipt));
+    }
+    fit_accumulated_points_to_plane(acc, plane_normal, plane_dist);
+}
 
+//single pass over the cloud; no copy of the points is made.  Non-finite points are skipped
 void PclUtils::fit_points_to_plane(pcl::PointCloud<pcl::PointXYZ>::Ptr input_cloud_ptr, Eigen::Vector3f &plane_normal, double &plane_dist) {
-    Eigen::MatrixXf points_mat;
-    Eigen::Vector3f cloud_pt;
-    //populate points_mat from cloud data;
-
-    int npts = input_cloud_ptr->points.size();
-    points_mat.resize(3, npts);
-
-    //somewhat odd notation: getVector3fMap() reading OR WRITING points from/to a pointcloud, with conversions to/from Eigen
-    for (int i = 0; i < npts; ++i) {
-        cloud_pt = input_cloud_ptr->points[i].getVector3fMap();
-        points_mat.col(i) = cloud_pt;
-    }
-    fit_points_to_plane(points_mat, plane_normal, plane_dist);
+    CovarianceAccumulator acc;
+    acc.add_cloud(*input_cloud_ptr);
+    fit_accumulated_points_to_plane(acc, plane_normal, plane_dist);
+}
 
+//same, but only for the points of the cloud selected by indices
+void PclUtils::fit_points_to_plane(pcl::PointCloud<pcl::PointXYZ>::Ptr input_cloud_ptr, vector<int> &indices, Eigen::Vector3f &plane_normal, double &plane_dist) {
+    CovarianceAccumulator acc;
+    acc.add_cloud(*input_cloud_ptr, indices);
+    fit_accumulated_points_to_plane(acc, plane_normal, plane_dist);
 }
 
 //compute and return the centroid of a pointCloud
@@ -707,34 +610,21 @@ bool PclUtils::find_plane_fit(double x_min, double x_max, double y_min, double y
      Eigen::Vector3f &plane_normal, double &plane_dist, Eigen::Vector3f &major_axis, Eigen::Vector3f  &centroid) { 
     vector<int> indices;
     bool ans_valid = true;
-    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_filtered (new pcl::PointCloud<pcl::PointXYZ>);
-    pcl::PassThrough<pcl::PointXYZ> pass; //create a pass-through object    
-    pass.setInputCloud(pclTransformed_ptr_); //set the cloud we want to operate on--pass via a pointer
-    pass.setFilterFieldName("x"); // we will "filter" based on points that lie within some range of z-value
-    pass.setFilterLimits(x_min, x_max);
-    pass.filter(*cloud_filtered); //fill this cloud with result
-    int n_filtered = cloud_filtered->points.size();
-    ROS_INFO("num x-filtered pts = %d",n_filtered);
-    //pass.filter(*inliers);
-    //pass.setIndices(inliers);
-    pass.setInputCloud(cloud_filtered);
-    pass.setFilterFieldName("y"); // we will "filter" based on points that lie within some range of z-value
-    pass.setFilterLimits(y_min, y_max);
-    pass.filter(*cloud_filtered);
-    n_filtered = cloud_filtered->points.size();
-    ROS_INFO("num y-filtered pts = %d",n_filtered);
-    //pass.setIndices(indices);
-
-    pass.setInputCloud(cloud_filtered);
-    pass.setFilterFieldName("z"); // we will "filter" based on points that lie within some range of z-value
-    pass.setFilterLimits(z_min, z_max);
-    pass.filter(*cloud_filtered);
-    n_filtered = cloud_filtered->points.size();
-    ROS_INFO("num z-filtered pts = %d",n_filtered);
+    //select the points in the box by index, in one pass, rather than copying x-, y- and z-filtered clouds
+    int npts = pclTransformed_ptr_->points.size();
+    indices.reserve(npts);
+    for (int i = 0; i < npts; i++) {
+        const pcl::PointXYZ &pt = pclTransformed_ptr_->points[i];
+        if (pt.x >= x_min && pt.x <= x_max && pt.y >= y_min && pt.y <= y_max && pt.z >= z_min && pt.z <= z_max) {
+            indices.push_back(i);
+        }
+    }
+    int n_filtered = indices.size();
+    ROS_INFO("num box-filtered pts = %d",n_filtered);
     if (n_filtered<min_n_filtered) {
         ans_valid= false; //give warning of insufficient data
     }
-    fit_points_to_plane(cloud_filtered, plane_normal, plane_dist);    
+    fit_points_to_plane(pclTransformed_ptr_, indices, plane_normal, plane_dist);
     major_axis = major_axis_;
     centroid = centroid_;
     return ans_valid;
@@ -806,6 +696,33 @@ void PclUtils::filter_cloud_z(PointCloud<pcl::PointXYZ>::Ptr inputCloud, double
     
 }
 
+//sparse version of the slab count in find_table_height(), for verifying a known plane height;
+//operates on the raw kinect cloud, transforming only the sampled points
+int PclUtils::count_z_plane_inliers_sampled(Eigen::Affine3f A, double x_min, double x_max, double y_min, double y_max,
+        double z_min, double z_max, double z_plane, double z_eps, int stride, int &n_in_box) {
+    if (stride < 1) stride = 1;
+    int npts = pclKinect_ptr_->points.size();
+    int n_inliers = 0;
+    n_in_box = 0;
+    Eigen::Vector3f pt;
+    for (int i = 0; i < npts; i += stride) {
+        pt = A * pclKinect_ptr_->points[i].getVector3fMap();
+        if (!pcl_isfinite(pt[2])) continue; //kinect points w/ no return are NaN
+        if (pt[0] < x_min || pt[0] > x_max || pt[1] < y_min || pt[1] > y_max || pt[2] < z_min || pt[2] > z_max) continue;
+        n_in_box++;
+        if (fabs(pt[2] - z_plane) <= z_eps) n_inliers++;
+    }
+    return n_inliers;
+}
+
+int PclUtils::find_planar_patches(Eigen::Affine3f A, vector<PlanarPatch> &patches) {
+    int npatches = plane_segmenter_.segment(pclKinect_ptr_, patches);
+    for (int i = 0; i < npatches; i++) {
+        OrganizedPlaneSegmenter::transform_patch(A, patches[i]);
+    }
+    return npatches;
+}
+
 //find points that are both (approx) coplanar at height z_nom AND within "radius" of "centroid"
 void PclUtils::box_filter(PointCloud<pcl::PointXYZ>::Ptr inputCloud, Eigen::Vector3f pt_min, Eigen::Vector3f pt_max, 
                 vector<int> &indices)  {
@@ -14,7 +14,8 @@ double g_odom_tf_x = 0.0;
 double g_odom_tf_y = 0.0;
 double g_odom_tf_phi = 0.0;
 
-SteeringController::SteeringController(ros::NodeHandle* nodehandle):nh_(*nodehandle)
+SteeringController::SteeringController(ros::NodeHandle* nodehandle):nh_(*nodehandle),
+telemetry_spinner_(1, &telemetry_queue_)
 { // constructor
     ROS_INFO("in class constructor of SteeringController");
     initializeSubscribers(); // package up the messy work of creating subscribers; do this overhead in constructor
@@ -2,7 +2,9 @@
 //wsn, Feb 2016
 //subscribe to desired state and to odom
 // invoke an algorithm to command speed and spin
-// update this computation adequately fast
+// the algorithm runs on each odom message; it predicts the robot state forward, by the latency
+// from the odom stamp to the command taking effect, and compares it to the desired state at
+// that same time
 
 
 
@@ -10,9 +12,17 @@
 #include "steering_algorithm.h"
 
 
-SteeringController::SteeringController(ros::NodeHandle* nodehandle):nh_(*nodehandle)
+SteeringController::SteeringController(ros::NodeHandle* nodehandle):nh_(*nodehandle),
+telemetry_spinner_(1, &telemetry_queue_)
 { // constructor
     ROS_INFO("in class constructor of SteeringController");
+    controller_running_ = false; // don't compute commands from odom callbacks until constructed
+    des_hist_newest_ = 0;
+    des_hist_count_ = 0;
+    cmd_hist_newest_ = 0;
+    cmd_hist_count_ = 0;
+    odom_stamp_ = 0.0;
+    ros::NodeHandle("~").param("cmd_delay", cmd_delay_, 0.0);
     initializeSubscribers(); // package up the messy work of creating subscribers; do this overhead in constructor
     initializePublishers();
     //initializeServices();
@@ -57,6 +67,9 @@ SteeringController::SteeringController(ros::NodeHandle* nodehandle):nh_(*nodehan
     des_state_.twist.twist.linear.x = current_speed_des_; // but specified desired twist = 0.0
     des_state_.twist.twist.angular.z = current_omega_des_;
     des_state_.header.stamp = ros::Time::now();   
+    if (des_hist_count_ == 0) { // no desired state yet: hold the current pose
+        desStateCallback(des_state_);
+    }
 
     //initialize the twist command components, all to zero
     twist_cmd_.linear.x = 0.0;
@@ -69,6 +82,12 @@ SteeringController::SteeringController(ros::NodeHandle* nodehandle):nh_(*nodehan
     twist_cmd2_.twist = twist_cmd_; // copy the twist command into twist2 message
     twist_cmd2_.header.stamp = ros::Time::now(); // look up the time and put it in the header  
 
+    //steering errors are published from a separate thread, so they never delay a command
+    telemetry_spinner_.start();
+    ros::TimerOptions timer_options(ros::Duration(TELEMETRY_PERIOD),
+            boost::bind(&SteeringController::publishTelemetry, this, _1), &telemetry_queue_);
+    telemetry_timer_ = nh_.createTimer(timer_options);
+    controller_running_ = true;
 }
 
 //member helper function to set up subscribers;
@@ -98,7 +117,7 @@ void SteeringController::initializePublishers()
     ROS_INFO("Initializing Publishers: cmd_vel and cmd_vel_stamped");
     cmd_publisher_ = nh_.advertise<geometry_msgs::Twist>("cmd_vel", 1, true); // talks to the robot!
     cmd_publisher2_ = nh_.advertise<geometry_msgs::TwistStamped>("cmd_vel_stamped",1, true); //alt topic, includes time stamp
-    //steering_errs_publisher_ =  nh_.advertise<std_msgs::Float32MultiArray>("steering_errs",1, true);
+    steering_errs_publisher_ =  nh_.advertise<std_msgs::Float32MultiArray>("steering_errs", TELEMETRY_RING_SIZE);
 }
 
 
@@ -107,6 +126,7 @@ void SteeringController::odomCallback(const nav_msgs::Odometry& odom_rcvd) {
     // copy some of the components of the received message into member vars
     // we care about speed and spin, as well as position estimates x,y and heading
     current_odom_ = odom_rcvd; // save the entire message
+    odom_stamp_ = odom_rcvd.header.stamp.toSec();
     // but also pick apart pieces, for ease of use
     odom_pose_ = odom_rcvd.pose.pose;
     odom_vel_ = odom_rcvd.twist.twist.linear.x;
@@ -119,6 +139,9 @@ void SteeringController::odomCallback(const nav_msgs::Odometry& odom_rcvd) {
     // let's put odom x,y in an Eigen-style 2x1 vector; convenient for linear algebra operations
     //odom_xy_vec_(0) = odom_x_;
     //odom_xy_vec_(1) = odom_y_;   
+    if (controller_running_) {
+        lin_steering_algorithm(); // new odom: compute and publish a new twist command
+    }
 }
 
 void SteeringController::desStateCallback(const nav_msgs::Odometry& des_state_rcvd) {
@@ -137,6 +160,128 @@ void SteeringController::desStateCallback(const nav_msgs::Odometry& des_state_rc
     // fill in an Eigen-style 2x1 vector as well--potentially convenient for linear algebra operations    
     //des_xy_vec_(0) = des_state_x_;
     //des_xy_vec_(1) = des_state_y_;      
+    //keep it in the history, for interpolation
+    double stamp = des_state_rcvd.header.stamp.toSec();
+    if (stamp <= 0.0) {
+        stamp = ros::Time::now().toSec();
+    }
+    if (des_hist_count_ > 0 && stamp < des_hist_t_[des_hist_newest_]) {
+        des_hist_count_ = 0; // time went backwards, e.g. sim restarted; start over
+    }
+    des_hist_newest_ = (des_hist_newest_ + 1) % DES_STATE_HISTORY;
+    PlanarState &des = des_hist_[des_hist_newest_];
+    des.x = des_state_x_;
+    des.y = des_state_y_;
+    des.phi = des_state_phi_;
+    des.vel = des_state_vel_;
+    des.omega = des_state_omega_;
+    des_hist_t_[des_hist_newest_] = stamp;
+    if (des_hist_count_ < DES_STATE_HISTORY) {
+        des_hist_count_++;
+    }
+}
+
+//advance a planar state along an arc at its own speed and spin, for dt sec
+PlanarState SteeringController::predict(const PlanarState &state, double dt) {
+    PlanarState next = state;
+    double dphi = state.omega * dt;
+    if (fabs(dphi) < 1e-6) {
+        next.x += state.vel * dt * cos(state.phi);
+        next.y += state.vel * dt * sin(state.phi);
+    } else {
+        double r = state.vel / state.omega;
+        next.x += r * (sin(state.phi + dphi) - sin(state.phi));
+        next.y -= r * (cos(state.phi + dphi) - cos(state.phi));
+    }
+    next.phi = min_dang(state.phi + dphi);
+    return next;
+}
+
+//the robot executes each command cmd_delay_ after it is published; so from the odom stamp to the
+// prediction time, it is executing commands already sent.  Replay these, in order; before the
+// first of them, the robot moves as odom reports
+PlanarState SteeringController::predictRobot(const PlanarState &odom_state, double t_from, double t_to) {
+    PlanarState state = odom_state;
+    double t = t_from;
+    for (int k = cmd_hist_count_ - 1; k >= 0; k--) { // oldest first
+        int i = (cmd_hist_newest_ - k + CMD_HISTORY) % CMD_HISTORY;
+        double t_effect = cmd_hist_t_[i] + cmd_delay_;
+        if (t_effect >= t_to) {
+            break;
+        }
+        if (t_effect > t) {
+            state = predict(state, t_effect - t);
+            t = t_effect;
+        }
+        state.vel = cmd_hist_vel_[i];
+        state.omega = cmd_hist_omega_[i];
+    }
+    return predict(state, t_to - t);
+}
+
+//desired state at time t: interpolated between the two received desired states that bracket t,
+// or, if t is later than the newest one (the usual case), extrapolated from it.  Extrapolation
+// assumes the speed and spin keep changing at the rates seen between the newest two states
+PlanarState SteeringController::desStateAt(double t) {
+    int i_new = des_hist_newest_;
+    if (des_hist_count_ < 2) { // only one desired state: no rates to extrapolate with
+        return predict(des_hist_[i_new], std::max(0.0, std::min(t - des_hist_t_[i_new], MAX_PREDICTION_TIME)));
+    }
+    if (t >= des_hist_t_[i_new]) {
+        double dt = std::min(t - des_hist_t_[i_new], MAX_PREDICTION_TIME);
+        PlanarState des = des_hist_[i_new];
+        double accel = 0.0;
+        double alpha = 0.0;
+        int i_prev = (i_new - 1 + DES_STATE_HISTORY) % DES_STATE_HISTORY;
+        double dt_prev = des_hist_t_[i_new] - des_hist_t_[i_prev];
+        if (dt_prev > 0.0) {
+            accel = (des.vel - des_hist_[i_prev].vel) / dt_prev;
+            alpha = (des.omega - des_hist_[i_prev].omega) / dt_prev;
+        }
+        //advance at the mean speed and spin over the interval, then report their end values
+        des.vel += 0.5 * accel * dt;
+        des.omega += 0.5 * alpha * dt;
+        des = predict(des, dt);
+        des.vel += 0.5 * accel * dt;
+        des.omega += 0.5 * alpha * dt;
+        return des;
+    }
+    for (int k = 1; k < des_hist_count_; k++) {
+        int i_old = (des_hist_newest_ - k + DES_STATE_HISTORY) % DES_STATE_HISTORY;
+        if (des_hist_t_[i_old] <= t) {
+            const PlanarState &a = des_hist_[i_old];
+            const PlanarState &b = des_hist_[i_new];
+            double dt = des_hist_t_[i_new] - des_hist_t_[i_old];
+            double f = (dt > 0.0) ? (t - des_hist_t_[i_old]) / dt : 1.0;
+            PlanarState des;
+            des.x = a.x + f * (b.x - a.x);
+            des.y = a.y + f * (b.y - a.y);
+            des.phi = min_dang(a.phi + f * min_dang(b.phi - a.phi));
+            des.vel = a.vel + f * (b.vel - a.vel);
+            des.omega = a.omega + f * (b.omega - a.omega);
+            return des;
+        }
+        i_new = i_old;
+    }
+    return des_hist_[i_new]; // older than all we have; use the oldest
+}
+
+//runs in the telemetry thread: publish the steering errors queued by the controller as
+// [lateral err, heading err, trip dist err, latency, prediction horizon], for rqt_plot
+void SteeringController::publishTelemetry(const ros::TimerEvent& event) {
+    SteeringTelemetry record;
+    while (telemetry_.pop(record)) {
+        steering_errs_.data.resize(5);
+        steering_errs_.data[0] = record.lateral_err;
+        steering_errs_.data[1] = record.heading_err;
+        steering_errs_.data[2] = record.trip_dist_err;
+        steering_errs_.data[3] = record.latency;
+        steering_errs_.data[4] = record.horizon;
+        steering_errs_publisher_.publish(steering_errs_);
+    }
+    if (telemetry_.dropped() > 0) {
+        ROS_WARN_THROTTLE(5.0, "steering telemetry: %lu records dropped", telemetry_.dropped());
+    }
 }
 
 //utility fnc to compute min dang, accounting for periodicity
@@ -180,11 +325,30 @@ bool SteeringController::serviceCallback(cwru_srv::simple_bool_service_messageRe
 void SteeringController::lin_steering_algorithm() {
     double controller_speed;
     double controller_omega;
+    
+    //the command will take effect cmd_delay_ after now, but odom describes the robot as of its
+    // stamp; predict the robot forward by that latency, and compare to where it should be then.
+    // with no latency, this is the plain linear steering law
+    double now = ros::Time::now().toSec();
+    double t_odom = (odom_stamp_ > 0.0) ? odom_stamp_ : now;
+    double latency = now - t_odom;
+    double horizon = latency + cmd_delay_;
+    if (horizon < 0.0) horizon = 0.0;
+    if (horizon > MAX_PREDICTION_TIME) horizon = MAX_PREDICTION_TIME;
+    PlanarState odom_state;
+    odom_state.x = odom_x_;
+    odom_state.y = odom_y_;
+    odom_state.phi = odom_phi_;
+    odom_state.vel = odom_vel_;
+    odom_state.omega = odom_omega_;
+    PlanarState robot = predictRobot(odom_state, t_odom, t_odom + horizon);
+    PlanarState des = desStateAt(t_odom + horizon);
+
     //Eigen::Vector2d pos_err_xy_vec_;
     //Eigen::Vector2d t_vec;    //tangent of desired path
     //Eigen::Vector2d n_vec;    //normal to desired path, pointing to the "left" 
-    double tx = cos(des_state_phi_);
-    double ty = sin(des_state_phi_);
+    double tx = cos(des.phi);
+    double ty = sin(des.phi);
     double nx = -ty;
     double ny = tx;
     
@@ -192,39 +356,16 @@ void SteeringController::lin_steering_algorithm() {
     double lateral_err;
     double trip_dist_err; // error is scheduling...are we ahead or behind?
     
-
-    // have access to: des_state_vel_, des_state_omega_, des_state_x_, des_state_y_, des_state_phi_ and corresponding odom values    
-    double dx = des_state_x_- odom_x_;
-    double dy = des_state_y_ - odom_y_;
-    
-    //pos_err_xy_vec_ = des_xy_vec_ - odom_xy_vec_; // vector pointing from odom x-y to desired x-y
-    //lateral_err = n_vec.dot(pos_err_xy_vec_); //signed scalar lateral offset error; if positive, then desired state is to the left of odom
-    lateral_err = dx*nx + dy*ny;
-    trip_dist_err = dx*tx + dy*ty;
+    double dx = des.x - robot.x;
+    double dy = des.y - robot.y;
     
-    //trip_dist_err = t_vec.dot(pos_err_xy_vec_); // progress error: if positive, then we are behind schedule
-    heading_err = min_dang(des_state_phi_ - odom_phi_); // if positive, should rotate +omega to align with desired heading
-    
-    
-    // DEBUG OUTPUT...
-    ROS_INFO("des_state_phi, odom_phi, heading err = %f, %f, %f", des_state_phi_,odom_phi_,heading_err);
-    ROS_INFO("lateral err, trip dist err = %f, %f",lateral_err,trip_dist_err);
-    // DEFINITELY COMMENT OUT ALL cout<< OPERATIONS FOR REAL-TIME CODE
-    //std::cout<<des_xy_vec_<<std::endl;
-    //std::cout<<odom_xy_vec_<<std::endl;
-    // let's put these in a message to publish, for rqt_plot to display
-    //steering_errs_.data.clear();
-    //steering_errs_.data.push_back(lateral_err);
-    //steering_errs_.data.push_back(heading_err); 
-    //steering_errs_.data.push_back(trip_dist_err);
-
-    //steering_errs_publisher_.publish(steering_errs_); // suitable for plotting w/ rqt_plot
-    //END OF DEBUG STUFF
+    lateral_err = dx*nx + dy*ny; //signed scalar lateral offset error; if positive, then desired state is to the left of the robot
+    trip_dist_err = dx*tx + dy*ty; // progress error: if positive, then we are behind schedule
+    heading_err = min_dang(des.phi - robot.phi); // if positive, should rotate +omega to align with desired heading
     
      // do something clever with this information     
-    controller_speed = des_state_vel_ + K_TRIP_DIST*trip_dist_err; //speed up/slow down to null out 
-    //controller_omega = des_state_omega_; //ditto
-    controller_omega = des_state_omega_ + K_PHI*heading_err + K_DISP*lateral_err;
+    controller_speed = des.vel + K_TRIP_DIST*trip_dist_err; //speed up/slow down to null out 
+    controller_omega = des.omega + K_PHI*heading_err + K_DISP*lateral_err;
     
     controller_omega = MAX_OMEGA*sat(controller_omega/MAX_OMEGA); // saturate omega command at specified limits
     
@@ -235,6 +376,25 @@ void SteeringController::lin_steering_algorithm() {
     twist_cmd2_.header.stamp = ros::Time::now(); // look up the time and put it in the header 
     cmd_publisher_.publish(twist_cmd_);  
     cmd_publisher2_.publish(twist_cmd2_);     
+    cmd_hist_newest_ = (cmd_hist_newest_ + 1) % CMD_HISTORY;
+    cmd_hist_t_[cmd_hist_newest_] = now;
+    cmd_hist_vel_[cmd_hist_newest_] = controller_speed;
+    cmd_hist_omega_[cmd_hist_newest_] = controller_omega;
+    if (cmd_hist_count_ < CMD_HISTORY) {
+        cmd_hist_count_++;
+    }
+
+    // DEBUG OUTPUT: no logging here; queue it for the telemetry thread to publish
+    SteeringTelemetry record;
+    record.stamp = now;
+    record.latency = latency;
+    record.horizon = horizon;
+    record.lateral_err = lateral_err;
+    record.heading_err = heading_err;
+    record.trip_dist_err = trip_dist_err;
+    record.speed_cmd = controller_speed;
+    record.omega_cmd = controller_omega;
+    telemetry_.push(record);
 }
 
 int main(int argc, char** argv) 
@@ -246,15 +406,10 @@ int main(int argc, char** argv)
 
     ROS_INFO("main: instantiating an object of type SteeringController");
     SteeringController steeringController(&nh);  //instantiate an ExampleRosClass object and pass in pointer to nodehandle for constructor to use
-    ros::Rate sleep_timer(UPDATE_RATE); //a timer for desired rate, e.g. 50Hz
    
-    ROS_INFO:("starting steering algorithm");
-    while (ros::ok()) {
-        steeringController.lin_steering_algorithm(); // compute and publish twist commands and cmd_vel and cmd_vel_stamped
-
-        ros::spinOnce();
-        sleep_timer.sleep();
-    }
+    ROS_INFO("starting steering algorithm");
+    //each odom message triggers computing and publishing twist commands on cmd_vel and cmd_vel_stamped
+    ros::spin();
     return 0;
 } 
 
@@ -10,8 +10,10 @@
 #include <stdlib.h>
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include <ros/ros.h> //ALWAYS need to include this
+#include <ros/callback_queue.h>
 
 //message types used in this example code;  include more message types, as needed
 #include <std_msgs/Bool.h> 
@@ -26,6 +28,7 @@
 #include <geometry_msgs/PoseStamped.h>
 #include <nav_msgs/Odometry.h>
  #include <tf/transform_listener.h>
+#include "steering_telemetry.h"
 
 //Eigen is useful for linear algebra
 //#include <Eigen/Eigen>
@@ -40,6 +43,22 @@ const double K_TRIP_DIST = 1.0;
 // dynamic limitations:  these apply to the steering controller; they may be larger than the limits on des state generation
 const double MAX_SPEED = 1.0; // m/sec; adjust this
 const double MAX_OMEGA = 1.0; //1.0; // rad/sec; adjust this
+// latency compensation: the robot state is predicted ahead from the odom stamp to the time the
+// command takes effect, but never by more than this
+const double MAX_PREDICTION_TIME = 0.2; // sec
+const int DES_STATE_HISTORY = 8; // recent desired states kept, for interpolation at the prediction time
+const int CMD_HISTORY = 32; // recent twist commands kept; those still in flight are replayed in the prediction
+const unsigned TELEMETRY_RING_SIZE = 256; // must be a power of 2
+const double TELEMETRY_PERIOD = 0.1; // sec; steering_errs are published in batches at this period
+
+//planar state, as used by the steering law
+struct PlanarState {
+    double x;
+    double y;
+    double phi;
+    double vel;
+    double omega;
+};
 
 
 // define a class, including a constructor, member variables and member functions
@@ -47,11 +66,19 @@ class SteeringController
 {
 public:
     SteeringController(ros::NodeHandle* nodehandle); //"main" will need to instantiate a ROS nodehandle, then pass it to the constructor
+    ~SteeringController() { telemetry_spinner_.stop(); }
     // may choose to define public methods or public variables, if desired
     void lin_steering_algorithm(); // here is the heart of it...use odom state and desired state to compute twist command, and publish it
     double convertPlanarQuat2Phi(geometry_msgs::Quaternion quaternion);   
     double min_dang(double dang);  
     double sat(double x);
+    //advance a state along its own speed and spin, for dt sec
+    PlanarState predict(const PlanarState &state, double dt);
+    //robot state at t_to, from odom state at t_from, replaying the commands in effect meanwhile
+    PlanarState predictRobot(const PlanarState &odom_state, double t_from, double t_to);
+    //desired state at time t, interpolated between received desired states, or extrapolated
+    // from the newest one
+    PlanarState desStateAt(double t);
 private:
     // put private member data here;  "private" data will only be available to member functions of this class;
     ros::NodeHandle nh_; // we will need this, to pass between "main" and constructor
@@ -95,8 +122,30 @@ private:
     geometry_msgs::Quaternion des_state_quat_;  
     //Eigen::Vector2d des_xy_vec_;    
     
+    //recent desired states and their stamps, newest at des_hist_newest_
+    PlanarState des_hist_[DES_STATE_HISTORY];
+    double des_hist_t_[DES_STATE_HISTORY];
+    int des_hist_newest_;
+    int des_hist_count_;
+
+    //recent twist commands and the times they were published, newest at cmd_hist_newest_
+    double cmd_hist_t_[CMD_HISTORY];
+    double cmd_hist_vel_[CMD_HISTORY];
+    double cmd_hist_omega_[CMD_HISTORY];
+    int cmd_hist_newest_;
+    int cmd_hist_count_;
+
+    bool controller_running_; // set once constructed; odom callbacks then run the controller
+    double odom_stamp_; // stamp of current_odom_, sec
+    double cmd_delay_; // sec, from publishing cmd_vel to the base acting on it; param ~cmd_delay
+
     // message to hold/publish steering performance data
     std_msgs::Float32MultiArray steering_errs_;
+    // telemetry is queued by the controller and published from its own thread
+    TelemetryRing<TELEMETRY_RING_SIZE> telemetry_;
+    ros::CallbackQueue telemetry_queue_;
+    ros::AsyncSpinner telemetry_spinner_;
+    ros::Timer telemetry_timer_;
         
     // member methods as well:
     void initializeSubscribers(); // we will define some helper methods to encapsulate the gory details of initializing subscribers, publishers and services
@@ -105,6 +154,7 @@ private:
  
     void odomCallback(const nav_msgs::Odometry& odom_rcvd);
     void desStateCallback(const nav_msgs::Odometry& des_state_rcvd);    
+    void publishTelemetry(const ros::TimerEvent& event);
         
 }; 
 
@@ -0,0 +1,59 @@
+// steering_telemetry.h
+// fixed-size, lock-free ring for steering telemetry: the control loop pushes one record per
+// cycle without blocking or allocating, and a separate, low-priority thread drains the records
+// and publishes them.  Safe for exactly one producer thread and one consumer thread.
+
+#ifndef STEERING_TELEMETRY_H_
+#define STEERING_TELEMETRY_H_
+
+#include <atomic>
+
+struct SteeringTelemetry {
+    double stamp; // time the command was computed, sec
+    double latency; // odom stamp to command, sec
+    double horizon; // time the robot state was predicted ahead, sec
+    double lateral_err;
+    double heading_err;
+    double trip_dist_err;
+    double speed_cmd;
+    double omega_cmd;
+};
+
+template <unsigned N> // N must be a power of 2
+class TelemetryRing {
+public:
+    TelemetryRing() : head_(0), tail_(0), dropped_(0) {}
+
+    //producer: returns false, and counts a drop, if the consumer has fallen N records behind
+    bool push(const SteeringTelemetry &record) {
+        unsigned head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= N) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        records_[head & (N - 1)] = record;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    //consumer: returns false if there is nothing to read
+    bool pop(SteeringTelemetry &record) {
+        unsigned tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        record = records_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    unsigned long dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    SteeringTelemetry records_[N];
+    std::atomic<unsigned> head_; // next slot to write; only the producer stores
+    std::atomic<unsigned> tail_; // next slot to read; only the consumer stores
+    std::atomic<unsigned long> dropped_;
+};
+
+#endif
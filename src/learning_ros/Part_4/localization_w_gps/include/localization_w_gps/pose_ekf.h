@@ -0,0 +1,75 @@
+// pose_ekf.h header file //
+// extended Kalman filter for planar localization from odometry, IMU and GPS
+// all matrices are fixed-size Eigen types: no heap allocation after construction
+// each measurement carries its own time stamp; the state is predicted forward to that time,
+// then corrected.  No ROS dependencies, so the filter can be exercised offline.
+
+#ifndef POSE_EKF_H_
+#define POSE_EKF_H_
+
+#include <Eigen/Core>
+#include <math.h>
+
+//state: x, y, heading psi, speed v, yaw rate omega, and the bias of the IMU's yaw rate
+const int EKF_X = 0;
+const int EKF_Y = 1;
+const int EKF_PSI = 2;
+const int EKF_V = 3;
+const int EKF_OMEGA = 4;
+const int EKF_GYRO_BIAS = 5;
+const int EKF_N_STATES = 6;
+
+typedef Eigen::Matrix<double, EKF_N_STATES, 1> EkfStateVector;
+typedef Eigen::Matrix<double, EKF_N_STATES, EKF_N_STATES> EkfCovariance;
+
+//noise parameters, as standard deviations; defaults suit the mobot simulation
+struct PoseEkfParams {
+    PoseEkfParams();
+    double accel_noise; // m/s^2: random changes in speed
+    double alpha_noise; // rad/s^2: random changes in yaw rate
+    double gyro_bias_drift; // rad/s/sqrt(s)
+    double odom_speed_noise; // m/s
+    double odom_omega_noise; // rad/s; odom yaw rate is poor (wheel diameter and track errors)
+    double imu_omega_noise; // rad/s
+    double gps_noise; // m, each of x and y
+    double max_late; // sec: measurements older than the state by more than this are dropped
+};
+
+class PoseEkf {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW // fixed-size members need aligned allocation, if made w/ new
+    PoseEkf();
+    void set_params(const PoseEkfParams &params) { params_ = params; }
+    const PoseEkfParams &get_params() const { return params_; }
+    //start from a pose known to within sigma_xy (m) and sigma_psi (rad), at rest, at time t
+    void initialize(double t, double x, double y, double psi, double sigma_xy, double sigma_psi);
+    bool is_initialized() const { return initialized_; }
+
+    //advance the state to time t; does nothing if t is not later than the current state
+    void predict(double t);
+    //measurement updates, each at time t; they return false if the measurement was dropped
+    // (filter not initialized, or measurement too late)
+    bool update_odom(double t, double speed, double omega);
+    bool update_imu(double t, double omega_z);
+    bool update_gps(double t, double x, double y);
+
+    double get_time() const { return t_; }
+    double get_x() const { return state_(EKF_X); }
+    double get_y() const { return state_(EKF_Y); }
+    double get_psi() const { return state_(EKF_PSI); }
+    const EkfStateVector &get_state() const { return state_; }
+    const EkfCovariance &get_covariance() const { return P_; }
+
+private:
+    bool prepare_update(double t);
+    //scalar measurement z = state(i) (+ state(j), if j >= 0), with variance r
+    void update_scalar(int i, int j, double z, double r);
+
+    PoseEkfParams params_;
+    bool initialized_;
+    double t_;
+    EkfStateVector state_;
+    EkfCovariance P_;
+};
+
+#endif
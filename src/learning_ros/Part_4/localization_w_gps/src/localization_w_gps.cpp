@@ -19,59 +19,92 @@
 #include <std_msgs/Float64.h>
 #include <xform_utils/xform_utils.h>
 
-const double MAIN_DT=0.01; //100Hz
-const double K_YAW = 0.1; //gain for heading corrections
-const double K_GPS= 0.002; // gain for GPS corrections
-const double L_MOVE = 0.1; //motion to travel, in m, before heading updates from GPS
+#include <localization_w_gps/pose_ekf.h>
 
-XformUtils xform_utils; // for type conversions
-
-//globals for communication w/ callbacks:
-double g_omega_z_imu=0; //imu
-bool g_imu_good = false;
-sensor_msgs::Imu g_imu;
+const double MIN_PUB_DT = 0.01; //publish estimates at up to 100Hz
+const double GPS_NOISE = 1.0; //std dev of gps x and y noise, m
 
-double g_x_gps=0; //gps
-double g_y_gps=0;
-bool g_gps_good=false;
-geometry_msgs::Pose g_gps_pose;
+XformUtils xform_utils; // for type conversions
 
-bool g_odom_good=false; //odom
-double g_odom_speed=0;
-nav_msgs::Odometry g_current_odom;
+//all fusion is done in PoseEkf; each callback predicts the filter up to its measurement's stamp,
+// then applies the measurement
+PoseEkf g_ekf;
+double g_t_last_pub = 0; //filter time of last published estimate
+ros::Publisher g_localization_publisher;
+ros::Publisher g_yaw_publisher;
+ros::Publisher g_true_yaw_publisher;
 
 //yaw from ideal gps/gazebo model state
 double g_true_yaw=0; //actual heading, as reported by gazebo w/o noise;
    //merely for debug/display purposes--can not use for localization
 
+//publish the current estimate, but not more often than MIN_PUB_DT (in filter time)
+void publishEstimate() {
+    double t = g_ekf.get_time();
+    if (t - g_t_last_pub < MIN_PUB_DT) {
+        return;
+    }
+    g_t_last_pub = t;
+    std_msgs::Float64 yaw_msg;
+    yaw_msg.data = g_ekf.get_psi(); //publish the yaw estimate, for use/display
+    g_yaw_publisher.publish(yaw_msg);
+
+    geometry_msgs::PoseStamped pose_estimate;
+    pose_estimate.header.stamp = ros::Time(t);
+    pose_estimate.pose.position.x = g_ekf.get_x();
+    pose_estimate.pose.position.y = g_ekf.get_y();
+    pose_estimate.pose.position.z = 0;
+    pose_estimate.pose.orientation = xform_utils.convertPlanarPsi2Quaternion(g_ekf.get_psi());
+    g_localization_publisher.publish(pose_estimate);
+}
 
 //receive publications from gazebo via node mobot_gazebo_state;
 //contains noisy position estimate in world coords
+//this is an unstamped Pose, so it is taken to be current at arrival
 void gazeboPoseCallback(const geometry_msgs::Pose& gazebo_pose) {
-   g_x_gps = gazebo_pose.position.x; //copy the state to member variables of this object
-   g_y_gps = gazebo_pose.position.y;
-   g_gps_pose = gazebo_pose;
-   g_gps_good = true;
+    double t = ros::Time::now().toSec();
+    if (!g_ekf.is_initialized()) {
+        //heading is unknown until the robot moves; start w/ zero, and a large uncertainty
+        g_ekf.initialize(t, gazebo_pose.position.x, gazebo_pose.position.y, 0.0, g_ekf.get_params().gps_noise, M_PI);
+        g_t_last_pub = t;
+        ROS_INFO("localizer initialized from first gps fix");
+        return;
+    }
+    if (g_ekf.update_gps(t, gazebo_pose.position.x, gazebo_pose.position.y)) {
+        publishEstimate();
+    }
 }
 
 //for debug, get actual heading from noiseless gazebo state
 void gazeboTrueYawCallback(const geometry_msgs::Pose& gazebo_pose) {
    geometry_msgs::Quaternion  state_quat = gazebo_pose.orientation;
    g_true_yaw = xform_utils.convertPlanarQuat2Phi(state_quat);
+   std_msgs::Float64 yaw_msg;
+   yaw_msg.data =g_true_yaw; //pub actual yaw, for comparison
+   g_true_yaw_publisher.publish(yaw_msg);
 }
 
-//drifty odom info--only care about speed here
+//drifty odom info: speed, and a (poor) yaw rate
 void odomCallback(const nav_msgs::Odometry& odom_rcvd) {
-    g_current_odom = odom_rcvd;
-    g_odom_speed = odom_rcvd.twist.twist.linear.x;
-    g_odom_good=true;   
+    if (odom_rcvd.header.stamp.isZero()) { //would be dropped by the filter as too old
+        ROS_WARN_ONCE("ignoring odom messages w/ no stamp");
+        return;
+    }
+    if (g_ekf.update_odom(odom_rcvd.header.stamp.toSec(), odom_rcvd.twist.twist.linear.x,
+            odom_rcvd.twist.twist.angular.z)) {
+        publishEstimate();
+    }
 }
 
-//imu callback: 
+//imu callback: only yaw rate is used
 void imuCallback(const sensor_msgs::Imu& imu_rcvd) {
-    g_imu = imu_rcvd;
-    g_omega_z_imu = g_imu.angular_velocity.z;
-    g_imu_good = true;
+    if (imu_rcvd.header.stamp.isZero()) {
+        ROS_WARN_ONCE("ignoring imu messages w/ no stamp");
+        return;
+    }
+    if (g_ekf.update_imu(imu_rcvd.header.stamp.toSec(), imu_rcvd.angular_velocity.z)) {
+        publishEstimate();
+    }
 }
 
 
@@ -79,116 +112,29 @@ int main(int argc, char** argv)
 {
     ros::init(argc, argv, "gps_localizer"); //node name
     ros::NodeHandle nh; // create a node handle; need to pass this to the class constructor
-    geometry_msgs::PoseStamped pose_estimate;
-    std_msgs::Float64 yaw_msg;
-    geometry_msgs::Quaternion quat_est;
-    double dx_odom_est=0;
-    double dy_odom_est=0;
-    double dl_odom_est=0;
-    
-    double yaw_est=0;
-    double x_est=0;
-    double y_est=0;
-    double x_est_old = 0;
-    double y_est_old = 0;    
-    
-    ros::Rate timer(1/MAIN_DT);
+    PoseEkfParams params; //defaults may be overridden by private params of the same names
+    ros::NodeHandle nh_private("~");
+    nh_private.param("accel_noise", params.accel_noise, params.accel_noise);
+    nh_private.param("alpha_noise", params.alpha_noise, params.alpha_noise);
+    nh_private.param("gyro_bias_drift", params.gyro_bias_drift, params.gyro_bias_drift);
+    nh_private.param("odom_speed_noise", params.odom_speed_noise, params.odom_speed_noise);
+    nh_private.param("odom_omega_noise", params.odom_omega_noise, params.odom_omega_noise);
+    nh_private.param("imu_omega_noise", params.imu_omega_noise, params.imu_omega_noise);
+    nh_private.param("gps_noise", params.gps_noise, GPS_NOISE);
+    g_ekf.set_params(params);
+
+    g_localization_publisher = nh.advertise<geometry_msgs::PoseStamped>("/mobot_localization", 1);
+    g_yaw_publisher = nh.advertise<std_msgs::Float64>("/yaw_estimate",1);
+    g_true_yaw_publisher = nh.advertise<std_msgs::Float64>("/true_yaw",1);
     ros::Subscriber gps_subscriber = nh.subscribe("gazebo_mobot_noisy_pose", 1, gazeboPoseCallback); 
     //test: can use ideal, noiseless pose:
     //ros::Subscriber gps_subscriber = nh.subscribe("gazebo_mobot_pose", 1, gazeboPoseCallback);     
-    ros::Subscriber imu_subscriber = nh.subscribe("/imu_data", 1, imuCallback); 
-    ros::Subscriber odom_subscriber = nh.subscribe("/drifty_odom",1,odomCallback);
+    ros::Subscriber imu_subscriber = nh.subscribe("/imu_data", 10, imuCallback); 
+    ros::Subscriber odom_subscriber = nh.subscribe("/drifty_odom",10,odomCallback);
     ros::Subscriber true_state_subscriber = nh.subscribe("gazebo_mobot_pose",1,gazeboTrueYawCallback);
-    ros::Publisher localization_publisher = nh.advertise<geometry_msgs::PoseStamped>("/mobot_localization", 1);
-    ros::Publisher yaw_publisher = nh.advertise<std_msgs::Float64>("/yaw_estimate",1);
-    ros::Publisher true_yaw_publisher = nh.advertise<std_msgs::Float64>("/true_yaw",1);
-    
-    ROS_INFO("warm up callbacks: ");
+
     ROS_INFO("waiting on gps: ");
-    while (!g_gps_good) {
-        ros::spinOnce();
-        ros::Duration(0.1).sleep();
-            }
-    pose_estimate.header.stamp = ros::Time::now();
-    pose_estimate.pose.position.x = g_x_gps;
-    pose_estimate.pose.position.y = g_y_gps;    
-    pose_estimate.pose.position.z = 0;
-    
-    ROS_INFO("got gps info; wait for imu:");
-    while (!g_imu_good) {
-        ros::spinOnce();
-        ros::Duration(0.1).sleep();        
-    }
-    ROS_INFO("imu is good; wait for odom:");
-    while (!g_odom_good) {
-        ros::spinOnce();
-        ros::Duration(0.1).sleep();        
-    }    
-    double dang_gps=0;
-    double dang_odom=0;
-    double dx_odom,dy_odom;
-    double delta_odom_x=0;
-    double delta_odom_y=0;
-    double yaw_err=0;
-    double move_dist = 0;
-    //main, timed loop:
-    x_est = g_x_gps;
-    x_est_old = x_est;
-    y_est = g_y_gps;
-    y_est_old = y_est;
-    while(ros::ok()) {
-        ros::spinOnce();
-
-        x_est = (1-K_GPS)*x_est + K_GPS*g_x_gps; //incorporate gps feedback
-        y_est = (1-K_GPS)*y_est + K_GPS*g_y_gps; //ditto
-        dl_odom_est = MAIN_DT*g_odom_speed; //moved this far in 1 DT
-        move_dist+= dl_odom_est; //keep track of cumulative move distance
-        yaw_est+= MAIN_DT*g_omega_z_imu; //integrate the IMU's yaw to estimate heading
-            if (yaw_est<-M_PI) yaw_est+= 2.0*M_PI; //remap periodically
-            if (yaw_est>M_PI) yaw_est-= 2.0*M_PI;        
-        
-        dx_odom = dl_odom_est*cos(yaw_est); //incremental x and y motions, as
-        dy_odom = dl_odom_est*sin(yaw_est); //inferred from speed and heading est
-        x_est+= dx_odom; //cumulative x and y estimates updated from odometry
-        y_est+= dy_odom;
-        delta_odom_x+= dx_odom; //keep track of x, y displacements over specified
-        delta_odom_y+= dy_odom; // distances for yaw updates
-        if (fabs(move_dist) > L_MOVE) { //if moved this far since last yaw update,
-            //time to do another yaw update based on GPS
-            //since last update, express motion in polar coords based on gps
-            dang_gps = atan2((y_est-y_est_old),(x_est-x_est_old));
-            //similarly, update in polar coords based on odometry
-            dang_odom = atan2(delta_odom_y,delta_odom_x);
-            //if gps and odom disagree on avg heading, make a correction
-            yaw_err = dang_gps - dang_odom;
-            if (yaw_err>M_PI) yaw_err-=2.0*M_PI;
-            if (yaw_err<-M_PI) yaw_err+=2.0*M_PI;
-            //K_YAW should not be lareger than unity; smaller--> less noise sensitivity
-            yaw_est+=K_YAW*yaw_err; //here's the yaw update due to gps
-
-            y_est_old=y_est; //save this state as a checkpoint for next yaw update
-            x_est_old=x_est;
-            move_dist=0;
-            delta_odom_y=0;
-            delta_odom_x=0;
-        }
-        
-        yaw_msg.data = yaw_est; //publish the yaw estimate, for use/display
-        yaw_publisher.publish(yaw_msg);
-        
-        yaw_msg.data =g_true_yaw; //pub actual yaw, for comparison
-        true_yaw_publisher.publish(yaw_msg);
-        //publish x and y estimates 
-        pose_estimate.header.stamp = ros::Time::now();
-        pose_estimate.pose.position.x = x_est;
-        pose_estimate.pose.position.y = y_est;    
-        // convert heading to quaternion and publish here as well
-        quat_est = xform_utils.convertPlanarPsi2Quaternion(yaw_est);
-        pose_estimate.pose.orientation = quat_est;
-        localization_publisher.publish(pose_estimate);
-
-        timer.sleep();
-        ros::spinOnce();
-    }
-  return 0;
-}
\ No newline at end of file
+    //all work is done in the callbacks, as measurements arrive
+    ros::spin();
+    return 0;
+}
@@ -0,0 +1,136 @@
+// pose_ekf.cpp: implementation of PoseEkf; see pose_ekf.h
+#include <localization_w_gps/pose_ekf.h>
+
+PoseEkfParams::PoseEkfParams() {
+    accel_noise = 1.0;
+    alpha_noise = 2.0;
+    gyro_bias_drift = 0.0003;
+    odom_speed_noise = 0.05;
+    odom_omega_noise = 0.5;
+    imu_omega_noise = 0.01;
+    gps_noise = 1.0;
+    max_late = 0.1;
+}
+
+PoseEkf::PoseEkf() {
+    initialized_ = false;
+    t_ = 0.0;
+    state_.setZero();
+    P_.setIdentity();
+}
+
+void PoseEkf::initialize(double t, double x, double y, double psi, double sigma_xy, double sigma_psi) {
+    t_ = t;
+    state_.setZero();
+    state_(EKF_X) = x;
+    state_(EKF_Y) = y;
+    state_(EKF_PSI) = psi;
+    P_.setZero();
+    P_(EKF_X, EKF_X) = sigma_xy * sigma_xy;
+    P_(EKF_Y, EKF_Y) = sigma_xy * sigma_xy;
+    P_(EKF_PSI, EKF_PSI) = sigma_psi * sigma_psi;
+    P_(EKF_V, EKF_V) = 0.01;
+    P_(EKF_OMEGA, EKF_OMEGA) = 0.01;
+    P_(EKF_GYRO_BIAS, EKF_GYRO_BIAS) = 0.01 * 0.01;
+    initialized_ = true;
+}
+
+//keep heading within +/- pi
+static double wrap_angle(double psi) {
+    if (psi > M_PI) psi -= 2.0 * M_PI;
+    if (psi < -M_PI) psi += 2.0 * M_PI;
+    return psi;
+}
+
+//constant speed and yaw rate over dt, moving along the mean heading of the interval
+//the Jacobian F is identity except in the x, y and psi rows, so P = F*P*F' is computed as an
+// update of just those rows, then of just those columns
+void PoseEkf::predict(double t) {
+    double dt = t - t_;
+    if (!initialized_ || dt <= 0.0) {
+        return;
+    }
+    double v = state_(EKF_V);
+    double omega = state_(EKF_OMEGA);
+    double psi_mid = state_(EKF_PSI) + 0.5 * omega * dt;
+    double c = cos(psi_mid);
+    double s = sin(psi_mid);
+    state_(EKF_X) += v * dt * c;
+    state_(EKF_Y) += v * dt * s;
+    state_(EKF_PSI) = wrap_angle(state_(EKF_PSI) + omega * dt);
+
+    //nonzero off-diagonal terms of F: d(x,y)/d(psi,v,omega) and d(psi)/d(omega)
+    double fx_psi = -v * dt * s, fx_v = dt * c, fx_omega = -0.5 * v * dt * dt * s;
+    double fy_psi = v * dt * c, fy_v = dt * s, fy_omega = 0.5 * v * dt * dt * c;
+    P_.row(EKF_X) += fx_psi * P_.row(EKF_PSI) + fx_v * P_.row(EKF_V) + fx_omega * P_.row(EKF_OMEGA);
+    P_.row(EKF_Y) += fy_psi * P_.row(EKF_PSI) + fy_v * P_.row(EKF_V) + fy_omega * P_.row(EKF_OMEGA);
+    P_.row(EKF_PSI) += dt * P_.row(EKF_OMEGA);
+    P_.col(EKF_X) += fx_psi * P_.col(EKF_PSI) + fx_v * P_.col(EKF_V) + fx_omega * P_.col(EKF_OMEGA);
+    P_.col(EKF_Y) += fy_psi * P_.col(EKF_PSI) + fy_v * P_.col(EKF_V) + fy_omega * P_.col(EKF_OMEGA);
+    P_.col(EKF_PSI) += dt * P_.col(EKF_OMEGA);
+    P_(EKF_V, EKF_V) += params_.accel_noise * params_.accel_noise * dt;
+    P_(EKF_OMEGA, EKF_OMEGA) += params_.alpha_noise * params_.alpha_noise * dt;
+    P_(EKF_GYRO_BIAS, EKF_GYRO_BIAS) += params_.gyro_bias_drift * params_.gyro_bias_drift * dt;
+    t_ = t;
+}
+
+//predict up to a measurement at time t; a slightly late measurement is applied to the current
+// state, as if it had arrived on time
+bool PoseEkf::prepare_update(double t) {
+    if (!initialized_ || t < t_ - params_.max_late) {
+        return false;
+    }
+    predict(t);
+    return true;
+}
+
+//every measurement here is a single state, or (IMU) the sum of two states, so P*h' is just a
+// column of P, or the sum of two.  Heading is not wrapped here: the corrections are small, and
+// each update_*() wraps it once, after its last scalar update
+void PoseEkf::update_scalar(int i, int j, double z, double r) {
+    EkfStateVector Ph = P_.col(i);
+    double z_predicted = state_(i);
+    if (j >= 0) {
+        Ph += P_.col(j);
+        z_predicted += state_(j);
+    }
+    double innovation_var = Ph(i) + r;
+    if (j >= 0) {
+        innovation_var += Ph(j);
+    }
+    EkfStateVector K = Ph / innovation_var;
+    state_ += K * (z - z_predicted);
+    P_.noalias() -= K * Ph.transpose();
+}
+
+bool PoseEkf::update_odom(double t, double speed, double omega) {
+    if (!prepare_update(t)) {
+        return false;
+    }
+    update_scalar(EKF_V, -1, speed, params_.odom_speed_noise * params_.odom_speed_noise);
+    update_scalar(EKF_OMEGA, -1, omega, params_.odom_omega_noise * params_.odom_omega_noise);
+    state_(EKF_PSI) = wrap_angle(state_(EKF_PSI));
+    return true;
+}
+
+//the IMU reports yaw rate plus its bias
+bool PoseEkf::update_imu(double t, double omega_z) {
+    if (!prepare_update(t)) {
+        return false;
+    }
+    update_scalar(EKF_OMEGA, EKF_GYRO_BIAS, omega_z, params_.imu_omega_noise * params_.imu_omega_noise);
+    state_(EKF_PSI) = wrap_angle(state_(EKF_PSI));
+    return true;
+}
+
+//x and y errors are independent, so they are applied as two scalar updates
+bool PoseEkf::update_gps(double t, double x, double y) {
+    if (!prepare_update(t)) {
+        return false;
+    }
+    double r = params_.gps_noise * params_.gps_noise;
+    update_scalar(EKF_X, -1, x, r);
+    update_scalar(EKF_Y, -1, y, r);
+    state_(EKF_PSI) = wrap_angle(state_(EKF_PSI));
+    return true;
+}
@@ -0,0 +1,246 @@
+// pose_ekf_test_main.cpp
+// feed PoseEkf synthetic sensor data, like that of the simulation, from a few trajectories:
+//   drifty odom (50Hz): speed with a scale error; yaw rate corrupted by the wheel-diameter error
+//   IMU (100Hz): yaw rate, w/ noise and (in some runs) a bias
+//   GPS (100Hz): x and y, w/ 1m std dev noise
+// the same data is fed to the former complementary-filter loop (K_GPS, K_YAW, 100Hz).  Both start
+// from the first GPS fix, w/ heading 0.  The EKF should converge (position err < 0.5m and heading
+// err < 0.1 rad, for good) sooner than the old loop, w/ lower rms error.  The compute time of
+// each, per 10ms of sensor data, is printed for comparison
+
+#include <localization_w_gps/pose_ekf.h>
+#include <stdio.h>
+#include <time.h>
+#include <random>
+#include <vector>
+
+//fixed-seed normal deviates, computed the same way on any platform
+class Noise {
+public:
+    Noise(unsigned seed) : generator_(seed) {}
+    double gauss(double sigma) {
+        double u1 = (generator_() + 1.0) / 4294967297.0;
+        double u2 = generator_() / 4294967296.0;
+        return sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+    }
+private:
+    std::mt19937 generator_;
+};
+
+static double wrap(double angle) {
+    return atan2(sin(angle), cos(angle));
+}
+
+static double now_sec() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 1.0e-9 * t.tv_nsec;
+}
+
+enum SensorType { ODOM, IMU, GPS };
+
+struct Measurement {
+    double t;
+    SensorType type;
+    double a, b; // odom: speed, omega; imu: omega; gps: x, y
+};
+
+struct TruePose {
+    double x, y, psi;
+};
+
+struct Scenario {
+    const char *name;
+    double x0, y0, psi0;
+    double gyro_bias;
+    int shape; // 0: straight w/ gentle S-turns; 1: circle; 2: rounded square, w/ stops
+};
+
+const double SIM_DT = 0.001;
+const double T_RUN = 120.0;
+
+//speed and yaw rate of each trajectory at time t
+static void command(int shape, double t, double &v, double &omega) {
+    if (shape == 0) {
+        v = (t < 2.0) ? 0.5 * t : 1.0;
+        omega = 0.3 * sin(0.2 * t);
+    } else if (shape == 1) {
+        v = (t < 2.0) ? 0.4 * t : 0.8;
+        omega = v / 4.0;
+    } else {
+        double tau = fmod(t, 15.0); // 10s straight, 5s of turning
+        v = (tau < 10.0) ? 0.7 : 0.4;
+        omega = (tau < 10.0) ? 0.0 : 0.5 * M_PI / 5.0;
+        if (fmod(t, 60.0) > 57.0) { // stand still for a bit
+            v = 0.0;
+            omega = 0.0;
+        }
+    }
+}
+
+static void simulate(const Scenario &sc, std::vector<Measurement> &meas, std::vector<TruePose> &truth) {
+    Noise noise(12345);
+    TruePose pose = {sc.x0, sc.y0, sc.psi0};
+    int n = (int) (T_RUN / SIM_DT);
+    for (int i = 0; i <= n; i++) {
+        double t = i * SIM_DT;
+        double v, omega;
+        command(sc.shape, t, v, omega);
+        if (i % 20 == 0) { // odom
+            Measurement m = {t, ODOM, 1.0075 * v + noise.gauss(0.01), omega + 0.054 * v + noise.gauss(0.01)};
+            meas.push_back(m);
+        }
+        if (i % 10 == 0) { // imu, then gps
+            Measurement m = {t, IMU, omega + sc.gyro_bias + noise.gauss(0.002), 0.0};
+            meas.push_back(m);
+            Measurement g = {t, GPS, pose.x + noise.gauss(1.0), pose.y + noise.gauss(1.0)};
+            meas.push_back(g);
+            truth.push_back(pose);
+        }
+        pose.x += v * SIM_DT * cos(pose.psi + 0.5 * omega * SIM_DT);
+        pose.y += v * SIM_DT * sin(pose.psi + 0.5 * omega * SIM_DT);
+        pose.psi = wrap(pose.psi + omega * SIM_DT);
+    }
+}
+
+struct Result {
+    double t_converged;
+    double rms_pos, rms_psi;
+    double ns_per_tick; // compute time per 10ms of sensor data
+};
+
+//track errors at each 10ms tick; converged from the last tick that was out of tolerance
+static void score(const std::vector<TruePose> &truth, const std::vector<TruePose> &est, Result &r) {
+    int n = truth.size();
+    int last_bad = -1;
+    double sum_pos = 0.0, sum_psi = 0.0;
+    for (int i = 0; i < n; i++) {
+        double e_pos = hypot(est[i].x - truth[i].x, est[i].y - truth[i].y);
+        double e_psi = fabs(wrap(est[i].psi - truth[i].psi));
+        if (e_pos > 0.5 || e_psi > 0.1) last_bad = i;
+        if (i >= n / 2) {
+            sum_pos += e_pos * e_pos;
+            sum_psi += e_psi * e_psi;
+        }
+    }
+    r.t_converged = (last_bad + 1) * 0.01;
+    r.rms_pos = sqrt(sum_pos / (n - n / 2));
+    r.rms_psi = sqrt(sum_psi / (n - n / 2));
+}
+
+static void run_ekf(const std::vector<Measurement> &meas, int n_ticks, std::vector<TruePose> &est, Result &r) {
+    PoseEkf ekf;
+    est.clear();
+    size_t i = 0;
+    double t0 = now_sec();
+    for (int tick = 0; tick < n_ticks; tick++) {
+        double t_tick = tick * 0.01;
+        for (; i < meas.size() && meas[i].t <= t_tick + 1e-9; i++) {
+            const Measurement &m = meas[i];
+            if (!ekf.is_initialized()) {
+                if (m.type == GPS) ekf.initialize(m.t, m.a, m.b, 0.0, 1.0, M_PI);
+                continue;
+            }
+            if (m.type == ODOM) ekf.update_odom(m.t, m.a, m.b);
+            else if (m.type == IMU) ekf.update_imu(m.t, m.a);
+            else ekf.update_gps(m.t, m.a, m.b);
+        }
+        TruePose p = {ekf.get_x(), ekf.get_y(), ekf.get_psi()};
+        est.push_back(p);
+    }
+    r.ns_per_tick = 1.0e9 * (now_sec() - t0) / n_ticks;
+}
+
+//the former localization_w_gps loop, run at 100Hz on the latest value of each sensor
+static void run_complementary(const std::vector<Measurement> &meas, int n_ticks, std::vector<TruePose> &est, Result &r) {
+    const double MAIN_DT = 0.01, K_YAW = 0.1, K_GPS = 0.002, L_MOVE = 0.1;
+    double x_gps = 0, y_gps = 0, odom_speed = 0, omega_imu = 0;
+    bool gps_good = false;
+    double x_est = 0, y_est = 0, yaw_est = 0, x_est_old = 0, y_est_old = 0;
+    double move_dist = 0, delta_odom_x = 0, delta_odom_y = 0;
+    est.clear();
+    size_t i = 0;
+    double t0 = now_sec();
+    for (int tick = 0; tick < n_ticks; tick++) {
+        double t_tick = tick * 0.01;
+        for (; i < meas.size() && meas[i].t <= t_tick + 1e-9; i++) {
+            const Measurement &m = meas[i];
+            if (m.type == ODOM) odom_speed = m.a;
+            else if (m.type == IMU) omega_imu = m.a;
+            else {
+                if (!gps_good) {
+                    x_est = x_est_old = m.a;
+                    y_est = y_est_old = m.b;
+                }
+                x_gps = m.a;
+                y_gps = m.b;
+                gps_good = true;
+            }
+        }
+        if (gps_good) {
+            x_est = (1 - K_GPS) * x_est + K_GPS * x_gps;
+            y_est = (1 - K_GPS) * y_est + K_GPS * y_gps;
+            double dl_odom_est = MAIN_DT * odom_speed;
+            move_dist += dl_odom_est;
+            yaw_est += MAIN_DT * omega_imu;
+            if (yaw_est < -M_PI) yaw_est += 2.0 * M_PI;
+            if (yaw_est > M_PI) yaw_est -= 2.0 * M_PI;
+            double dx_odom = dl_odom_est * cos(yaw_est);
+            double dy_odom = dl_odom_est * sin(yaw_est);
+            x_est += dx_odom;
+            y_est += dy_odom;
+            delta_odom_x += dx_odom;
+            delta_odom_y += dy_odom;
+            if (fabs(move_dist) > L_MOVE) {
+                double yaw_err = wrap(atan2(y_est - y_est_old, x_est - x_est_old) - atan2(delta_odom_y, delta_odom_x));
+                yaw_est += K_YAW * yaw_err;
+                y_est_old = y_est;
+                x_est_old = x_est;
+                move_dist = 0;
+                delta_odom_y = 0;
+                delta_odom_x = 0;
+            }
+        }
+        TruePose p = {x_est, y_est, yaw_est};
+        est.push_back(p);
+    }
+    r.ns_per_tick = 1.0e9 * (now_sec() - t0) / n_ticks;
+}
+
+int main() {
+    const Scenario scenarios[] = {
+        {"S-turns", 2.0, -1.0, 2.0, 0.0, 0},
+        {"circle, gyro bias", 0.0, 0.0, -1.0, 0.02, 1},
+        {"square w/ stops", 5.0, 5.0, 0.5, 0.01, 2},
+    };
+    for (int k = 0; k < 3; k++) {
+        const Scenario &sc = scenarios[k];
+        std::vector<Measurement> meas;
+        std::vector<TruePose> truth, est;
+        simulate(sc, meas, truth);
+        int n_ticks = truth.size();
+        Result comp, ekf;
+        run_complementary(meas, n_ticks, est, comp);
+        score(truth, est, comp);
+        run_ekf(meas, n_ticks, est, ekf);
+        score(truth, est, ekf);
+        printf("%-18s complementary: converged %6.2fs, rms err %.3fm %.4frad, %5.1f ns per 10ms\n",
+                sc.name, comp.t_converged, comp.rms_pos, comp.rms_psi, comp.ns_per_tick);
+        printf("%-18s EKF:           converged %6.2fs, rms err %.3fm %.4frad, %5.1f ns per 10ms\n",
+                "", ekf.t_converged, ekf.rms_pos, ekf.rms_psi, ekf.ns_per_tick);
+        if (ekf.t_converged >= comp.t_converged || ekf.rms_pos >= comp.rms_pos) {
+            printf("FAILED: EKF should converge sooner than the complementary filter, w/ lower error\n");
+            return 1;
+        }
+    }
+
+    //measurements more than max_late older than the state are dropped
+    PoseEkf ekf;
+    ekf.initialize(10.0, 0.0, 0.0, 0.0, 1.0, M_PI);
+    if (ekf.update_odom(9.0, 1.0, 0.0) || !ekf.update_odom(10.05, 1.0, 0.0)) {
+        printf("FAILED: late measurement should be dropped, and a current one applied\n");
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
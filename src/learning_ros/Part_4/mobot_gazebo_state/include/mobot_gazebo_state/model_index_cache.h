@@ -0,0 +1,49 @@
+// model_index_cache.h header file //
+// remembers where each of a set of tracked models appears in the (long) list of model names of
+// gazebo/model_states, so that each message costs O(tracked models), instead of a scan w/ string
+// compares over all models.  No ROS dependencies; see model_index_cache.cpp
+
+#ifndef MODEL_INDEX_CACHE_H_
+#define MODEL_INDEX_CACHE_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class ModelIndexCache {
+public:
+    ModelIndexCache();
+    //track a model by name; returns its slot, 0, 1, 2..., in the order added
+    int add_model(const std::string &name);
+    int n_tracked() const { return tracked_names_.size(); }
+    const std::string &tracked_name(int slot) const { return tracked_names_[slot]; }
+
+    //bring the cache up to date w/ the latest list of model names; returns true if it had to be
+    // rebuilt.  The list is taken to be unchanged if it has the same length and each tracked model
+    // found before is still at its cached index: one string compare per tracked model.
+    // (A model spawned and another deleted between two messages, leaving the length the same,
+    // is missed if the spawned one is tracked and was absent; so while any tracked model is absent,
+    // the cache is also rebuilt every missing_recheck_period updates.  With all tracked models
+    // found, there is no periodic rebuild)
+    bool update(const std::vector<std::string> &names);
+    //updates between rebuilds while a tracked model is absent; default 100
+    void set_missing_recheck_period(int n_updates) { missing_recheck_period_ = n_updates; }
+    //index of the tracked model in slot, in the names of the latest update(), or -1 if absent
+    int index(int slot) const { return index_[slot]; }
+    int n_rebuilds() const { return n_rebuilds_; }
+
+private:
+    void rebuild(const std::vector<std::string> &names);
+
+    std::vector<std::string> tracked_names_;
+    std::unordered_map<std::string, int> slot_of_name_;
+    std::vector<int> index_;
+    size_t n_names_; // length of the list of names the cache was built from
+    bool valid_;
+    int n_rebuilds_;
+    int n_missing_; // tracked models absent at the last rebuild
+    int n_since_rebuild_; // updates since then; counted only while n_missing_ > 0
+    int missing_recheck_period_;
+};
+
+#endif
@@ -0,0 +1,50 @@
+// model_state_demux.h header file //
+// subscribes once to gazebo/model_states, and republishes the pose of each of a configured set of
+// models, "name", on:
+//   gazebo_<name>_pose:        geometry_msgs/Pose, as reported by gazebo
+//   gazebo_<name>_noisy_pose:  same, w/ gaussian noise added to x and y, and orientation suppressed
+//                              (a stand-in for GPS)
+//   gazebo_<name>_yaw:         std_msgs/Float64 heading, if publish_yaw is set
+// models are chosen by the private param "models" (list of names; default: [mobot]); noise by
+// "noise_std" (m; default 1.0); each model has its own random-number generator, seeded by "seed"
+// (default 0) plus its slot
+// see model_state_demux.cpp
+
+#ifndef MODEL_STATE_DEMUX_H_
+#define MODEL_STATE_DEMUX_H_
+
+#include <string>
+#include <vector>
+#include <random>
+
+#include <ros/ros.h>
+#include <gazebo_msgs/ModelStates.h>
+#include <geometry_msgs/Pose.h>
+#include <std_msgs/Float64.h>
+#include <mobot_gazebo_state/model_index_cache.h>
+
+class ModelStateDemux {
+public:
+    ModelStateDemux(ros::NodeHandle* nodehandle, bool publish_yaw);
+
+private:
+    struct TrackedModel {
+        ros::Publisher pose_publisher;
+        ros::Publisher noisy_pose_publisher;
+        ros::Publisher yaw_publisher;
+        std::mt19937 generator;
+        std::normal_distribution<double> noise;
+        bool warned_missing; // warn only once each time the model goes missing
+    };
+
+    ros::NodeHandle nh_;
+    ros::Subscriber model_states_subscriber_;
+    bool publish_yaw_;
+    ModelIndexCache index_cache_;
+    std::vector<TrackedModel> models_; // by cache slot
+    geometry_msgs::Quaternion identity_quat_;
+
+    void modelStatesCallback(const gazebo_msgs::ModelStates& model_states);
+};
+
+#endif
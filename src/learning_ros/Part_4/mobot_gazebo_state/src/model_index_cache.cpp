@@ -0,0 +1,59 @@
+// model_index_cache.cpp: implementation of ModelIndexCache; see model_index_cache.h
+#include <mobot_gazebo_state/model_index_cache.h>
+#include <algorithm>
+
+ModelIndexCache::ModelIndexCache() {
+    n_names_ = 0;
+    valid_ = false;
+    n_rebuilds_ = 0;
+    n_missing_ = 0;
+    n_since_rebuild_ = 0;
+    missing_recheck_period_ = 100;
+}
+
+int ModelIndexCache::add_model(const std::string &name) {
+    std::unordered_map<std::string, int>::const_iterator it = slot_of_name_.find(name);
+    if (it != slot_of_name_.end()) {
+        return it->second; // already tracked
+    }
+    int slot = tracked_names_.size();
+    tracked_names_.push_back(name);
+    slot_of_name_[name] = slot;
+    index_.push_back(-1);
+    valid_ = false;
+    return slot;
+}
+
+bool ModelIndexCache::update(const std::vector<std::string> &names) {
+    bool changed = !valid_ || names.size() != n_names_;
+    if (n_missing_ > 0 && ++n_since_rebuild_ >= missing_recheck_period_) {
+        changed = true; // look again for the absent models
+    }
+    for (int slot = 0; slot < (int) index_.size() && !changed; slot++) {
+        int i = index_[slot];
+        if (i >= 0 && names[i] != tracked_names_[slot]) {
+            changed = true;
+        }
+    }
+    if (changed) {
+        rebuild(names);
+    }
+    return changed;
+}
+
+//one pass over all names, w/ a hash lookup of each
+void ModelIndexCache::rebuild(const std::vector<std::string> &names) {
+    std::fill(index_.begin(), index_.end(), -1);
+    n_missing_ = index_.size();
+    for (int i = 0; i < (int) names.size(); i++) {
+        std::unordered_map<std::string, int>::const_iterator it = slot_of_name_.find(names[i]);
+        if (it != slot_of_name_.end() && index_[it->second] < 0) {
+            index_[it->second] = i;
+            n_missing_--;
+        }
+    }
+    n_since_rebuild_ = 0;
+    n_names_ = names.size();
+    valid_ = true;
+    n_rebuilds_++;
+}
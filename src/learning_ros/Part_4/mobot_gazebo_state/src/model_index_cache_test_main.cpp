@@ -0,0 +1,69 @@
+// model_index_cache_test_main.cpp
+// check that ModelIndexCache follows tracked models as models are spawned and deleted
+
+#include <mobot_gazebo_state/model_index_cache.h>
+#include <stdio.h>
+
+int main() {
+    ModelIndexCache cache;
+    int s_mobot = cache.add_model("mobot");
+    int s_bot2 = cache.add_model("bot2");
+    if (cache.add_model("mobot") != s_mobot) {
+        printf("FAILED: re-adding a model should give its slot\n");
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    names.push_back("ground_plane");
+    cache.update(names);
+    if (cache.index(s_mobot) != -1 || cache.index(s_bot2) != -1) {
+        printf("FAILED: absent models\n");
+        return 1;
+    }
+    names.push_back("mobot");
+    if (!cache.update(names) || cache.index(s_mobot) != 1) {
+        printf("FAILED: spawned model not found\n");
+        return 1;
+    }
+    if (cache.update(names)) {
+        printf("FAILED: unchanged list should not rebuild\n");
+        return 1;
+    }
+    names.insert(names.begin() + 1, "bot2");
+    cache.update(names);
+    if (cache.index(s_bot2) != 1 || cache.index(s_mobot) != 2) {
+        printf("FAILED: insert should shift indices\n");
+        return 1;
+    }
+    names.erase(names.begin());
+    names.push_back("box");
+    if (!cache.update(names) || cache.index(s_bot2) != 0 || cache.index(s_mobot) != 1) {
+        printf("FAILED: same length, tracked model moved\n");
+        return 1;
+    }
+    names.erase(names.begin() + 1);
+    cache.update(names);
+    if (cache.index(s_mobot) != -1 || cache.index(s_bot2) != 0) {
+        printf("FAILED: deleted model\n");
+        return 1;
+    }
+
+    //tracked model spawned in place of another, leaving the length the same: found by the
+    // periodic recheck while it is absent, and no more rechecks once all are found
+    cache.set_missing_recheck_period(10);
+    names[1] = "mobot";
+    int n_updates = 1;
+    while (!cache.update(names) && n_updates < 100) n_updates++;
+    if (cache.index(s_mobot) != 1 || n_updates > 10) {
+        printf("FAILED: absent model should be found by the periodic recheck\n");
+        return 1;
+    }
+    int n_rebuilds = cache.n_rebuilds();
+    for (int i = 0; i < 100; i++) cache.update(names);
+    if (cache.n_rebuilds() != n_rebuilds) {
+        printf("FAILED: no periodic rebuild once all tracked models are found\n");
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
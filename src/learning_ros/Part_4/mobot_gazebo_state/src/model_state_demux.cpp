@@ -0,0 +1,70 @@
+// model_state_demux.cpp: implementation of ModelStateDemux; see model_state_demux.h
+#include <mobot_gazebo_state/model_state_demux.h>
+#include <math.h>
+
+ModelStateDemux::ModelStateDemux(ros::NodeHandle* nodehandle, bool publish_yaw) : nh_(*nodehandle) {
+    publish_yaw_ = publish_yaw;
+    ros::NodeHandle nh_private("~");
+    std::vector<std::string> names;
+    if (!nh_private.getParam("models", names)) {
+        names.push_back("mobot");
+    }
+    double noise_std;
+    int seed;
+    nh_private.param("noise_std", noise_std, 1.0);
+    nh_private.param("seed", seed, 0);
+
+    for (int i = 0; i < (int) names.size(); i++) {
+        int slot = index_cache_.add_model(names[i]);
+        if (slot < (int) models_.size()) {
+            continue; // listed twice
+        }
+        TrackedModel model;
+        model.pose_publisher = nh_.advertise<geometry_msgs::Pose>("gazebo_" + names[i] + "_pose", 1);
+        model.noisy_pose_publisher = nh_.advertise<geometry_msgs::Pose>("gazebo_" + names[i] + "_noisy_pose", 1);
+        if (publish_yaw_) {
+            model.yaw_publisher = nh_.advertise<std_msgs::Float64>("gazebo_" + names[i] + "_yaw", 1);
+        }
+        model.generator.seed(seed + slot);
+        model.noise = std::normal_distribution<double>(0.0, noise_std);
+        model.warned_missing = false;
+        models_.push_back(model);
+        ROS_INFO("publishing state of gazebo model %s", names[i].c_str());
+    }
+    //suppress the orientation output for noisy state; fill out a legal, constant quaternion
+    identity_quat_.x = 0;
+    identity_quat_.y = 0;
+    identity_quat_.z = 0;
+    identity_quat_.w = 1;
+    model_states_subscriber_ = nh_.subscribe("gazebo/model_states", 1, &ModelStateDemux::modelStatesCallback, this);
+}
+
+void ModelStateDemux::modelStatesCallback(const gazebo_msgs::ModelStates& model_states) {
+    index_cache_.update(model_states.name);
+    for (int slot = 0; slot < (int) models_.size(); slot++) {
+        TrackedModel &model = models_[slot];
+        int imodel = index_cache_.index(slot);
+        if (imodel < 0) {
+            if (!model.warned_missing) {
+                ROS_WARN("state of %s model not found", index_cache_.tracked_name(slot).c_str());
+                model.warned_missing = true;
+            }
+            continue;
+        }
+        model.warned_missing = false;
+        const geometry_msgs::Pose &pose = model_states.pose[imodel];
+        model.pose_publisher.publish(pose);
+        geometry_msgs::Pose noisy_pose;
+        noisy_pose.position = pose.position;
+        noisy_pose.position.x += model.noise(model.generator);
+        noisy_pose.position.y += model.noise(model.generator);
+        noisy_pose.orientation = identity_quat_;
+        model.noisy_pose_publisher.publish(noisy_pose); //publish noisy values
+        if (publish_yaw_) {
+            std_msgs::Float64 yaw_msg;
+            // cheap conversion from quaternion to heading for planar motion
+            yaw_msg.data = 2.0 * atan2(pose.orientation.z, pose.orientation.w);
+            model.yaw_publisher.publish(yaw_msg);
+        }
+    }
+}
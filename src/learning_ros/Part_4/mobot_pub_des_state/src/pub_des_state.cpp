@@ -5,8 +5,8 @@ DesStatePublisher::DesStatePublisher(ros::NodeHandle& nh) : nh_(nh) {
     //as_(nh, "pub_des_state_server", boost::bind(&DesStatePublisher::executeCB, this, _1),false) {
     //as_.start(); //start the server running
     //configure the trajectory builder: 
-    //dt_ = dt; //send desired-state messages at fixed rate, e.g. 0.02 sec = 50Hz
-    trajBuilder_.set_dt(dt);
+    dt_ = dt; //send desired-state messages at fixed rate, e.g. 0.02 sec = 50Hz
+    trajBuilder_.set_dt(dt_);
     //dynamic parameters: should be tuned for target system
     accel_max_ = accel_max;
     trajBuilder_.set_accel_max(accel_max_);
@@ -38,6 +38,25 @@ DesStatePublisher::DesStatePublisher(ros::NodeHandle& nh) : nh_(nh) {
     halt_state_ = current_des_state_;
     seg_start_state_ = current_des_state_;
     seg_end_state_ = current_des_state_;
+    traj_seg_i_ = 0;
+    traj_seg_t_ = 0.0;
+    path_lookahead_ = path_lookahead;
+    n_planned_subgoals_ = 0;
+    plan_id_ = 0;
+    path_flushed_ = false;
+    planner_shutdown_ = false;
+    replan_requested_ = false;
+    replan_ready_ = false;
+    planner_thread_ = boost::thread(&DesStatePublisher::plannerThread, this);
+}
+
+DesStatePublisher::~DesStatePublisher() {
+    {
+        boost::mutex::scoped_lock lock(planner_mutex_);
+        planner_shutdown_ = true;
+    }
+    planner_cond_.notify_one();
+    planner_thread_.join();
 }
 
 void DesStatePublisher::initializeServices() {
@@ -77,8 +96,10 @@ bool DesStatePublisher::flushPathQueueCB(std_srvs::TriggerRequest& request, std_
     ROS_WARN("flushing path queue");
     while (!path_queue_.empty())
     {
-        path_queue_.pop();
+        path_queue_.pop_front();
     }
+    path_flushed_ = true;
+    plan_id_++; //drop any replan through the flushed subgoals
     return true;
 }
 
@@ -87,7 +108,7 @@ bool DesStatePublisher::appendPathQueueCB(mobot_pub_des_state::pathRequest& requ
     int npts = request.path.poses.size();
     ROS_INFO("appending path queue with %d points", npts);
     for (int i = 0; i < npts; i++) {
-        path_queue_.push(request.path.poses[i]);
+        path_queue_.push_back(request.path.poses[i]);
     }
     return true;
 }
@@ -96,6 +117,114 @@ void DesStatePublisher::set_init_pose(double x, double y, double psi) {
     current_pose_ = trajBuilder_.xyPsi2PoseStamped(x, y, psi);
 }
 
+//start executing the segments in traj_segments_, from their beginning
+void DesStatePublisher::start_traj() {
+    traj_seg_i_ = 0;
+    traj_seg_t_ = 0.0;
+    plan_id_++; //any replan in progress is for an older plan
+}
+
+//background planner: waits for replan requests and computes them, so that planning never
+// delays a desired-state publication
+void DesStatePublisher::plannerThread() {
+    boost::mutex::scoped_lock lock(planner_mutex_);
+    while (true) {
+        while (!replan_requested_ && !planner_shutdown_) {
+            planner_cond_.wait(lock);
+        }
+        if (planner_shutdown_) {
+            return;
+        }
+        replan_requested_ = false;
+        nav_msgs::Odometry start_state = replan_start_state_;
+        std::vector<geometry_msgs::PoseStamped> subgoals = replan_subgoals_;
+        std::vector<TrajSegment> segments;
+        lock.unlock();
+        trajBuilder_.build_blended_path_segments(start_state, subgoals, segments);
+        lock.lock();
+        replan_segments_.swap(segments);
+        replan_ready_ = true;
+    }
+}
+
+//called on entering a segment that completes a subgoal, e.g. a corner blend: if more subgoals
+// are queued than the current plan covers, ask for a replan from the end of this segment,
+// through the next path_lookahead_ subgoals
+void DesStatePublisher::request_replan() {
+    int n_queued = path_queue_.size();
+    if (n_queued <= n_planned_subgoals_) {
+        return;
+    }
+    boost::mutex::scoped_lock lock(planner_mutex_);
+    traj_segments_[traj_seg_i_].eval(traj_segments_[traj_seg_i_].get_duration(), replan_start_state_);
+    replan_subgoals_.clear();
+    for (int i = 1; i < n_queued && i <= path_lookahead_; i++) {
+        replan_subgoals_.push_back(path_queue_[i]);
+    }
+    replan_plan_id_ = plan_id_;
+    replan_seg_i_ = traj_seg_i_;
+    replan_ready_ = false;
+    replan_requested_ = true;
+    planner_cond_.notify_one();
+}
+
+//done w/ the current segment: account for a subgoal it completed, then move to the next
+// segment, or to the replanned segments, if a replan continues from this point
+void DesStatePublisher::next_traj_segment() {
+    if (traj_segments_[traj_seg_i_].reaches_subgoal) {
+        if (!path_queue_.empty()) {
+            path_queue_.pop_front(); // done w/ this subgoal; remove from the queue
+        }
+        n_planned_subgoals_--;
+        ROS_INFO("reached a subgoal: x = %f, y= %f", current_des_state_.pose.pose.position.x,
+                current_des_state_.pose.pose.position.y);
+    }
+    bool spliced = false;
+    {
+        boost::mutex::scoped_lock lock(planner_mutex_);
+        if (replan_ready_ && replan_plan_id_ == plan_id_ && replan_seg_i_ == traj_seg_i_) {
+            replan_ready_ = false;
+            traj_segments_.swap(replan_segments_);
+            traj_seg_i_ = 0;
+            n_planned_subgoals_ = 0;
+            for (int i = 0; i < traj_segments_.size(); i++) {
+                if (traj_segments_[i].reaches_subgoal) n_planned_subgoals_++;
+            }
+            plan_id_++;
+            ROS_INFO("extended plan through %d more subgoals", n_planned_subgoals_);
+            spliced = true;
+        }
+    }
+    if (!spliced) {
+        traj_seg_i_++;
+    }
+    //entering a segment that completes a subgoal, incl. segment 0 of a replanned path
+    if (traj_segments_[traj_seg_i_].reaches_subgoal && traj_seg_i_ < (int) traj_segments_.size() - 1) {
+        request_replan();
+    }
+}
+
+//step the current trajectory ahead by dt_ and evaluate it there: the trajectory is never
+// sampled ahead of time, so each step costs the same regardless of path length.
+// returns true once the end of the last segment is reached (des_state is then the final state)
+bool DesStatePublisher::advance_traj(nav_msgs::Odometry &des_state) {
+    traj_seg_t_ += dt_;
+    while (traj_seg_i_ < (int) traj_segments_.size() - 1 && traj_seg_t_ >= traj_segments_[traj_seg_i_].get_duration()) {
+        traj_seg_t_ -= traj_segments_[traj_seg_i_].get_duration();
+        next_traj_segment();
+    }
+    const TrajSegment &segment = traj_segments_[traj_seg_i_];
+    segment.eval(traj_seg_t_, des_state);
+    if (traj_seg_i_ == (int) traj_segments_.size() - 1 && traj_seg_t_ >= segment.get_duration()) {
+        if (segment.reaches_subgoal && !path_queue_.empty()) {
+            path_queue_.pop_front(); // done w/ this subgoal; remove from the queue
+        }
+        n_planned_subgoals_ = 0;
+        return true;
+    }
+    return false;
+}
+
 //here is a state machine to advance desired-state publications
 // this will cause a single desired state to be published
 // The state machine advances through modes, including
@@ -114,14 +243,16 @@ void DesStatePublisher::set_init_pose(double x, double y, double psi) {
 // or points can be appended to path queue w/ service append_path_
 
 void DesStatePublisher::pub_next_state() {
+    bool halted = false;
+    bool done_w_subgoal = false;
     // first test if an e-stop has been triggered
     if (e_stop_trigger_) {
         e_stop_trigger_ = false; //reset trigger
-        //compute a halt trajectory
-        trajBuilder_.build_braking_traj(current_pose_, des_state_vec_);
+        //compute a halt trajectory, from the current desired state (which may be moving)
+        trajBuilder_.build_braking_segments(current_des_state_, traj_segments_);
+        n_planned_subgoals_ = 0;
         motion_mode_ = HALTING;
-        traj_pt_i_ = 0;
-        npts_traj_ = des_state_vec_.size();
+        start_traj();
     }
     //or if an e-stop has been cleared
     if (e_stop_reset_) {
@@ -143,8 +274,8 @@ void DesStatePublisher::pub_next_state() {
 
         case HALTING: //e-stop service callback sets this mode
             //if need to brake from e-stop, service will have computed
-            // new des_state_vec_, set indices and set motion mode;
-            current_des_state_ = des_state_vec_[traj_pt_i_];
+            // new traj_segments_, reset the segment time and set motion mode;
+            halted = advance_traj(current_des_state_);
             current_des_state_.header.stamp = ros::Time::now();
             desired_state_publisher_.publish(current_des_state_);
             current_pose_.pose = current_des_state_.pose.pose;
@@ -153,10 +284,9 @@ void DesStatePublisher::pub_next_state() {
             float_msg_.data = des_psi_;
             des_psi_publisher_.publish(float_msg_); 
             
-            traj_pt_i_++;
             //segue from braking to halted e-stop state;
-            if (traj_pt_i_ >= npts_traj_) { //here if completed all pts of braking traj
-                halt_state_ = des_state_vec_.back(); //last point of halting traj
+            if (halted) { //here if completed braking traj
+                halt_state_ = current_des_state_; //last point of halting traj
                 // make sure it has 0 twist
                 halt_state_.twist.twist = halt_twist_;
                 seg_end_state_ = halt_state_;
@@ -166,8 +296,17 @@ void DesStatePublisher::pub_next_state() {
             break;
 
         case PURSUING_SUBGOAL: //if have remaining pts in computed traj, send them
-            //extract the i'th point of our plan:
-            current_des_state_ = des_state_vec_[traj_pt_i_];
+            //if the path queue was flushed while pursuing several subgoals at once, stop now;
+            // a single subgoal is finished, as in point-and-go
+            if (path_flushed_ && n_planned_subgoals_ > 1) {
+                ROS_WARN("path queue flushed; braking");
+                trajBuilder_.build_braking_segments(current_des_state_, traj_segments_);
+                n_planned_subgoals_ = 0;
+                start_traj();
+            }
+            path_flushed_ = false;
+            //evaluate our plan at the next time step:
+            done_w_subgoal = advance_traj(current_des_state_);
             current_pose_.pose = current_des_state_.pose.pose;
             current_des_state_.header.stamp = ros::Time::now();
             desired_state_publisher_.publish(current_des_state_);
@@ -176,14 +315,10 @@ void DesStatePublisher::pub_next_state() {
             des_psi_ = trajBuilder_.convertPlanarQuat2Psi(current_pose_.pose.orientation);
             float_msg_.data = des_psi_;
             des_psi_publisher_.publish(float_msg_); 
-            traj_pt_i_++; // increment counter to prep for next point of plan
             //check if we have clocked out all of our planned states:
-            if (traj_pt_i_ >= npts_traj_) {
+            if (done_w_subgoal) {
                 motion_mode_ = DONE_W_SUBGOAL; //if so, indicate we are done
-                seg_end_state_ = des_state_vec_.back(); // last state of traj
-                if (!path_queue_.empty()) { 
-                    path_queue_.pop(); // done w/ this subgoal; remove from the queue 
-                }
+                seg_end_state_ = current_des_state_; // last state of traj
                 ROS_INFO("reached a subgoal: x = %f, y= %f",current_pose_.pose.position.x,
                         current_pose_.pose.position.y);
             }
@@ -198,9 +333,23 @@ void DesStatePublisher::pub_next_state() {
                 ROS_INFO("%d points in path queue",n_path_pts);
                 start_pose_ = current_pose_;
                 end_pose_ = path_queue_.front();
-                trajBuilder_.build_point_and_go_traj(start_pose_, end_pose_,des_state_vec_);
-                traj_pt_i_ = 0;
-                npts_traj_ = des_state_vec_.size();
+                if (path_lookahead_ > 1 && n_path_pts > 1) {
+                    //plan through the next several subgoals at once, blending the corners
+                    std::vector<geometry_msgs::PoseStamped> subgoals(path_queue_.begin(),
+                            path_queue_.begin() + std::min(n_path_pts, path_lookahead_));
+                    nav_msgs::Odometry start_state;
+                    start_state.pose.pose = start_pose_.pose;
+                    start_state.twist.twist = halt_twist_;
+                    trajBuilder_.build_blended_path_segments(start_state, subgoals, traj_segments_);
+                    n_planned_subgoals_ = subgoals.size();
+                } else {
+                    trajBuilder_.build_point_and_go_segments(start_pose_, end_pose_, traj_segments_);
+                    n_planned_subgoals_ = 1;
+                    traj_segments_.back().reaches_subgoal = true;
+                }
+                current_des_state_.header.frame_id = start_pose_.header.frame_id;
+                path_flushed_ = false;
+                start_traj();
                 motion_mode_ = PURSUING_SUBGOAL; // got a new plan; change mode to pursue it
                 ROS_INFO("computed new trajectory to pursue");
             } else { //no new goal? stay halted in this mode 
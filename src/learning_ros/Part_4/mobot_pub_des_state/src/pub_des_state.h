@@ -1,8 +1,9 @@
 #ifndef PUB_DES_STATE_H_
 #define PUB_DES_STATE_H_
 
-#include <queue>
+#include <deque>
 #include <traj_builder/traj_builder.h> //has almost all the headers we need
+#include <boost/thread.hpp>
 #include <std_msgs/Float64.h>
 #include <std_msgs/Bool.h>
 #include <std_srvs/Trigger.h>
@@ -17,6 +18,7 @@ const double alpha_max = 0.2; // rad/sec^2
 const double speed_max = 1.0; //1 m/sec
 const double omega_max = 1.0; //1 rad/sec
 const double path_move_tol = 0.01; // if path points are within 1cm, fuggidaboutit
+const int path_lookahead = 4; // plan through this many queued subgoals at once, blending corners; 1 = point-and-go
 
 const int E_STOPPED = 0; //define some mode keywords
 const int DONE_W_SUBGOAL = 1;
@@ -30,7 +32,7 @@ private:
 
     //some class member variables:
     nav_msgs::Path path_;
-    std::vector<nav_msgs::Odometry> des_state_vec_;
+    std::vector<TrajSegment> traj_segments_; //current trajectory, as closed-form segments
     nav_msgs::Odometry des_state_;
     nav_msgs::Odometry halt_state_;
     nav_msgs::Odometry seg_end_state_;
@@ -42,12 +44,30 @@ private:
     geometry_msgs::PoseStamped current_pose_;
     std_msgs::Float64 float_msg_;
     double des_psi_;
-    std::queue<geometry_msgs::PoseStamped> path_queue_; //a C++ "queue" object, stores vertices as Pose points in a FIFO queue
+    std::deque<geometry_msgs::PoseStamped> path_queue_; //a C++ "deque" object, stores vertices as Pose points in a FIFO queue
     int motion_mode_;
     bool e_stop_trigger_; //these are intended to enable e-stop via a service
     bool e_stop_reset_;
-    int traj_pt_i_;
-    int npts_traj_;
+    int traj_seg_i_; //segment being executed
+    double traj_seg_t_; //time into that segment
+    int path_lookahead_; //max number of queued subgoals planned at once
+    int n_planned_subgoals_; //queued subgoals covered by the rest of the current plan
+    bool path_flushed_; //set by a flush of path_queue_
+    int plan_id_; //incremented for each new plan, so stale replans can be recognized
+
+    //background replanning: while a corner blend executes, the rest of the path is replanned from
+    // the end of the blend, to extend the plan to subgoals queued beyond it
+    boost::thread planner_thread_;
+    boost::mutex planner_mutex_;
+    boost::condition_variable planner_cond_;
+    bool planner_shutdown_;
+    bool replan_requested_;
+    bool replan_ready_;
+    int replan_plan_id_; //plan that the replan continues
+    int replan_seg_i_; //segment of that plan after which the replan takes over
+    nav_msgs::Odometry replan_start_state_;
+    std::vector<geometry_msgs::PoseStamped> replan_subgoals_;
+    std::vector<TrajSegment> replan_segments_;
     double dt_;
     //dynamic parameters: should be tuned for target system
     double accel_max_; 
@@ -75,17 +95,24 @@ private:
     bool clearEstopServiceCallback(std_srvs::TriggerRequest& request, std_srvs::TriggerResponse& response);
     bool flushPathQueueCB(std_srvs::TriggerRequest& request, std_srvs::TriggerResponse& response);
     bool appendPathQueueCB(mobot_pub_des_state::pathRequest& request,mobot_pub_des_state::pathResponse& response);
+    void start_traj();
+    bool advance_traj(nav_msgs::Odometry &des_state);
+    void next_traj_segment();
+    void request_replan();
+    void plannerThread();
 
 public:
     DesStatePublisher(ros::NodeHandle& nh);//constructor
+    ~DesStatePublisher();
+    void set_path_lookahead(int n) { path_lookahead_ = (n < 1) ? 1 : n; }
     int get_motion_mode() {return motion_mode_;}
     void set_motion_mode(int mode) {motion_mode_ = mode;}
     bool get_estop_trigger() { return e_stop_trigger_;}
     void reset_estop_trigger() { e_stop_trigger_ = false;}
     void set_init_pose(double x,double y, double psi);
     void pub_next_state();
-    void append_path_queue(geometry_msgs::PoseStamped pose) { path_queue_.push(pose); }
+    void append_path_queue(geometry_msgs::PoseStamped pose) { path_queue_.push_back(pose); }
     void append_path_queue(double x, double y, double psi) 
-        { path_queue_.push(trajBuilder_.xyPsi2PoseStamped(x,y,psi)); }
+        { path_queue_.push_back(trajBuilder_.xyPsi2PoseStamped(x,y,psi)); }
 };
 #endif
\ No newline at end of file
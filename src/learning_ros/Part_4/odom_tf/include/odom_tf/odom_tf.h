@@ -26,6 +26,7 @@
 #include <tf/LinearMath/QuadWord.h>
 #include <tf/transform_broadcaster.h>
 #include <xform_utils/xform_utils.h>
+#include <odom_tf/pose_history.h>
  
 //const double ODOM_TF_UPDATE_RATE=50.0; // for a 50Hz update rate
 // define a class, including a constructor, member variables and member functions
@@ -70,6 +71,15 @@ private:
     void amclCallback(const geometry_msgs::PoseWithCovarianceStamped& amcl_rcvd);
     ros::Publisher pose_publisher_; // = nh.advertise<geometry_msgs::PoseStamped>("triad_display_pose", 1, true);
     geometry_msgs::PoseStamped estBasePoseWrtMap_;
+    void set_planar_stamped_tf(const Pose2D &pose, tf::StampedTransform &stf);
+
+    //planar poses, for the per-odom-message computations
+    Pose2D base_wrt_drifty_odom_;
+    Pose2D drifty_odom_wrt_map_;
+    Pose2D est_base_wrt_map_;
+    //recent base_link poses w/rt drifty_odom, by odom stamp; AMCL poses are paired with the
+    // odom pose at the same time, not with the latest one
+    PoseHistory base_wrt_drifty_odom_history_;
 
     //state values from odometry; these will get filled in by odom callback      
     nav_msgs::Odometry current_odom_; // fill in these objects from callbacks
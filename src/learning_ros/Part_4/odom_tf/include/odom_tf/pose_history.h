@@ -0,0 +1,69 @@
+// pose_history.h header file //
+// planar (SE(2)) poses, and a fixed-capacity history of time-stamped planar poses, for looking up
+// where the robot was at the time of a (late) measurement, e.g. an AMCL pose
+// see pose_history.cpp
+
+#ifndef POSE_HISTORY_H_
+#define POSE_HISTORY_H_
+
+#include <math.h>
+#include <atomic>
+
+//pose of a frame in the plane, w/rt some parent frame: origin (x,y) and heading psi
+struct Pose2D {
+    double x;
+    double y;
+    double psi;
+};
+
+//cascade planar poses: for frames a, b, c, given b w/rt a and c w/rt b, return c w/rt a
+inline Pose2D pose2d_multiply(const Pose2D &b_wrt_a, const Pose2D &c_wrt_b) {
+    double c = cos(b_wrt_a.psi);
+    double s = sin(b_wrt_a.psi);
+    Pose2D c_wrt_a;
+    c_wrt_a.x = b_wrt_a.x + c * c_wrt_b.x - s * c_wrt_b.y;
+    c_wrt_a.y = b_wrt_a.y + s * c_wrt_b.x + c * c_wrt_b.y;
+    c_wrt_a.psi = atan2(sin(b_wrt_a.psi + c_wrt_b.psi), cos(b_wrt_a.psi + c_wrt_b.psi));
+    return c_wrt_a;
+}
+
+//given b w/rt a, return a w/rt b
+inline Pose2D pose2d_inverse(const Pose2D &b_wrt_a) {
+    double c = cos(b_wrt_a.psi);
+    double s = sin(b_wrt_a.psi);
+    Pose2D a_wrt_b;
+    a_wrt_b.x = -c * b_wrt_a.x - s * b_wrt_a.y;
+    a_wrt_b.y = s * b_wrt_a.x - c * b_wrt_a.y;
+    a_wrt_b.psi = -b_wrt_a.psi;
+    return a_wrt_b;
+}
+
+const int POSE_HISTORY_SIZE = 256; // must be a power of 2; at 50Hz, about 5 sec of poses
+
+//ring of the most recent POSE_HISTORY_SIZE time-stamped poses.  insert() is O(1) and lookup()
+// is O(log n).  There must be only one writer (calling insert()); readers need no lock: they
+// re-check the write index after reading, and retry if the writer overwrote what they read
+class PoseHistory {
+public:
+    PoseHistory();
+    //append a pose at time t (sec); t must be later than that of the previous pose, else the
+    // pose is ignored and false is returned; but if time jumped back by more than a second (e.g.
+    // a simulation restarted), the history is restarted from this pose
+    bool insert(double t, const Pose2D &pose);
+    //pose at time t, interpolated between the stored poses around t; if t is outside the
+    // stored interval, returns false, with pose set to the oldest or newest stored pose
+    // (no pose at all if the history is empty)
+    bool lookup(double t, Pose2D &pose) const;
+    int size() const;
+
+private:
+    struct Entry {
+        double t;
+        Pose2D pose;
+    };
+    Entry entries_[POSE_HISTORY_SIZE];
+    std::atomic<unsigned> head_; // number of poses ever inserted; newest is at head_-1
+    std::atomic<unsigned> start_; // poses before this index are not used, after a restart
+};
+
+#endif
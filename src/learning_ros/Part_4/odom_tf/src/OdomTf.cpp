@@ -70,6 +70,9 @@ OdomTf::OdomTf(ros::NodeHandle* nodehandle) : nh_(*nodehandle) { // constructor
     stfDriftyOdomWrtMap_ = stfAmclBaseLinkWrtMap_;
     stfDriftyOdomWrtMap_.frame_id_ = "map"; // declare the respective frames
     stfDriftyOdomWrtMap_.child_frame_id_ = "drifty_odom"; 
+    drifty_odom_wrt_map_.x = 0.0;
+    drifty_odom_wrt_map_.y = 0.0;
+    drifty_odom_wrt_map_.psi = 0.0;
 
     odom_subscriber_ = nh_.subscribe("/drifty_odom", 1, &OdomTf::odomCallback, this); //subscribe to odom messages
 
@@ -106,7 +109,15 @@ void OdomTf::initializeSubscribers() {
     // add more subscribers here, as needed
 }
 
+//fill in a stamped transform from a planar pose; stamp and frame names are left to the caller
+void OdomTf::set_planar_stamped_tf(const Pose2D &pose, tf::StampedTransform &stf) {
+    stf.setOrigin(tf::Vector3(pose.x, pose.y, 0.0));
+    stf.setRotation(tf::Quaternion(0.0, 0.0, sin(0.5 * pose.psi), cos(0.5 * pose.psi)));
+}
+
 //callback fnc based on drifty_odom
+//all of the frame arithmetic here is planar (x, y, psi); tf transforms are only filled in for
+// publication
 void OdomTf::odomCallback(const nav_msgs::Odometry& odom_rcvd) {
     odom_count_++;
     // copy some of the components of the received message into member vars
@@ -122,24 +133,21 @@ void OdomTf::odomCallback(const nav_msgs::Odometry& odom_rcvd) {
     odom_quat_ = odom_rcvd.pose.pose.orientation;
     //odom publishes orientation as a quaternion.  Convert this to a simple heading
     odom_phi_ = xform_utils.convertPlanarQuat2Phi(odom_quat_); // cheap conversion from quaternion to heading for planar motion
-    //get the position from odom, converted to a tf type
-    tf::Vector3 pos;
-    pos.setX(odom_pose_.position.x);
-    pos.setY(odom_pose_.position.y);
-    pos.setZ(odom_pose_.position.z);
-    stfBaseLinkWrtDriftyOdom_.stamp_ = ros::Time::now();
-    stfBaseLinkWrtDriftyOdom_.setOrigin(pos);
-    // also need to get the orientation of odom_pose and use setRotation
-    tf::Quaternion q;
-    q.setX(odom_quat_.x);
-    q.setY(odom_quat_.y);
-    q.setZ(odom_quat_.z);
-    q.setW(odom_quat_.w);
-    stfBaseLinkWrtDriftyOdom_.setRotation(q);
+    base_wrt_drifty_odom_.x = odom_x_;
+    base_wrt_drifty_odom_.y = odom_y_;
+    base_wrt_drifty_odom_.psi = odom_phi_;
+    //remember where odom said the robot was, and when, for pairing with amcl poses
+    ros::Time stamp = odom_rcvd.header.stamp;
+    if (stamp.isZero()) {
+        stamp = ros::Time::now();
+    }
+    base_wrt_drifty_odom_history_.insert(stamp.toSec(), base_wrt_drifty_odom_);
+
+    ros::Time now = ros::Time::now();
+    set_planar_stamped_tf(base_wrt_drifty_odom_, stfBaseLinkWrtDriftyOdom_);
+    stfBaseLinkWrtDriftyOdom_.stamp_ = now;
     stfBaseLinkWrtDriftyOdom_.frame_id_ = "drifty_odom";
     stfBaseLinkWrtDriftyOdom_.child_frame_id_ = "base_link";
-    //cout<<endl<<"odom_count: "<<odom_count_<<endl;
-    //stfDriftyOdomWrtBase_.child_frame_id_ = "drifty_odom"; // make this legal for multiply
     
     // the odom message tells us the estimated pose of the robot's base_frame with respect to the "odom" frame
     // the odom frame is just (0,0,0) when and wherever the robot wakes up;
@@ -152,8 +160,11 @@ void OdomTf::odomCallback(const nav_msgs::Odometry& odom_rcvd) {
     // published by our simulation  (this will not be a problem with a real robot)
     //here's a trick: publish the drifty_odom frame as a child of the robot's base_frame to avoid a kinematic loop
     //rviz will then be able to transform the drifty_odom frame appropriately in whatever fixed frame is chosen for display
-    // use stamped_transform_inverse() function to invert base w/rt odom into odom w/rt base
-    stfDriftyOdomWrtBase_ = xform_utils.stamped_transform_inverse(stfBaseLinkWrtDriftyOdom_); 
+    // invert base w/rt odom into odom w/rt base
+    set_planar_stamped_tf(pose2d_inverse(base_wrt_drifty_odom_), stfDriftyOdomWrtBase_);
+    stfDriftyOdomWrtBase_.stamp_ = now;
+    stfDriftyOdomWrtBase_.frame_id_ = "base_link";
+    stfDriftyOdomWrtBase_.child_frame_id_ = "drifty_odom";
     //use the TRANSFORM PUBLISHER to send out this transform on the tf topic
     br_.sendTransform(stfDriftyOdomWrtBase_);
     
@@ -161,26 +172,26 @@ void OdomTf::odomCallback(const nav_msgs::Odometry& odom_rcvd) {
     // this is updated by callbacks from AMCL publications of robot w/rt map
     // this transform will update infrequently (e.g. 1Hz), but it also should only change slowly (at the rate of odom drift)
 
-    //cout<<endl<<"stfDriftyOdomWrtMap_"<<endl;
-    //xform_utils.printStampedTf(stfDriftyOdomWrtMap_);     
-    // cout<<endl<<"stfBaseLinkWrtDriftyOdom_"<<endl;
-    //xform_utils.printStampedTf(stfBaseLinkWrtDriftyOdom_);       
-    
     //cascde the frames: for frames b==base_link, m==map, do==drifty_odom,
     // 
     // T_b/m = m^T_b = m^T_do * do^T_b = T_do/m * T_b/do
-    // put the answer in stfEstBaseWrtMap_
-    xform_utils.multiply_stamped_tfs(stfDriftyOdomWrtMap_,stfBaseLinkWrtDriftyOdom_,stfEstBaseWrtMap_);
+    est_base_wrt_map_ = pose2d_multiply(drifty_odom_wrt_map_, base_wrt_drifty_odom_);
     //publish this frame, for visualization; change "base_link" to "est_base" to avoid name conflict
     // and kinematic loop;  Visualized result of est_base is an estimate of the robot's pose in
     // the map frame, using amcl and using the imperfect (drifty) odom estimate
     // ideally, this frame is virtually perfect, matching the base_link frame known to rviz
+    set_planar_stamped_tf(est_base_wrt_map_, stfEstBaseWrtMap_);
+    stfEstBaseWrtMap_.stamp_ = now;
+    stfEstBaseWrtMap_.frame_id_ = "map";
     stfEstBaseWrtMap_.child_frame_id_ = "est_base";
-    //cout<<endl<<"stfEstBaseWrtMap_"<<endl;
-    // xform_utils.printStampedTf(stfEstBaseWrtMap_);   
     //publish this transform, making it available to rviz, known as "est_base"
     br_.sendTransform(stfEstBaseWrtMap_);
-    estBasePoseWrtMap_ = xform_utils.get_pose_from_stamped_tf(stfEstBaseWrtMap_);
+    estBasePoseWrtMap_.header.stamp = now;
+    estBasePoseWrtMap_.header.frame_id = "map";
+    estBasePoseWrtMap_.pose.position.x = est_base_wrt_map_.x;
+    estBasePoseWrtMap_.pose.position.y = est_base_wrt_map_.y;
+    estBasePoseWrtMap_.pose.position.z = 0.0;
+    estBasePoseWrtMap_.pose.orientation = xform_utils.convertPlanarPsi2Quaternion(est_base_wrt_map_.psi);
     pose_publisher_.publish(estBasePoseWrtMap_); // send this to triad marker display node
       
 }
@@ -189,41 +200,37 @@ void OdomTf::odomCallback(const nav_msgs::Odometry& odom_rcvd) {
 //amcl will publish best-estimate poses of the base-link with respect to the map frame
 // these are imprecise, and they are updated slowly (e.g. 1Hz)
 // when we get an update, we'll know base-frame w/rt map;
-//  at each such update, get the most current base-frame w/rt drifty odom
+//  at each such update, get base-frame w/rt drifty odom AT THE TIME OF THE AMCL POSE (amcl poses
+//  arrive late; pairing with the latest odom would attribute the robot's motion since then to drift)
 //  figure out from this where is the drifty odom frame w/rt the map
 // we can assume that the drifty-odom frame moves only slowly with respect to the map, so infrequent updates should be OK
 // We can re-use the transform: drifty_odom w/rt map repeatedly (e.g. at 50Hz, coincident with drifty-odom publication updates)
 //  continue to use the same drifty_odom w/rt map transform until we get a new one  (which should be pretty close to the previous one)
 void OdomTf::amclCallback(const geometry_msgs::PoseWithCovarianceStamped& amcl_rcvd) {
     amcl_pose_ = amcl_rcvd.pose.pose;
-    ROS_WARN("amcl pose: x, y, yaw: %f, %f, %f", amcl_pose_.position.x, amcl_pose_.position.y, xform_utils.convertPlanarQuat2Phi(amcl_pose_.orientation));
-    //stfAmclBaseLinkWrtMap_
     amcl_quat_ = amcl_pose_.orientation;
-    tf::Vector3 pos;
-    pos.setX(amcl_pose_.position.x);
-    pos.setY(amcl_pose_.position.y);
-    pos.setZ(amcl_pose_.position.z);
+    Pose2D amcl_base_wrt_map;
+    amcl_base_wrt_map.x = amcl_pose_.position.x;
+    amcl_base_wrt_map.y = amcl_pose_.position.y;
+    amcl_base_wrt_map.psi = xform_utils.convertPlanarQuat2Phi(amcl_quat_);
+    ROS_WARN("amcl pose: x, y, yaw: %f, %f, %f", amcl_base_wrt_map.x, amcl_base_wrt_map.y, amcl_base_wrt_map.psi);
+    set_planar_stamped_tf(amcl_base_wrt_map, stfAmclBaseLinkWrtMap_);
     stfAmclBaseLinkWrtMap_.stamp_ = ros::Time::now();
-    stfAmclBaseLinkWrtMap_.setOrigin(pos);
-    // also need to get the orientation of odom_pose and use setRotation
-    tf::Quaternion q;
-    q.setX(amcl_quat_.x);
-    q.setY(amcl_quat_.y);
-    q.setZ(amcl_quat_.z);
-    q.setW(amcl_quat_.w);
-    stfAmclBaseLinkWrtMap_.setRotation(q);
     stfAmclBaseLinkWrtMap_.frame_id_ = "map";
     stfAmclBaseLinkWrtMap_.child_frame_id_ = "base_link";
-    //cout<<endl<<"stfAmclBaseLinkWrtMap_"<<endl;
-    //xform_utils.printStampedTf(stfAmclBaseLinkWrtMap_);      
-    
-    stfDriftyOdomWrtBase_ = xform_utils.stamped_transform_inverse(stfBaseLinkWrtDriftyOdom_); 
-    //cout<<endl<<"stfDriftyOdomWrtBase_"<<endl;
-    //xform_utils.printStampedTf(stfDriftyOdomWrtBase_);    
-    
-    if (!xform_utils.multiply_stamped_tfs(stfAmclBaseLinkWrtMap_,stfDriftyOdomWrtBase_,stfDriftyOdomWrtMap_)) {
-        ROS_WARN("stfAmclBaseLinkWrtMap_,stfDriftyOdomWrtBase_ multiply invalid" );
+
+    //where odom had the robot when amcl saw it there
+    ros::Time stamp = amcl_rcvd.header.stamp;
+    Pose2D base_wrt_drifty_odom = base_wrt_drifty_odom_;
+    if (!stamp.isZero() && !base_wrt_drifty_odom_history_.lookup(stamp.toSec(), base_wrt_drifty_odom)) {
+        ROS_WARN("amcl pose stamp is outside of the odom history; using the nearest odom pose");
     }
+
+    // T_do/m = T_b/m * (T_b/do)^-1
+    drifty_odom_wrt_map_ = pose2d_multiply(amcl_base_wrt_map, pose2d_inverse(base_wrt_drifty_odom));
+    set_planar_stamped_tf(drifty_odom_wrt_map_, stfDriftyOdomWrtMap_);
+    stfDriftyOdomWrtMap_.stamp_ = stfAmclBaseLinkWrtMap_.stamp_;
+    stfDriftyOdomWrtMap_.frame_id_ = "map";
     
    //publish the estimated odom frame w/rt the map.  This is useful for visualization, e.g. to see
     //how rapidly the odometry estimate is drifting
@@ -0,0 +1,78 @@
+//pose_history.cpp:
+//implementation of PoseHistory: fixed-capacity ring of time-stamped planar poses
+
+#include <odom_tf/pose_history.h>
+
+PoseHistory::PoseHistory() : head_(0), start_(0) {
+}
+
+bool PoseHistory::insert(double t, const Pose2D &pose) {
+    unsigned head = head_.load(std::memory_order_relaxed);
+    if (head != start_.load(std::memory_order_relaxed)) {
+        double t_newest = entries_[(head - 1) & (POSE_HISTORY_SIZE - 1)].t;
+        if (t < t_newest - 1.0) {
+            start_.store(head, std::memory_order_release); // time went back; start over
+        } else if (t <= t_newest) {
+            return false;
+        }
+    }
+    Entry &entry = entries_[head & (POSE_HISTORY_SIZE - 1)];
+    entry.t = t;
+    entry.pose = pose;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+int PoseHistory::size() const {
+    unsigned head = head_.load(std::memory_order_acquire);
+    unsigned n = head - start_.load(std::memory_order_acquire);
+    //the slot at head may be being overwritten, so only POSE_HISTORY_SIZE-1 entries are readable
+    return (n < POSE_HISTORY_SIZE) ? n : POSE_HISTORY_SIZE - 1;
+}
+
+bool PoseHistory::lookup(double t, Pose2D &pose) const {
+    while (true) {
+        unsigned head = head_.load(std::memory_order_acquire);
+        unsigned n = head - start_.load(std::memory_order_acquire);
+        if (n >= POSE_HISTORY_SIZE) {
+            n = POSE_HISTORY_SIZE - 1; // see size()
+        }
+        if (n == 0) {
+            return false;
+        }
+        unsigned oldest = head - n;
+        const Entry &first = entries_[oldest & (POSE_HISTORY_SIZE - 1)];
+        const Entry &last = entries_[(head - 1) & (POSE_HISTORY_SIZE - 1)];
+        bool in_range = true;
+        if (t <= first.t) {
+            pose = first.pose;
+            in_range = (t == first.t);
+        } else if (t >= last.t) {
+            pose = last.pose;
+            in_range = (t == last.t);
+        } else {
+            //binary search for the last entry at or before t
+            unsigned lo = oldest;
+            unsigned hi = head - 1; // entries_[lo].t <= t < entries_[hi].t
+            while (hi - lo > 1) {
+                unsigned mid = lo + (hi - lo) / 2;
+                if (entries_[mid & (POSE_HISTORY_SIZE - 1)].t <= t) {
+                    lo = mid;
+                } else {
+                    hi = mid;
+                }
+            }
+            const Entry &a = entries_[lo & (POSE_HISTORY_SIZE - 1)];
+            const Entry &b = entries_[hi & (POSE_HISTORY_SIZE - 1)];
+            double f = (t - a.t) / (b.t - a.t);
+            double dpsi = atan2(sin(b.pose.psi - a.pose.psi), cos(b.pose.psi - a.pose.psi));
+            pose.x = a.pose.x + f * (b.pose.x - a.pose.x);
+            pose.y = a.pose.y + f * (b.pose.y - a.pose.y);
+            pose.psi = atan2(sin(a.pose.psi + f * dpsi), cos(a.pose.psi + f * dpsi));
+        }
+        //if the writer has since wrapped around onto the oldest entry we read, read again
+        if (head_.load(std::memory_order_acquire) - oldest < POSE_HISTORY_SIZE) {
+            return in_range;
+        }
+    }
+}
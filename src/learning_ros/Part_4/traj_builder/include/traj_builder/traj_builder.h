@@ -7,6 +7,7 @@
 #include <geometry_msgs/Pose.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/PoseWithCovariance.h>
+#include <traj_builder/traj_segment.h>
 
 //some generically useful stuff to include...
 #include <math.h>
@@ -21,6 +22,8 @@ const double default_speed_max = 1.0; //1 m/sec
 const double default_omega_max = 1.0; //1 rad/sec
 const double default_path_move_tol = 0.01; // if path points are within 1cm, fuggidaboutit   
 const double default_dt=0.02;
+const double default_max_blend_angle = 2.0 * M_PI / 3.0; // path corners sharper than this: stop and spin in place
+const double default_min_blend_speed = 0.05; // if a corner can only be blended slower than this (m/sec), stop there
 
 class TrajBuilder {
 private:
@@ -31,6 +34,8 @@ private:
     double speed_max_;
     double omega_max_;
     double path_move_tol_;
+    double max_blend_angle_;
+    double min_blend_speed_;
 
     //member vars of class
     geometry_msgs::Twist halt_twist_;
@@ -63,6 +68,14 @@ public:
         path_move_tol_ = tol;
     }
 
+    void set_max_blend_angle(double angle) {
+        max_blend_angle_ = angle;
+    }
+
+    void set_min_blend_speed(double speed) {
+        min_blend_speed_ = speed;
+    }
+
     //useful utilties:
     double min_dang(double dang);
     double sat(double x);
@@ -73,7 +86,29 @@ public:
     //utility to fill a PoseStamped object from planar x,y,phi info
     geometry_msgs::PoseStamped xyPsi2PoseStamped(double x, double y, double psi);
 
-    //here are the main traj-builder fncs:
+    //closed-form trajectories, as segments that can be evaluated at any time (see traj_segment.h);
+    // building these costs the same for any path length or dt
+    void build_spin_segment(geometry_msgs::PoseStamped start_pose,
+            geometry_msgs::PoseStamped end_pose,
+            std::vector<TrajSegment> &segments); //appends
+    void build_travel_segment(geometry_msgs::PoseStamped start_pose,
+            geometry_msgs::PoseStamped end_pose,
+            std::vector<TrajSegment> &segments); //appends
+    void build_point_and_go_segments(geometry_msgs::PoseStamped start_pose,
+            geometry_msgs::PoseStamped end_pose,
+            std::vector<TrajSegment> &segments); //clears segments first
+    void build_braking_segments(nav_msgs::Odometry current_state,
+            std::vector<TrajSegment> &segments); //clears segments first
+    //look-ahead path through several subgoals, without stopping at corners; clears segments first
+    void build_blended_path_segments(nav_msgs::Odometry start_state,
+            const std::vector<geometry_msgs::PoseStamped> &subgoals,
+            std::vector<TrajSegment> &segments);
+    //sample segments every dt_ into vec_of_states (appends)
+    void sample_segments(const std::vector<TrajSegment> &segments,
+            std_msgs::Header header,
+            std::vector<nav_msgs::Odometry> &vec_of_states);
+
+    //here are the main traj-builder fncs; these sample the above segments into vectors of states:
     void build_trapezoidal_spin_traj(geometry_msgs::PoseStamped start_pose,
             geometry_msgs::PoseStamped end_pose,
             std::vector<nav_msgs::Odometry> &vec_of_states);
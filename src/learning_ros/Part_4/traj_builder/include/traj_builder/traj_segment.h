@@ -0,0 +1,61 @@
+// traj_segment.h
+// closed-form trajectory segments for TrajBuilder: a spin-in-place or a straight-line travel,
+// with a trapezoidal (or triangular) velocity profile, or a blend that turns a path corner at
+// speed.  A segment is described by a handful of numbers, and the desired state at any time t
+// is computed directly from them, in O(1), so a trajectory need not be sampled into a vector
+// of states before it is used.
+#ifndef TRAJ_SEGMENT_H_
+#define TRAJ_SEGMENT_H_
+
+#include <nav_msgs/Odometry.h>
+#include <math.h>
+
+//speed profile along a single axis (distance traveled, or angle spun), from 0 to dist:
+// accelerate from v_start to v_peak, cruise at v_peak, then decelerate to v_end, all at
+// constant accel; if there is no room to cruise, the profile is triangular (v_peak < v_max).
+// Speeds and dist are magnitudes (>= 0); if dist < |v_start^2-v_end^2|/(2*accel), accel is raised
+// for this profile so that it still ends at dist, at v_end
+class VelocityProfile {
+public:
+    VelocityProfile();
+    void init(double dist, double v_start, double v_end, double v_max, double accel);
+    double get_duration() const { return t_accel_ + t_cruise_ + t_decel_; }
+    double get_dist() const { return dist_; }
+    double get_v_peak() const { return v_peak_; }
+    //distance s and speed v at time t; t is clamped to [0, duration]
+    void eval(double t, double &s, double &v) const;
+private:
+    double dist_, v_start_, v_peak_, v_end_, accel_;
+    double t_accel_, t_cruise_, t_decel_;
+    double d_accel_, d_cruise_; //distance covered by end of accel and cruise phases
+};
+
+//one segment of a mobile-robot trajectory: SPIN rotates in place from psi_start by dpsi;
+// TRAVEL moves straight along heading psi_start for a (signed) distance;
+// BLEND turns a corner at constant forward speed, while the spin rate ramps up and back down to 0
+// (the profile is then the angle turned), so speed and spin rate are continuous with the
+// TRAVEL segments on either side; for braking while turning, the forward speed may instead
+// change at a constant rate (speed_rate).  BLEND position has no closed form; it is integrated
+// numerically over a fixed number of steps, so evaluation is still O(1)
+class TrajSegment {
+public:
+    enum SegmentType { SPIN, TRAVEL, BLEND };
+
+    SegmentType type;
+    double x_start, y_start, psi_start; //pose at start of segment
+    double x_end, y_end, psi_end; //pose at end of segment; reported exactly at t >= duration
+    double direction; //+1 or -1: CCW/CW spin, forward/reverse travel
+    double speed; //BLEND only: forward speed at start of segment
+    double speed_rate; //BLEND only: rate of change of forward speed; 0 for a corner blend
+    bool reaches_subgoal; //set by planners if this segment completes a subgoal of the path
+    VelocityProfile profile;
+
+    TrajSegment();
+    double get_duration() const { return profile.get_duration(); }
+    //fill pose and twist of des_state at time t from start of segment (header is not touched)
+    void eval(double t, nav_msgs::Odometry &des_state) const;
+    //BLEND only: displacement from the start of the segment at time t
+    void get_blend_displacement(double t, double &dx, double &dy) const;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include<traj_builder/traj_builder.h>
+#include <algorithm>
 
 //This library contains functions to build simple navigation trajectories.
 //The main function is: build_point_and_go_traj().  This function takes
@@ -9,7 +10,10 @@
 //  *find heading from start to goal coordinates
 //  *compute a spin-in-place trajectory to point the robot towards the goal pose
 //  *compute a forward-motion trajectory to move straight towards the goal pose
-//The trajectories are stored in a vector of Odometry objects, sampled every time
+//Each motion is represented in closed form, as TrajSegment objects (see traj_segment.h),
+// which can be evaluated at any time t; build_point_and_go_segments() returns these,
+// and a user (e.g. a desired-state publisher) can evaluate them as it goes.
+//build_point_and_go_traj() instead samples them into a vector of Odometry objects, every time
 // step dt_ (defaults to 20ms, but settable via fnc set_dt(double dt) ).
 //The Odom objects contain incremental states of x, y, orientation, translational
 //  velocity and rotational velocity
@@ -41,6 +45,8 @@ TrajBuilder::TrajBuilder()  {
     speed_max_ = default_speed_max; //1.0; //1 m/sec
     omega_max_ = default_omega_max; //1.0; //1 rad/sec
     path_move_tol_ = default_path_move_tol; //0.01; // if path points are within 1cm, fuggidaboutit   
+    max_blend_angle_ = default_max_blend_angle;
+    min_blend_speed_ = default_min_blend_speed;
 
     //define a halt state; zero speed and spin, and fill with viable coords
     halt_twist_.linear.x = 0.0;
@@ -110,303 +116,398 @@ geometry_msgs::PoseStamped TrajBuilder::xyPsi2PoseStamped(double x, double y, do
 }
 
 //here are the main traj-builder fncs:
-//for spin-in-place motion that would hit maximum angular velocity, construct 
-// trapezoidal angular velocity profile
-void TrajBuilder::build_trapezoidal_spin_traj(geometry_msgs::PoseStamped start_pose,
+//each motion is first built as closed-form segments (see traj_segment.h); the vector-of-states
+// versions below then just sample those segments every dt_
+
+//spin-in-place segment from start_pose heading to end_pose heading, appended to segments;
+// the profile is triangular or trapezoidal, depending on omega_max_ and alpha_max_
+void TrajBuilder::build_spin_segment(geometry_msgs::PoseStamped start_pose,
         geometry_msgs::PoseStamped end_pose,
-        std::vector<nav_msgs::Odometry> &vec_of_states) {
-    double x_start = start_pose.pose.position.x;
-    double y_start = start_pose.pose.position.y;
-    double x_end = end_pose.pose.position.x;
-    double y_end = end_pose.pose.position.y;
-    double dx = x_end - x_start;
-    double dy = y_end - y_start;
+        std::vector<TrajSegment> &segments) {
+    TrajSegment segment;
     double psi_start = convertPlanarQuat2Psi(start_pose.pose.orientation);
     double psi_end = convertPlanarQuat2Psi(end_pose.pose.orientation);
     double dpsi = min_dang(psi_end - psi_start);
-    double t_ramp = omega_max_/ alpha_max_;    
-    double ramp_up_dist = 0.5 * alpha_max_ * t_ramp*t_ramp;
-    double cruise_distance = fabs(dpsi) - 2.0 * ramp_up_dist; //delta-angle to spin at omega_max        
-    int npts_ramp = round(t_ramp / dt_);
-    nav_msgs::Odometry des_state;
-    des_state.header = start_pose.header; //really, want to copy the frame_id
-    des_state.pose.pose = start_pose.pose; //start from here
-    des_state.twist.twist = halt_twist_; // insist on starting from rest
-    
-    //ramp up omega (positive or negative);
-    double t = 0.0;
-    double accel = sgn(dpsi) * alpha_max_;
-    double omega_des = 0.0;
-    double psi_des = psi_start;
-    for (int i = 0; i < npts_ramp; i++) {
-        t += dt_;
-        omega_des = accel*t;
-        des_state.twist.twist.angular.z = omega_des; //update rotation rate
-        //update orientation
-        psi_des = psi_start + 0.5 * accel * t*t;
-        des_state.pose.pose.orientation = convertPlanarPsi2Quaternion(psi_des);
-        vec_of_states.push_back(des_state);
+    ROS_INFO("rotational spin distance = %f", dpsi);
+    segment.type = TrajSegment::SPIN;
+    segment.x_start = start_pose.pose.position.x;
+    segment.y_start = start_pose.pose.position.y;
+    segment.psi_start = psi_start;
+    segment.x_end = end_pose.pose.position.x;
+    segment.y_end = end_pose.pose.position.y;
+    segment.psi_end = psi_end;
+    segment.direction = (dpsi < 0.0) ? -1.0 : 1.0; //watch out for sign: CW vs CCW rotation
+    segment.profile.init(fabs(dpsi), 0.0, 0.0, omega_max_, alpha_max_); //from rest, to rest
+    segments.push_back(segment);
+}
+
+//straight-line travel segment from start_pose coords to end_pose coords, appended to segments;
+// heading is the direction of travel.  Triangular or trapezoidal profile, per speed_max_ and accel_max_
+void TrajBuilder::build_travel_segment(geometry_msgs::PoseStamped start_pose,
+        geometry_msgs::PoseStamped end_pose,
+        std::vector<TrajSegment> &segments) {
+    TrajSegment segment;
+    double dx = end_pose.pose.position.x - start_pose.pose.position.x;
+    double dy = end_pose.pose.position.y - start_pose.pose.position.y;
+    double trip_len = sqrt(dx * dx + dy * dy);
+    double psi_des = atan2(dy, dx);
+    ROS_INFO("trip len = %f", trip_len);
+    segment.type = TrajSegment::TRAVEL;
+    segment.x_start = start_pose.pose.position.x;
+    segment.y_start = start_pose.pose.position.y;
+    segment.psi_start = psi_des;
+    segment.x_end = end_pose.pose.position.x;
+    segment.y_end = end_pose.pose.position.y;
+    segment.psi_end = psi_des; //final orientation follows from point-and-go direction
+    segment.direction = 1.0;
+    segment.profile.init(trip_len, 0.0, 0.0, speed_max_, accel_max_);
+    segments.push_back(segment);
+}
+
+//point-and-go as segments: a spin to point toward the goal coords, then straight-line travel.
+// if start and goal coords are within path_move_tol_, only a spin to the goal heading.
+//NOTE: clears segments first
+void TrajBuilder::build_point_and_go_segments(geometry_msgs::PoseStamped start_pose,
+        geometry_msgs::PoseStamped end_pose,
+        std::vector<TrajSegment> &segments) {
+    segments.clear();
+    double dx = end_pose.pose.position.x - start_pose.pose.position.x;
+    double dy = end_pose.pose.position.y - start_pose.pose.position.y;
+    if (sqrt(dx * dx + dy * dy) < path_move_tol_) {
+        ROS_INFO("goal coords coincide with start; spinning to goal heading");
+        build_spin_segment(start_pose, end_pose, segments);
+        return;
     }
-    //now cruise for distance cruise_distance at const omega
-    omega_des = sgn(dpsi)*omega_max_;
-    des_state.twist.twist.angular.z  = sgn(dpsi)*omega_max_;
-    double t_cruise = cruise_distance / omega_max_;
-    int npts_cruise = round(t_cruise / dt_);
-    for (int i = 0; i < npts_cruise; i++) {
-        //Euler one-step integration
-        psi_des += omega_des*dt_; //Euler one-step integration
-        des_state.pose.pose.orientation = convertPlanarPsi2Quaternion(psi_des);
-        vec_of_states.push_back(des_state);
-    }    
-    //ramp down omega to halt:
-    for (int i = 0; i < npts_ramp; i++) {
-        omega_des -= accel*dt_; //Euler one-step integration
-        des_state.twist.twist.angular.z = omega_des;
-        psi_des += omega_des*dt_; //Euler one-step integration
-        des_state.pose.pose.orientation = convertPlanarPsi2Quaternion(psi_des);
+    double des_psi = atan2(dy, dx); //heading to point towards goal pose
+    ROS_INFO("desired heading to subgoal = %f", des_psi);
+    //bridge pose: state of robot with start_x, start_y, but pointing at next subgoal
+    geometry_msgs::PoseStamped bridge_pose = start_pose;
+    bridge_pose.pose.orientation = convertPlanarPsi2Quaternion(des_psi);
+    build_spin_segment(start_pose, bridge_pose, segments);
+    build_travel_segment(bridge_pose, end_pose, segments);
+}
+
+//braking from the (possibly moving) state current_state to a halt, at the max accel (or alpha):
+// a single segment, decelerating along the current heading or spin direction.
+// if current_state is both moving and spinning (e.g. in a corner blend), speed and spin rate
+// ramp down together, in a BLEND segment, until one of them reaches 0; a TRAVEL or SPIN segment
+// then brings the other to 0.
+// if current_state is at rest, this is a zero-duration segment that holds the current pose
+//NOTE: clears segments first
+void TrajBuilder::build_braking_segments(nav_msgs::Odometry current_state,
+        std::vector<TrajSegment> &segments) {
+    segments.clear();
+    TrajSegment segment;
+    double speed = current_state.twist.twist.linear.x;
+    double omega = current_state.twist.twist.angular.z;
+    segment.x_start = current_state.pose.pose.position.x;
+    segment.y_start = current_state.pose.pose.position.y;
+    segment.psi_start = convertPlanarQuat2Psi(current_state.pose.pose.orientation);
+    segment.x_end = segment.x_start;
+    segment.y_end = segment.y_start;
+    segment.psi_end = segment.psi_start;
+    if (fabs(speed) > 0.0 && fabs(omega) > 0.0) {
+        double t_stop = std::min(fabs(speed) / accel_max_, fabs(omega) / alpha_max_);
+        double omega_end = std::max(0.0, fabs(omega) - alpha_max_ * t_stop);
+        double dpsi = 0.5 * (omega * omega - omega_end * omega_end) / alpha_max_;
+        segment.type = TrajSegment::BLEND;
+        segment.direction = sgn(omega);
+        segment.speed = speed;
+        segment.speed_rate = -sgn(speed) * accel_max_;
+        segment.profile.init(dpsi, fabs(omega), omega_end, fabs(omega), alpha_max_);
+        double dx, dy;
+        segment.get_blend_displacement(segment.get_duration(), dx, dy);
+        segment.x_end += dx;
+        segment.y_end += dy;
+        segment.psi_end = min_dang(segment.psi_start + segment.direction * dpsi);
+        //then brake whichever of speed or spin rate is left
+        nav_msgs::Odometry end_state = current_state;
+        segment.eval(segment.get_duration(), end_state);
+        if (omega_end > 0.0) {
+            end_state.twist.twist.linear.x = 0.0;
+        } else {
+            end_state.twist.twist.angular.z = 0.0;
+        }
+        build_braking_segments(end_state, segments);
+        segments.insert(segments.begin(), segment);
+        return;
+    }
+    if (fabs(speed) > 0.0) {
+        double dist = 0.5 * speed * speed / accel_max_;
+        segment.type = TrajSegment::TRAVEL;
+        segment.direction = sgn(speed);
+        segment.x_end += segment.direction * dist * cos(segment.psi_start);
+        segment.y_end += segment.direction * dist * sin(segment.psi_start);
+        segment.profile.init(dist, fabs(speed), 0.0, fabs(speed), accel_max_);
+    } else if (fabs(omega) > 0.0) {
+        double dpsi = 0.5 * omega * omega / alpha_max_;
+        segment.type = TrajSegment::SPIN;
+        segment.direction = sgn(omega);
+        segment.psi_end = min_dang(segment.psi_start + segment.direction * dpsi);
+        segment.profile.init(dpsi, fabs(omega), 0.0, fabs(omega), alpha_max_);
+    }
+    segments.push_back(segment);
+}
+
+//look-ahead path through all of subgoals, in order, as segments.  Rather than halting at each
+// subgoal and spinning in place (point-and-go), each corner of the path is blended: the robot
+// turns the corner at speed, with a BLEND segment that ramps the spin rate up and back down at
+// alpha_max_, and the straight parts between corners change speed at accel_max_.  The blend cuts
+// the corner, so the robot passes near, not through, the subgoal.
+//Corner speeds are chosen as fast as possible, subject to speed_max_, to each blend using at
+// most half of each leg next to it (all of a leg if the other end is not blended), and to being
+// able to reach each corner speed from the last, and come to rest at the final subgoal.
+//A corner is not blended (the robot stops and spins in place, as in point-and-go) if it turns
+// more than max_blend_angle_, if it could only be blended slower than min_blend_speed_, or if
+// a subgoal repeats the previous one's coords (path_move_tol_), in which case the robot
+// spins to that subgoal's heading.
+//start_state is either at rest (the path starts by pointing toward the first subgoal), or moving
+// forward along the straight line to the first subgoal, e.g. at the end of a blend of a
+// previous plan.  Segments that complete a subgoal have reaches_subgoal set.
+//NOTE: clears segments first
+void TrajBuilder::build_blended_path_segments(nav_msgs::Odometry start_state,
+        const std::vector<geometry_msgs::PoseStamped> &subgoals,
+        std::vector<TrajSegment> &segments) {
+    segments.clear();
+    int n = subgoals.size();
+    if (n == 0) {
+        return;
+    }
+    double v_start = fabs(start_state.twist.twist.linear.x);
+    double a = accel_max_;
+    //path vertices: 0 is the start, k=1..n the subgoals; leg k runs from vertex k-1 to vertex k
+    std::vector<double> x(n + 1), y(n + 1), len(n + 1, 0.0), heading(n + 1, 0.0);
+    std::vector<bool> spin_only(n + 1, false); //leg k has no travel: just spin to subgoal k heading
+    x[0] = start_state.pose.pose.position.x;
+    y[0] = start_state.pose.pose.position.y;
+    heading[0] = convertPlanarQuat2Psi(start_state.pose.pose.orientation);
+    for (int k = 1; k <= n; k++) {
+        x[k] = subgoals[k - 1].pose.position.x;
+        y[k] = subgoals[k - 1].pose.position.y;
+        double dx = x[k] - x[k - 1];
+        double dy = y[k] - y[k - 1];
+        len[k] = sqrt(dx * dx + dy * dy);
+        if (len[k] < path_move_tol_) {
+            spin_only[k] = true;
+            len[k] = 0.0;
+            x[k] = x[k - 1];
+            y[k] = y[k - 1];
+            heading[k] = convertPlanarQuat2Psi(subgoals[k - 1].pose.orientation);
+        } else {
+            heading[k] = atan2(dy, dx);
+        }
+    }
+
+    //corner k (at subgoal k, k=1..n-1) joins legs k and k+1; the final subgoal is always a stop.
+    // for a blended corner, the blend starts and ends a distance c[k]*v[k] from the subgoal
+    std::vector<bool> blend(n + 1, false);
+    std::vector<double> v(n + 1, 0.0), c(n + 1, 0.0);
+    std::vector<TrajSegment> blends(n + 1);
+    for (int k = 1; k < n; k++) {
+        double dpsi = min_dang(heading[k + 1] - heading[k]);
+        if (spin_only[k] || spin_only[k + 1] || fabs(dpsi) > max_blend_angle_) {
+            continue;
+        }
+        blend[k] = true;
+        v[k] = speed_max_;
+        TrajSegment &b = blends[k];
+        b.type = TrajSegment::BLEND;
+        b.direction = (dpsi < 0.0) ? -1.0 : 1.0;
+        b.profile.init(fabs(dpsi), 0.0, 0.0, omega_max_, alpha_max_); //spin rate, from 0 back to 0
+        //at unit speed, starting along +x: the blend ends a distance c from the corner, along both legs
+        b.speed = 1.0;
+        double bx, by;
+        b.get_blend_displacement(b.get_duration(), bx, by);
+        c[k] = bx / (1.0 + cos(dpsi));
+    }
+    v[0] = v_start;
+    bool changed = true;
+    while (changed) {
+        //geometric limit: a blend may use half of each leg next to it, or all of it if the
+        // other end of the leg is not blended
+        for (int k = 1; k < n; k++) {
+            if (!blend[k] || c[k] <= 0.0) continue;
+            double share_in = (k > 1 && blend[k - 1]) ? 0.5 : 1.0;
+            double share_out = (k + 1 < n && blend[k + 1]) ? 0.5 : 1.0;
+            double v_geom = std::min(share_in * len[k], share_out * len[k + 1]) / c[k];
+            if (v[k] > v_geom) v[k] = v_geom;
+        }
+        //speed changes along the straight parts: alternate forward and backward passes until settled.
+        // v[k] must be reachable from v[k-1] over the straight part of leg k, whose length itself
+        // shrinks with v[k]: v^2 <= v_prev^2 + 2a*(len - d_prev - c*v)
+        for (int iter = 0; iter < 20; iter++) {
+            double max_dv = 0.0;
+            for (int k = 1; k < n; k++) {
+                if (!blend[k]) continue;
+                double room = len[k] - c[k - 1] * v[k - 1];
+                double v_max = -a * c[k] + sqrt(std::max(0.0, a * a * c[k] * c[k] + v[k - 1] * v[k - 1] + 2.0 * a * room));
+                if (v[k] > v_max) {
+                    max_dv = std::max(max_dv, v[k] - v_max);
+                    v[k] = v_max;
+                }
+            }
+            for (int k = n - 1; k >= 1; k--) {
+                if (!blend[k]) continue;
+                double room = len[k + 1] - c[k + 1] * v[k + 1];
+                double v_max = -a * c[k] + sqrt(std::max(0.0, a * a * c[k] * c[k] + v[k + 1] * v[k + 1] + 2.0 * a * room));
+                if (v[k] > v_max) {
+                    max_dv = std::max(max_dv, v[k] - v_max);
+                    v[k] = v_max;
+                }
+            }
+            //starting at speed, the first blend must also leave room to slow down from v_start:
+            // v^2 - 2ac*v >= v_start^2 - 2a*len, which holds for v below the smaller root
+            if (blend[1]) {
+                double disc = a * a * c[1] * c[1] + v_start * v_start - 2.0 * a * len[1];
+                if (disc > 0.0) {
+                    double v_max = std::max(0.0, a * c[1] - sqrt(disc));
+                    if (v[1] > v_max) {
+                        max_dv = std::max(max_dv, v[1] - v_max);
+                        v[1] = v_max;
+                    }
+                }
+            }
+            if (max_dv < 1e-6) break;
+        }
+        //corners that would be blended too slowly become stops; then settle the speeds again
+        changed = false;
+        for (int k = 1; k < n; k++) {
+            if (blend[k] && v[k] < min_blend_speed_) {
+                blend[k] = false;
+                v[k] = 0.0;
+                c[k] = 0.0;
+                changed = true;
+            }
+        }
+    }
+
+    //emit the segments, leg by leg
+    geometry_msgs::PoseStamped pose_from = xyPsi2PoseStamped(x[0], y[0], heading[0]);
+    double v_from = v_start;
+    for (int k = 1; k <= n; k++) {
+        if (spin_only[k]) { //at rest here; spin to the subgoal heading
+            geometry_msgs::PoseStamped pose_to = xyPsi2PoseStamped(x[k], y[k], heading[k]);
+            build_spin_segment(pose_from, pose_to, segments);
+            segments.back().reaches_subgoal = true;
+            pose_from = pose_to;
+            continue;
+        }
+        if (v_from <= 0.0) { //at rest: point toward the subgoal first
+            geometry_msgs::PoseStamped pose_to = xyPsi2PoseStamped(pose_from.pose.position.x, pose_from.pose.position.y, heading[k]);
+            build_spin_segment(pose_from, pose_to, segments);
+        }
+        double cos_h = cos(heading[k]);
+        double sin_h = sin(heading[k]);
+        double d_to = blend[k] ? c[k] * v[k] : 0.0;
+        TrajSegment travel;
+        travel.type = TrajSegment::TRAVEL;
+        travel.x_start = pose_from.pose.position.x;
+        travel.y_start = pose_from.pose.position.y;
+        travel.psi_start = heading[k];
+        travel.x_end = x[k] - d_to * cos_h;
+        travel.y_end = y[k] - d_to * sin_h;
+        travel.psi_end = heading[k];
+        double dx = travel.x_end - travel.x_start;
+        double dy = travel.y_end - travel.y_start;
+        travel.profile.init(sqrt(dx * dx + dy * dy), v_from, v[k], speed_max_, accel_max_);
+        segments.push_back(travel);
+        if (!blend[k] || blends[k].get_duration() <= 0.0) { //stop, or pass straight through
+            segments.back().reaches_subgoal = true;
+            pose_from = xyPsi2PoseStamped(x[k], y[k], heading[k]);
+            v_from = blend[k] ? v[k] : 0.0;
+            continue;
+        }
+        TrajSegment &b = blends[k];
+        b.speed = v[k];
+        b.x_start = travel.x_end;
+        b.y_start = travel.y_end;
+        b.psi_start = heading[k];
+        b.x_end = x[k] + d_to * cos(heading[k + 1]);
+        b.y_end = y[k] + d_to * sin(heading[k + 1]);
+        b.psi_end = heading[k + 1];
+        b.reaches_subgoal = true;
+        segments.push_back(b);
+        pose_from = xyPsi2PoseStamped(b.x_end, b.y_end, b.psi_end);
+        v_from = v[k];
+    }
+}
+
+//sample segments every dt_, appending the states to vec_of_states; each segment contributes
+// the states at dt_, 2*dt_, ... and then its exact end state
+void TrajBuilder::sample_segments(const std::vector<TrajSegment> &segments,
+        std_msgs::Header header,
+        std::vector<nav_msgs::Odometry> &vec_of_states) {
+    nav_msgs::Odometry des_state;
+    des_state.header = header; //really, want to copy the frame_id
+    for (int iseg = 0; iseg < (int) segments.size(); iseg++) {
+        const TrajSegment &segment = segments[iseg];
+        int npts = ceil(segment.get_duration() / dt_); //last of these is the end state
+        vec_of_states.reserve(vec_of_states.size() + npts + 1);
+        for (int i = 1; i < npts; i++) {
+            segment.eval(i * dt_, des_state);
+            vec_of_states.push_back(des_state);
+        }
+        segment.eval(segment.get_duration(), des_state); //precisely at the end, and at rest
         vec_of_states.push_back(des_state);
     }
-    //make sure the last state is precisely where desired, and at rest:
-    des_state.pose.pose = end_pose.pose; //
-    des_state.twist.twist = halt_twist_; // insist on full stop
-    vec_of_states.push_back(des_state);
+}
+
+//for spin-in-place motion that would hit maximum angular velocity, construct 
+// trapezoidal angular velocity profile
+//(build_spin_segment() chooses trapezoidal vs triangular itself; these are kept for compatibility)
+void TrajBuilder::build_trapezoidal_spin_traj(geometry_msgs::PoseStamped start_pose,
+        geometry_msgs::PoseStamped end_pose,
+        std::vector<nav_msgs::Odometry> &vec_of_states) {
+    build_spin_traj(start_pose, end_pose, vec_of_states);
+}
+
+void TrajBuilder::build_triangular_spin_traj(geometry_msgs::PoseStamped start_pose,
+        geometry_msgs::PoseStamped end_pose,
+        std::vector<nav_msgs::Odometry> &vec_of_states) {
+    build_spin_traj(start_pose, end_pose, vec_of_states);
 }
 
 //upper-level function to construct a spin-in-place trajectory
-// this function decides if triangular or trapezoidal angular-velocity
-// profile is needed
 void TrajBuilder::build_spin_traj(geometry_msgs::PoseStamped start_pose,
         geometry_msgs::PoseStamped end_pose,
         std::vector<nav_msgs::Odometry> &vec_of_states) {
-    //decide if triangular or trapezoidal profile:
-    double x_start = start_pose.pose.position.x;
-    double y_start = start_pose.pose.position.y;
-    double x_end = end_pose.pose.position.x;
-    double y_end = end_pose.pose.position.y;
-    double dx = x_end - x_start;
-    double dy = y_end - y_start;
-    double psi_start = convertPlanarQuat2Psi(start_pose.pose.orientation);
-    double psi_end = convertPlanarQuat2Psi(end_pose.pose.orientation);
-    double dpsi = min_dang(psi_end - psi_start);
-    ROS_INFO("rotational spin distance = %f", dpsi);
-    double ramp_up_time = omega_max_/ alpha_max_;    
-    double ramp_up_dist = 0.5 * alpha_max_ * ramp_up_time*ramp_up_time;
-    //decide on triangular vs trapezoidal:
-    if (fabs(dpsi) < 2.0 * ramp_up_dist) { //delta-angle is too short for trapezoid
-        build_triangular_spin_traj(start_pose, end_pose, vec_of_states);
-    } else {
-        build_trapezoidal_spin_traj(start_pose, end_pose, vec_of_states);
-    }   
+    std::vector<TrajSegment> segments;
+    build_spin_segment(start_pose, end_pose, segments);
+    sample_segments(segments, start_pose.header, vec_of_states);
 }
 
 //fnc to build a pure straight-line motion trajectory
-//determines if a triangular or trapezoidal velocity profile is needed
 void TrajBuilder::build_travel_traj(geometry_msgs::PoseStamped start_pose,
         geometry_msgs::PoseStamped end_pose,
         std::vector<nav_msgs::Odometry> &vec_of_states) {
-    //decide if triangular or trapezoidal profile:
-    double x_start = start_pose.pose.position.x;
-    double y_start = start_pose.pose.position.y;
-    double x_end = end_pose.pose.position.x;
-    double y_end = end_pose.pose.position.y;
-    double dx = x_end - x_start;
-    double dy = y_end - y_start;
-    double trip_len = sqrt(dx * dx + dy * dy);
-    double ramp_up_dist = 0.5 * speed_max_ * speed_max_ / alpha_max_;
-    ROS_INFO("trip len = %f", trip_len);
-    if (trip_len < 2.0 * ramp_up_dist) { //length is too short for trapezoid
-        build_triangular_travel_traj(start_pose, end_pose, vec_of_states);
-    } else {
-        build_trapezoidal_travel_traj(start_pose, end_pose, vec_of_states);
-    }
+    std::vector<TrajSegment> segments;
+    build_travel_segment(start_pose, end_pose, segments);
+    sample_segments(segments, start_pose.header, vec_of_states);
 }
 
-//given that straight-line, trapezoidal velocity profile trajectory is needed,
-// construct the sequence of states (positions and velocities) to achieve the
-// desired motion, subject to speed and acceleration constraints
 void TrajBuilder::build_trapezoidal_travel_traj(geometry_msgs::PoseStamped start_pose,
         geometry_msgs::PoseStamped end_pose,
         std::vector<nav_msgs::Odometry> &vec_of_states) {
-    double x_start = start_pose.pose.position.x;
-    double y_start = start_pose.pose.position.y;
-    double x_end = end_pose.pose.position.x;
-    double y_end = end_pose.pose.position.y;
-    double dx = x_end - x_start;
-    double dy = y_end - y_start;
-    double psi_des = atan2(dy, dx);
-    double trip_len = sqrt(dx * dx + dy * dy);
-    double t_ramp = speed_max_ / accel_max_;
-    double ramp_up_dist = 0.5 * accel_max_ * t_ramp*t_ramp;
-    double cruise_distance = trip_len - 2.0 * ramp_up_dist; //distance to travel at v_max 
-    ROS_INFO("t_ramp =%f",t_ramp);
-    ROS_INFO("ramp-up dist = %f",ramp_up_dist);
-    ROS_INFO("cruise distance = %f",cruise_distance);
-    //start ramping up:
-    nav_msgs::Odometry des_state;
-    des_state.header = start_pose.header; //really, want to copy the frame_id
-    des_state.pose.pose = start_pose.pose; //start from here
-    des_state.twist.twist = halt_twist_; // insist on starting from rest
-    int npts_ramp = round(t_ramp / dt_);
-    double x_des = x_start; //start from here
-    double y_des = y_start;
-    double speed_des = 0.0;
-    des_state.twist.twist.angular.z = 0.0; //omega_des; will not change
-    des_state.pose.pose.orientation = convertPlanarPsi2Quaternion(psi_des); //constant
-    // orientation of des_state will not change; only position and twist
-    
-    double t = 0.0;
-    //ramp up;
-    for (int i = 0; i < npts_ramp; i++) {
-        t += dt_;
-        speed_des = accel_max_*t;
-        des_state.twist.twist.linear.x = speed_des; //update speed
-        //update positions
-        x_des = x_start + 0.5 * accel_max_ * t * t * cos(psi_des);
-        y_des = y_start + 0.5 * accel_max_ * t * t * sin(psi_des);
-        des_state.pose.pose.position.x = x_des;
-        des_state.pose.pose.position.y = y_des;
-        vec_of_states.push_back(des_state);
-    }
-    //now cruise for distance cruise_distance at const speed
-    speed_des = speed_max_;
-    des_state.twist.twist.linear.x = speed_des;
-    double t_cruise = cruise_distance / speed_max_;
-    int npts_cruise = round(t_cruise / dt_);
-    ROS_INFO("t_cruise = %f; npts_cruise = %d",t_cruise,npts_cruise);
-    for (int i = 0; i < npts_cruise; i++) {
-        //Euler one-step integration
-        x_des += speed_des * dt_ * cos(psi_des);
-        y_des += speed_des * dt_ * sin(psi_des);
-        des_state.pose.pose.position.x = x_des;
-        des_state.pose.pose.position.y = y_des;
-        vec_of_states.push_back(des_state);
-    }
-    //ramp down:
-    for (int i = 0; i < npts_ramp; i++) {
-        speed_des -= accel_max_*dt_; //Euler one-step integration
-        des_state.twist.twist.linear.x = speed_des;
-        x_des += speed_des * dt_ * cos(psi_des); //Euler one-step integration
-        y_des += speed_des * dt_ * sin(psi_des); //Euler one-step integration        
-        des_state.pose.pose.position.x = x_des;
-        des_state.pose.pose.position.y = y_des;
-        vec_of_states.push_back(des_state);
-    }
-    //make sure the last state is precisely where requested, and at rest:
-    des_state.pose.pose = end_pose.pose;
-    //but final orientation will follow from point-and-go direction
-    des_state.pose.pose.orientation = convertPlanarPsi2Quaternion(psi_des);
-    des_state.twist.twist = halt_twist_; // insist on starting from rest
-    vec_of_states.push_back(des_state);
+    build_travel_traj(start_pose, end_pose, vec_of_states);
 }
 
-// constructs straight-line trajectory with triangular velocity profile,
-// respective limits of velocity and accel
 void TrajBuilder::build_triangular_travel_traj(geometry_msgs::PoseStamped start_pose,
         geometry_msgs::PoseStamped end_pose,
         std::vector<nav_msgs::Odometry> &vec_of_states) {
-    double x_start = start_pose.pose.position.x;
-    double y_start = start_pose.pose.position.y;
-    double x_end = end_pose.pose.position.x;
-    double y_end = end_pose.pose.position.y;
-    double dx = x_end - x_start;
-    double dy = y_end - y_start;
-    double psi_des = atan2(dy, dx);
-    nav_msgs::Odometry des_state;
-    des_state.header = start_pose.header; //really, want to copy the frame_id
-    des_state.pose.pose = start_pose.pose; //start from here
-    des_state.twist.twist = halt_twist_; // insist on starting from rest
-    double trip_len = sqrt(dx * dx + dy * dy);
-    double t_ramp = sqrt(trip_len / accel_max_);
-    int npts_ramp = round(t_ramp / dt_);
-    double v_peak = accel_max_*t_ramp; // could consider special cases for reverse motion
-    double d_vel = alpha_max_*dt_; // incremental velocity changes for ramp-up
-
-    double x_des = x_start; //start from here
-    double y_des = y_start;
-    double speed_des = 0.0;
-    des_state.twist.twist.angular.z = 0.0; //omega_des; will not change
-    des_state.pose.pose.orientation = convertPlanarPsi2Quaternion(psi_des); //constant
-    // orientation of des_state will not change; only position and twist
-    double t = 0.0;
-    //ramp up;
-    for (int i = 0; i < npts_ramp; i++) {
-        t += dt_;
-        speed_des = accel_max_*t;
-        des_state.twist.twist.linear.x = speed_des; //update speed
-        //update positions
-        x_des = x_start + 0.5 * accel_max_ * t * t * cos(psi_des);
-        y_des = y_start + 0.5 * accel_max_ * t * t * sin(psi_des);
-        des_state.pose.pose.position.x = x_des;
-        des_state.pose.pose.position.y = y_des;
-        vec_of_states.push_back(des_state);
-    }
-    //ramp down:
-    for (int i = 0; i < npts_ramp; i++) {
-        speed_des -= accel_max_*dt_; //Euler one-step integration
-        des_state.twist.twist.linear.x = speed_des;
-        x_des += speed_des * dt_ * cos(psi_des); //Euler one-step integration
-        y_des += speed_des * dt_ * sin(psi_des); //Euler one-step integration        
-        des_state.pose.pose.position.x = x_des;
-        des_state.pose.pose.position.y = y_des;
-        vec_of_states.push_back(des_state);
-    }
-    //make sure the last state is precisely where requested, and at rest:
-    des_state.pose.pose = end_pose.pose;
-    //but final orientation will follow from point-and-go direction
-    des_state.pose.pose.orientation = convertPlanarPsi2Quaternion(psi_des);
-    des_state.twist.twist = halt_twist_; // insist on starting from rest
-    vec_of_states.push_back(des_state);
-}
-
-void TrajBuilder::build_triangular_spin_traj(geometry_msgs::PoseStamped start_pose,
-        geometry_msgs::PoseStamped end_pose,
-        std::vector<nav_msgs::Odometry> &vec_of_states) {
-    nav_msgs::Odometry des_state;
-    des_state.header = start_pose.header; //really, want to copy the frame_id
-    des_state.pose.pose = start_pose.pose; //start from here
-    des_state.twist.twist = halt_twist_; // insist on starting from rest
-    vec_of_states.push_back(des_state);
-    double psi_start = convertPlanarQuat2Psi(start_pose.pose.orientation);
-    double psi_end = convertPlanarQuat2Psi(end_pose.pose.orientation);
-    double dpsi = min_dang(psi_end - psi_start);
-    ROS_INFO("spin traj: psi_start = %f; psi_end = %f; dpsi= %f", psi_start, psi_end, dpsi);
-    double t_ramp = sqrt(fabs(dpsi) / alpha_max_);
-    int npts_ramp = round(t_ramp / dt_);
-    double psi_des = psi_start; //start from here
-    double omega_des = 0.0; // assumes spin starts from rest; 
-    // position of des_state will not change; only orientation and twist
-    double t = 0.0;
-    double accel = sgn(dpsi) * alpha_max_; //watch out for sign: CW vs CCW rotation
-    //ramp up;
-    for (int i = 0; i < npts_ramp; i++) {
-        t += dt_;
-        omega_des = accel*t;
-        des_state.twist.twist.angular.z = omega_des; //update rotation rate
-        //update orientation
-        psi_des = psi_start + 0.5 * accel * t*t;
-        des_state.pose.pose.orientation = convertPlanarPsi2Quaternion(psi_des);
-        vec_of_states.push_back(des_state);
-    }
-    //ramp down:
-    for (int i = 0; i < npts_ramp; i++) {
-        omega_des -= accel*dt_; //Euler one-step integration
-        des_state.twist.twist.angular.z = omega_des;
-        psi_des += omega_des*dt_; //Euler one-step integration
-        des_state.pose.pose.orientation = convertPlanarPsi2Quaternion(psi_des);
-        vec_of_states.push_back(des_state);
-    }
-    //make sure the last state is precisely where requested, and at rest:
-    des_state.pose.pose = end_pose.pose; //start from here
-    des_state.twist.twist = halt_twist_; // insist on starting from rest
-    vec_of_states.push_back(des_state);
+    build_travel_traj(start_pose, end_pose, vec_of_states);
 }
 
 //this function would be useful for planning a need for sudden braking
-//compute trajectory corresponding to applying max prudent decel to halt
+//given only a pose, the robot is assumed at rest: the result is a single halt state at start_pose.
+// to brake from a moving state, use build_braking_segments()
 void TrajBuilder::build_braking_traj(geometry_msgs::PoseStamped start_pose,
         std::vector<nav_msgs::Odometry> &vec_of_states) {
-    //FINISH ME!
-
+    nav_msgs::Odometry halt_state;
+    halt_state.header = start_pose.header;
+    halt_state.pose.pose = start_pose.pose;
+    halt_state.twist.twist = halt_twist_;
+    vec_of_states.clear();
+    vec_of_states.push_back(halt_state);
 }
 
 //main fnc of this library: constructs a spin-in-place reorientation to
@@ -417,26 +518,8 @@ void TrajBuilder::build_point_and_go_traj(geometry_msgs::PoseStamped start_pose,
         geometry_msgs::PoseStamped end_pose,
         std::vector<nav_msgs::Odometry> &vec_of_states) {
     ROS_INFO("building point-and-go trajectory");
-    nav_msgs::Odometry bridge_state;
-    geometry_msgs::PoseStamped bridge_pose; //bridge end of prev traj to start of new traj
+    std::vector<TrajSegment> segments;
     vec_of_states.clear(); //get ready to build a new trajectory of desired states
-    ROS_INFO("building rotational trajectory");
-    double x_start = start_pose.pose.position.x;
-    double y_start = start_pose.pose.position.y;
-    double x_end = end_pose.pose.position.x;
-    double y_end = end_pose.pose.position.y;
-    double dx = x_end - x_start;
-    double dy = y_end - y_start;
-    double des_psi = atan2(dy, dx); //heading to point towards goal pose
-    ROS_INFO("desired heading to subgoal = %f", des_psi);
-    //bridge pose: state of robot with start_x, start_y, but pointing at next subgoal
-    //  achieve this pose with a spin move before proceeding to subgoal with translational
-    //  motion
-    bridge_pose = start_pose;
-    bridge_pose.pose.orientation = convertPlanarPsi2Quaternion(des_psi);
-    ROS_INFO("building reorientation trajectory");
-    build_spin_traj(start_pose, bridge_pose, vec_of_states); //build trajectory to reorient
-    //start next segment where previous segment left off
-    ROS_INFO("building translational trajectory");
-    build_travel_traj(bridge_pose, end_pose, vec_of_states);
+    build_point_and_go_segments(start_pose, end_pose, segments);
+    sample_segments(segments, start_pose.header, vec_of_states);
 }
@@ -0,0 +1,143 @@
+// traj_segment.cpp: closed-form evaluation of trajectory segments; see traj_segment.h
+#include <traj_builder/traj_segment.h>
+
+VelocityProfile::VelocityProfile() {
+    init(0.0, 0.0, 0.0, 1.0, 1.0);
+}
+
+void VelocityProfile::init(double dist, double v_start, double v_end, double v_max, double accel) {
+    dist_ = dist;
+    v_start_ = v_start;
+    v_end_ = v_end;
+    //if dist is too short to change speed from v_start to v_end at accel, use the (higher) accel
+    // that just does it, so the profile is a single ramp that still ends exactly at dist
+    double dv2 = fabs(v_start * v_start - v_end * v_end);
+    if (dv2 > 2.0 * accel * dist) {
+        if (dist <= 0.0) { //no distance at all: the speed steps from v_start to v_end at t = 0
+            accel_ = accel;
+            v_peak_ = (v_start > v_end) ? v_start : v_end;
+            t_accel_ = t_cruise_ = t_decel_ = 0.0;
+            d_accel_ = d_cruise_ = 0.0;
+            return;
+        }
+        accel = dv2 / (2.0 * dist);
+    }
+    accel_ = accel;
+    //distance needed to reach v_max from v_start, and to come down from v_max to v_end:
+    double d_up = (v_max * v_max - v_start * v_start) / (2.0 * accel);
+    double d_down = (v_max * v_max - v_end * v_end) / (2.0 * accel);
+    if (d_up + d_down <= dist) { //trapezoidal: room to cruise at v_max
+        v_peak_ = v_max;
+    } else { //triangular: peak speed s.t. ramp-up and ramp-down distances sum to dist
+        v_peak_ = sqrt(accel * dist + 0.5 * (v_start * v_start + v_end * v_end));
+    }
+    //guard against round-off, when the profile is a single ramp
+    if (v_peak_ < v_start) v_peak_ = v_start;
+    if (v_peak_ < v_end) v_peak_ = v_end;
+    t_accel_ = (v_peak_ - v_start) / accel;
+    t_decel_ = (v_peak_ - v_end) / accel;
+    d_accel_ = 0.5 * (v_start + v_peak_) * t_accel_;
+    double d_decel = 0.5 * (v_peak_ + v_end) * t_decel_;
+    double d_cruise = dist - d_accel_ - d_decel;
+    t_cruise_ = (d_cruise > 0.0 && v_peak_ > 0.0) ? d_cruise / v_peak_ : 0.0;
+    d_cruise_ = d_accel_ + v_peak_ * t_cruise_;
+}
+
+void VelocityProfile::eval(double t, double &s, double &v) const {
+    if (t <= 0.0) {
+        s = 0.0;
+        v = v_start_;
+    } else if (t < t_accel_) {
+        s = v_start_ * t + 0.5 * accel_ * t * t;
+        v = v_start_ + accel_ * t;
+    } else if (t < t_accel_ + t_cruise_) {
+        s = d_accel_ + v_peak_ * (t - t_accel_);
+        v = v_peak_;
+    } else if (t < t_accel_ + t_cruise_ + t_decel_) {
+        double tau = t - t_accel_ - t_cruise_;
+        s = d_cruise_ + v_peak_ * tau - 0.5 * accel_ * tau * tau;
+        v = v_peak_ - accel_ * tau;
+    } else {
+        s = dist_;
+        v = v_end_;
+    }
+}
+
+TrajSegment::TrajSegment() {
+    type = TRAVEL;
+    x_start = y_start = psi_start = 0.0;
+    x_end = y_end = psi_end = 0.0;
+    direction = 1.0;
+    speed = 0.0;
+    speed_rate = 0.0;
+    reaches_subgoal = false;
+}
+
+//Simpson's rule, over a fixed number of steps
+static const int N_BLEND_STEPS = 16; //must be even
+
+void TrajSegment::get_blend_displacement(double t, double &dx, double &dy) const {
+    dx = 0.0;
+    dy = 0.0;
+    if (t <= 0.0) {
+        return;
+    }
+    double h = t / N_BLEND_STEPS;
+    for (int i = 0; i <= N_BLEND_STEPS; i++) {
+        double s, v;
+        profile.eval(i * h, s, v);
+        double psi = psi_start + direction * s;
+        double w = (i == 0 || i == N_BLEND_STEPS) ? 1.0 : ((i % 2) ? 4.0 : 2.0);
+        w *= speed + speed_rate * i * h;
+        dx += w * cos(psi);
+        dy += w * sin(psi);
+    }
+    dx *= h / 3.0;
+    dy *= h / 3.0;
+}
+
+void TrajSegment::eval(double t, nav_msgs::Odometry &des_state) const {
+    double s, v, x, y, psi;
+    bool done = (t >= get_duration());
+    profile.eval(t, s, v);
+    des_state.twist.twist.linear.x = 0.0;
+    des_state.twist.twist.linear.y = 0.0;
+    des_state.twist.twist.linear.z = 0.0;
+    des_state.twist.twist.angular.x = 0.0;
+    des_state.twist.twist.angular.y = 0.0;
+    des_state.twist.twist.angular.z = 0.0;
+    if (done) {
+        x = x_end;
+        y = y_end;
+        psi = psi_end;
+    } else if (type == SPIN) {
+        x = x_start;
+        y = y_start;
+        psi = psi_start + direction * s;
+    } else if (type == BLEND) {
+        double dx, dy;
+        get_blend_displacement(t, dx, dy);
+        x = x_start + dx;
+        y = y_start + dy;
+        psi = psi_start + direction * s;
+    } else {
+        x = x_start + direction * s * cos(psi_start);
+        y = y_start + direction * s * sin(psi_start);
+        psi = psi_start;
+    }
+    if (type == SPIN) {
+        des_state.twist.twist.angular.z = direction * v;
+    } else if (type == BLEND) {
+        des_state.twist.twist.linear.x = speed + speed_rate * (done ? get_duration() : t);
+        des_state.twist.twist.angular.z = direction * v;
+    } else {
+        des_state.twist.twist.linear.x = direction * v;
+    }
+    des_state.pose.pose.position.x = x;
+    des_state.pose.pose.position.y = y;
+    des_state.pose.pose.position.z = 0.0;
+    des_state.pose.pose.orientation.x = 0.0;
+    des_state.pose.pose.orientation.y = 0.0;
+    des_state.pose.pose.orientation.z = sin(psi / 2.0);
+    des_state.pose.pose.orientation.w = cos(psi / 2.0);
+}
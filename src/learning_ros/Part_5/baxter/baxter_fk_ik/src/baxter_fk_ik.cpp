@@ -1383,7 +1383,7 @@ bool Baxter_IK_solver::update_spherical_wrist(Vectorq7x1 q_in,Eigen::Matrix3d R_
     std::vector<Vectorq7x1> q_solns;
     solve_spherical_wrist(q_in,R_des, q_solns); // expect 2 wrist solns, if w/in jnt ranges
     int nsolns = q_solns.size();
-    ROS_INFO("update_spherical_wrist: num solns for wrist = %d",nsolns);
+    ROS_DEBUG("update_spherical_wrist: num solns for wrist = %d",nsolns);
     if (nsolns==0) { // no wrist solns within range
         q_precise = q_in; // just echo back the input
         return false; // note that we do not have a satisfactory soln
@@ -23,6 +23,12 @@ using namespace std;
 const double CARTESIAN_PATH_SAMPLE_SPACING = 0.05; // choose the resolution of samples along Cartesian path
 const double CARTESIAN_PATH_FINE_SAMPLE_SPACING = 0.005; // fine resolution for precision motion
 
+//IK continuation: rather than a full IK sweep (all elbow-orbit solutions) at every Cartesian sample, the solutions of
+// the previous sample are tracked to the next with Jacobian steps; a full sweep is done only where no branch survives
+const int MAX_CONTINUATION_BRANCHES = 8; // track at most this many IK solutions along the path
+const double CONTINUATION_MAX_DQ = 0.3; // a tracked soln may not move any joint more than this (rad) from one sample to the next
+const double CONTINUATION_ROT_TOL = 0.001; // orientation tolerance (rad) of a tracked soln; position tolerance is W_ERR_TOL
+
 class CartTrajPlanner {
 private:
 
@@ -42,6 +48,17 @@ private:
 
     Eigen::VectorXd jspace_planner_weights_;
 
+    bool use_ik_continuation_;
+    int n_ik_sweeps_; //number of full IK sweeps in the most recent plan
+
+    //fill layer w/ IK solns for a_flange_des, given the layers planned so far: tracks the solns of the last layer,
+    // if continuation is enabled, else (or if all branches are lost) does a full sweep
+    int solve_ik_layer(Eigen::Affine3d a_flange_des, std::vector<std::vector<Eigen::VectorXd> > &path_options,
+            std::vector<Eigen::VectorXd> &layer);
+    bool jacobian_ik_step(Eigen::Affine3d a_flange_des, Vectorq7x1 q_prev, Vectorq7x1 &q_next);
+    int track_ik_layer(Eigen::Affine3d a_flange_des, std::vector<Eigen::VectorXd> &prev_layer, std::vector<Eigen::VectorXd> &layer);
+    int sweep_ik_layer(Eigen::Affine3d a_flange_des, std::vector<Eigen::VectorXd> &prev_layer, std::vector<Eigen::VectorXd> &layer);
+
 
     // use this classes baxter fk solver to compute and return tool-flange pose w/rt torso, given right-arm joint angles  
     Eigen::Affine3d get_fk_Affine_from_qvec(Vectorq7x1 q_vec);
@@ -75,6 +92,15 @@ public:
         return R_gripper_down_;
     }
 
+    /// IK continuation (default: on); if off, every Cartesian sample gets a full IK sweep, as originally
+    void set_ik_continuation(bool use_ik_continuation) {
+        use_ik_continuation_ = use_ik_continuation;
+    }
+    /// number of full IK sweeps needed by the most recent Cartesian plan
+    int get_num_ik_sweeps(void) {
+        return n_ik_sweeps_;
+    }
+
 };
 
 #endif	
\ No newline at end of file
@@ -9,6 +9,8 @@
 // a_flange_des is the desired tool-flange pose of RIGHT ARM
 
 #include <cartesian_planner/baxter_cartesian_planner.h>
+#include <algorithm>
+#include <utility>
 
 
 //constructor:
@@ -48,6 +50,9 @@ CartTrajPlanner::CartTrajPlanner() // optionally w/ args, e.g.
     jspace_planner_weights_[4] = 0.2;
     jspace_planner_weights_[5] = 0.2;
     jspace_planner_weights_[6] = 0.2;    
+
+    use_ik_continuation_ = true;
+    n_ik_sweeps_ = 0;
 }
 
 
@@ -63,6 +68,7 @@ bool CartTrajPlanner::cartesian_path_planner(Eigen::Affine3d a_flange_start, Eig
     a_flange_des.linear() = R_des;
     //store a vector of Cartesian affine samples for desired path:
     cartesian_affine_samples_.clear();
+    n_ik_sweeps_ = 0;
     //cartesian_affine_samples_.push_back(a_flange_start);
     int nsolns;
     bool reachable_proposition;
@@ -77,8 +83,6 @@ bool CartTrajPlanner::cartesian_path_planner(Eigen::Affine3d a_flange_start, Eig
     dp_vec = del_p / nsteps;
     nsteps++; //account for pose at step 0
 
-
-    std::vector<Vectorq7x1> q_solns;
     p_des = p_start;
 
     for (int istep = 0; istep < nsteps; istep++) {
@@ -86,20 +90,11 @@ bool CartTrajPlanner::cartesian_path_planner(Eigen::Affine3d a_flange_start, Eig
         cartesian_affine_samples_.push_back(a_flange_des);
 
         cout << "trying: " << p_des.transpose() << endl;
-        nsolns = baxter_IK_solver_.ik_solve_approx_wrt_torso(a_flange_des, q_solns);
+        nsolns = solve_ik_layer(a_flange_des, path_options, single_layer_nodes);
         std::cout << "nsolns = " << nsolns << endl;
-        single_layer_nodes.clear();
         if (nsolns > 0) {
-            single_layer_nodes.resize(nsolns);
-            for (int isoln = 0; isoln < nsolns; isoln++) {
-                // this is annoying: can't treat std::vector<Vectorq7x1> same as std::vector<Eigen::VectorXd> 
-                node = q_solns[isoln];
-                single_layer_nodes[isoln] = node;
-            }
-
             path_options.push_back(single_layer_nodes);
-        }
-        else {
+        } else {
             return false;
         }
         p_des += dp_vec;
@@ -150,6 +145,7 @@ bool CartTrajPlanner::cartesian_path_planner(Vectorq7x1 q_start, Eigen::Affine3d
     cout << a_flange_start.linear() << endl;
     //store a vector of Cartesian affine samples for desired path:
     cartesian_affine_samples_.clear();
+    n_ik_sweeps_ = 0;
     a_flange_des = a_flange_end;
     a_flange_start.linear() = R_des; // no interpolation of orientation; set goal orientation immediately   
     a_flange_des.linear() = R_des; //expected behavior: will try to achieve orientation first, before translating
@@ -177,7 +173,6 @@ bool CartTrajPlanner::cartesian_path_planner(Vectorq7x1 q_start, Eigen::Affine3d
     single_layer_nodes.push_back(node);
     path_options.push_back(single_layer_nodes);
 
-    std::vector<Vectorq7x1> q_solns;
     
     p_des = p_start;
     cartesian_affine_samples_.push_back(a_flange_start);
@@ -187,17 +182,9 @@ bool CartTrajPlanner::cartesian_path_planner(Vectorq7x1 q_start, Eigen::Affine3d
         a_flange_des.translation() = p_des;
         cartesian_affine_samples_.push_back(a_flange_des);
         cout << "trying: " << p_des.transpose() << endl;
-        nsolns = baxter_IK_solver_.ik_solve_approx_wrt_torso(a_flange_des, q_solns);
+        nsolns = solve_ik_layer(a_flange_des, path_options, single_layer_nodes);
         std::cout << "nsolns = " << nsolns << endl;
-        single_layer_nodes.clear();
         if (nsolns > 0) {
-            single_layer_nodes.resize(nsolns);
-            for (int isoln = 0; isoln < nsolns; isoln++) {
-                // this is annoying: can't treat std::vector<Vectorq7x1> same as std::vector<Eigen::VectorXd> 
-                node = q_solns[isoln];
-                single_layer_nodes[isoln] = node;
-            }
-
             path_options.push_back(single_layer_nodes);
         } else {
             return false;
@@ -233,7 +220,8 @@ bool CartTrajPlanner::cartesian_path_planner(Vectorq7x1 q_start, Eigen::Affine3d
     return true;
 }
 
-//this version uses a finer Cartesian sampling dp than the default
+//this version uses a finer Cartesian sampling dp than the default; with IK continuation, the cost of the fine samples
+// is a Jacobian step per tracked branch, rather than a full IK sweep (and much larger planner layers) per sample
 
 bool CartTrajPlanner::fine_cartesian_path_planner(Vectorq7x1 q_start, Eigen::Affine3d a_flange_end, std::vector<Eigen::VectorXd> &optimal_path) {
     //do trajectory planning w/ fine samples along Cartesian direction, but approximate IK solns:
@@ -253,6 +241,7 @@ bool CartTrajPlanner::cartesian_path_planner_delta_p(Vectorq7x1 q_start, Eigen::
     std::vector<std::vector<Eigen::VectorXd> > path_options;
     //store a vector of Cartesian affine samples for desired path:
     cartesian_affine_samples_.clear();
+    n_ik_sweeps_ = 0;
     path_options.clear();
     std::vector<Eigen::VectorXd> single_layer_nodes;
     Eigen::VectorXd node;
@@ -296,7 +285,6 @@ bool CartTrajPlanner::cartesian_path_planner_delta_p(Vectorq7x1 q_start, Eigen::
     single_layer_nodes.push_back(node);
     path_options.push_back(single_layer_nodes);
 
-    std::vector<Vectorq7x1> q_solns;
     p_des = p_start;
 
     for (int istep = 1; istep < nsteps; istep++) {
@@ -304,17 +292,9 @@ bool CartTrajPlanner::cartesian_path_planner_delta_p(Vectorq7x1 q_start, Eigen::
         a_flange_des.translation() = p_des;
         cartesian_affine_samples_.push_back(a_flange_des);
         cout << "trying: " << p_des.transpose() << endl;
-        nsolns = baxter_IK_solver_.ik_solve_approx_wrt_torso(a_flange_des, q_solns);
+        nsolns = solve_ik_layer(a_flange_des, path_options, single_layer_nodes);
         std::cout << "nsolns = " << nsolns << endl;
-        single_layer_nodes.clear();
         if (nsolns > 0) {
-            single_layer_nodes.resize(nsolns);
-            for (int isoln = 0; isoln < nsolns; isoln++) {
-                // this is annoying: can't treat std::vector<Vectorq7x1> same as std::vector<Eigen::VectorXd> 
-                node = q_solns[isoln];
-                single_layer_nodes[isoln] = node;
-            }
-
             path_options.push_back(single_layer_nodes);
         } else {
             return false;
@@ -350,6 +330,122 @@ bool CartTrajPlanner::cartesian_path_planner_delta_p(Vectorq7x1 q_start, Eigen::
     return true;
 }
 
+//IK solns for the next Cartesian sample: with continuation, the solns of the previous layer are tracked to a_flange_des;
+// a full sweep of IK solns is needed only for the first layer of a path, or if all tracked branches are lost
+int CartTrajPlanner::solve_ik_layer(Eigen::Affine3d a_flange_des, std::vector<std::vector<Eigen::VectorXd> > &path_options,
+        std::vector<Eigen::VectorXd> &layer) {
+    std::vector<Eigen::VectorXd> no_prev_layer;
+    if (path_options.empty()) {
+        return sweep_ik_layer(a_flange_des, no_prev_layer, layer);
+    }
+    if (use_ik_continuation_ && track_ik_layer(a_flange_des, path_options.back(), layer) > 0) {
+        return layer.size();
+    }
+    return sweep_ik_layer(a_flange_des, path_options.back(), layer);
+}
+
+//Newton iterations on the full 7-dof flange pose, starting from q_prev; each step is the least-cost joint motion
+// (weighted by the jspace planner weights) that corrects the pose error, so redundancy (the elbow orbit) is resolved
+// the way the jspace planner would prefer.  Jacobian is by finite differences of fwd kin.
+// returns true if converged to within W_ERR_TOL (position) and CONTINUATION_ROT_TOL (orientation)
+bool CartTrajPlanner::jacobian_ik_step(Eigen::Affine3d a_flange_des, Vectorq7x1 q_prev, Vectorq7x1 &q_next) {
+    const double dq_fd = 1.0e-6;
+    Eigen::Matrix<double, 6, 7> J;
+    Eigen::Matrix<double, 6, 1> pose_err;
+    Eigen::Matrix<double, 7, 1> w_inv;
+    Eigen::Matrix<double, 6, 6> JWJt;
+    Eigen::Affine3d a_flange, a_flange_pert;
+    for (int j = 0; j < 7; j++) w_inv[j] = 1.0 / jspace_planner_weights_[j];
+    q_next = q_prev;
+    for (int iter = 0; iter <= MAX_JINV_ITERS; iter++) {
+        a_flange = baxter_fwd_solver_.fwd_kin_flange_wrt_torso_solve(q_next);
+        Eigen::AngleAxisd rot_err(a_flange_des.linear() * a_flange.linear().transpose());
+        pose_err.head<3>() = a_flange_des.translation() - a_flange.translation();
+        pose_err.tail<3>() = rot_err.angle() * rot_err.axis();
+        if (pose_err.head<3>().norm() < W_ERR_TOL && rot_err.angle() < CONTINUATION_ROT_TOL) return true;
+        if (iter == MAX_JINV_ITERS) break;
+        for (int j = 0; j < 7; j++) {
+            Vectorq7x1 q_pert = q_next;
+            q_pert[j] += dq_fd;
+            a_flange_pert = baxter_fwd_solver_.fwd_kin_flange_wrt_torso_solve(q_pert);
+            Eigen::AngleAxisd drot(a_flange_pert.linear() * a_flange.linear().transpose());
+            J.block<3, 1>(0, j) = (a_flange_pert.translation() - a_flange.translation()) / dq_fd;
+            J.block<3, 1>(3, j) = drot.angle() * drot.axis() / dq_fd;
+        }
+        //weighted, slightly damped pseudo-inverse: dq = W^-1 J^T (J W^-1 J^T)^-1 pose_err
+        JWJt = J * w_inv.asDiagonal() * J.transpose();
+        JWJt.diagonal().array() += 1.0e-9;
+        q_next += w_inv.asDiagonal() * J.transpose() * JWJt.ldlt().solve(pose_err);
+    }
+    return false;
+}
+
+//track each soln of prev_layer to a_flange_des w/ Jacobian steps; a tracked soln is kept only if it converged within
+// joint limits and stayed within CONTINUATION_MAX_DQ of the soln it came from, so a branch cannot jump to another
+int CartTrajPlanner::track_ik_layer(Eigen::Affine3d a_flange_des, std::vector<Eigen::VectorXd> &prev_layer, std::vector<Eigen::VectorXd> &layer) {
+    Vectorq7x1 q_prev, q_next;
+    Eigen::VectorXd node;
+    layer.clear();
+    for (int i = 0; i < prev_layer.size(); i++) {
+        q_prev = prev_layer[i];
+        if (!jacobian_ik_step(a_flange_des, q_prev, q_next)) continue;
+        bool feasible = true;
+        for (int j = 0; j < 7; j++) {
+            if (q_next[j] < q_lower_limits[j] || q_next[j] > q_upper_limits[j]) feasible = false;
+        }
+        if (!feasible) continue;
+        if ((q_next - q_prev).cwiseAbs().maxCoeff() > CONTINUATION_MAX_DQ) continue;
+        //branches may converge; keep only one of each
+        node = q_next;
+        bool duplicate = false;
+        for (int k = 0; k < layer.size(); k++) {
+            if ((layer[k] - node).norm() < 0.001) duplicate = true;
+        }
+        if (!duplicate) layer.push_back(node);
+    }
+    return layer.size();
+}
+
+//full sweep of IK solns over the elbow orbit; with continuation, only MAX_CONTINUATION_BRANCHES of these are kept:
+// those closest to prev_layer (by the jspace planner's cost), or, for the first layer, solns spread over the sweep
+int CartTrajPlanner::sweep_ik_layer(Eigen::Affine3d a_flange_des, std::vector<Eigen::VectorXd> &prev_layer, std::vector<Eigen::VectorXd> &layer) {
+    std::vector<Vectorq7x1> q_solns;
+    Eigen::VectorXd node, dq;
+    int nsolns = baxter_IK_solver_.ik_solve_approx_wrt_torso(a_flange_des, q_solns);
+    n_ik_sweeps_++;
+    layer.clear();
+    if (!use_ik_continuation_ || nsolns <= MAX_CONTINUATION_BRANCHES) {
+        for (int isoln = 0; isoln < nsolns; isoln++) {
+            node = q_solns[isoln];
+            layer.push_back(node);
+        }
+        return nsolns;
+    }
+    if (prev_layer.empty()) { //solns are ordered by q_s0; take evenly spaced samples
+        for (int i = 0; i < MAX_CONTINUATION_BRANCHES; i++) {
+            node = q_solns[(i * nsolns) / MAX_CONTINUATION_BRANCHES];
+            layer.push_back(node);
+        }
+        return layer.size();
+    }
+    std::vector<std::pair<double, int> > costs(nsolns);
+    for (int isoln = 0; isoln < nsolns; isoln++) {
+        node = q_solns[isoln];
+        double cost_min = 1.0e20;
+        for (int k = 0; k < prev_layer.size(); k++) {
+            dq = node - prev_layer[k];
+            cost_min = std::min(cost_min, jspace_planner_weights_.dot(dq.cwiseProduct(dq)));
+        }
+        costs[isoln] = std::make_pair(cost_min, isoln);
+    }
+    std::partial_sort(costs.begin(), costs.begin() + MAX_CONTINUATION_BRANCHES, costs.end());
+    for (int i = 0; i < MAX_CONTINUATION_BRANCHES; i++) {
+        node = q_solns[costs[i].second];
+        layer.push_back(node);
+    }
+    return layer.size();
+}
+
 //given an approximate motion plan in joint space, and given the corresponding Cartesian affine samples in cartesian_affine_samples_,
 // use Jacobian iterations to improve the joint-space solution accuracy for each point;
 // update optimal_path with these revised joint-space solutions
@@ -0,0 +1,69 @@
+// task_graph.h header file //
+// runs a set of steps, e.g. action-server goals, each as soon as the steps it depends on have
+// succeeded, so that independent steps (e.g. perception and an arm motion) run concurrently.
+// A step is started by calling its start function, which must eventually call the done function
+// it is given (e.g. from an action client's done callback), with true for success.
+// run() sleeps on a condition variable between completions: nothing is polled, but for the
+// optional cancel check.  Records start time and duration of each step, for report().
+// No ROS dependencies; see task_graph.cpp
+
+#ifndef TASK_GRAPH_H_
+#define TASK_GRAPH_H_
+
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+typedef boost::function<void(bool)> TaskDoneFn;
+typedef boost::function<void(const TaskDoneFn&)> TaskStartFn;
+
+class TaskGraph {
+public:
+    enum TaskStatus { WAITING, RUNNING, SUCCEEDED, FAILED, SKIPPED, CANCELED };
+
+    TaskGraph();
+    //forget all steps; completions of steps from before clear() are ignored
+    void clear();
+    //returns the id of the new step: 0, 1, 2...
+    int add_task(const std::string &name, const TaskStartFn &start);
+    //task will not start until prerequisite has succeeded
+    void add_dependency(int task, int prerequisite);
+
+    //start steps as they become ready, and wait for them.  Returns true if all succeed.
+    //If a step fails, no more steps are started; those in progress are waited for, and the rest
+    // are skipped.  If should_cancel (checked every check_period sec) returns true, returns at
+    // once; steps in progress are marked canceled, and their completions are ignored.
+    //start functions are called from the thread that calls run(), w/o any lock held
+    bool run(const boost::function<bool()> &should_cancel = boost::function<bool()>(),
+            double check_period = 0.1);
+
+    int n_tasks() const { return tasks_.size(); }
+    int failed_task() const { return failed_task_; } // -1 if none
+    TaskStatus status(int task) const { return tasks_[task].status; }
+    //per-step table of start time (w/rt start of run()), duration and status
+    std::string report() const;
+
+private:
+    struct Task {
+        std::string name;
+        TaskStartFn start;
+        std::vector<int> prerequisites;
+        TaskStatus status;
+        double t_start, t_end; // sec, w/rt start of run()
+    };
+
+    void task_done(unsigned generation, int task, bool succeeded);
+    double elapsed() const;
+
+    std::vector<Task> tasks_;
+    int failed_task_;
+    unsigned generation_; // bumped by clear(), to recognize stale completions
+    boost::posix_time::ptime run_start_;
+    boost::mutex mutex_;
+    boost::condition_variable task_done_cond_;
+};
+
+#endif
@@ -1,5 +1,8 @@
 // command_bundler: handles vision, manipulation and navigation commands piecewise 
 // wsn, Oct, 2016
+// each goal is run as a TaskGraph of steps; steps are goals to the object_finder and
+// object_grabber action servers, and complete in their done callbacks.  MANIP_OBJECT bundles
+// perception, grab and dropoff, w/ perception concurrent w/ the move to the pre-pose
 
   
 #include<ros/ros.h>
@@ -23,6 +26,8 @@
 //#include <object_manipulation_properties/object_manipulation_properties.h>
 #include <object_manipulation_properties/object_ID_codes.h>
 #include<generic_gripper_services/genericGripperInterface.h>
+#include <coordinator/task_graph.h>
+#include <boost/thread/mutex.hpp>
 
 class TaskActionServer {
 private:
@@ -40,25 +45,45 @@ private:
 
     object_finder::objectFinderGoal object_finder_goal_;
     object_grabber::object_grabberGoal object_grabber_goal_;
+    //done callbacks: record the result, then report success or failure of the step to the task graph.
+    // they run on the action clients' threads; a callback from a goal that has since ended (e.g. was
+    // cancelled) is ignored, so it cannot overwrite the results of the next goal
     void objectGrabberDoneCb_(const actionlib::SimpleClientGoalState& state,
-            const object_grabber::object_grabberResultConstPtr& result);
+            const object_grabber::object_grabberResultConstPtr& result, unsigned generation, int success_code,
+            TaskDoneFn done);
     void objectFinderDoneCb_(const actionlib::SimpleClientGoalState& state,
-            const object_finder::objectFinderResultConstPtr& result);
-    int object_grabber_return_code_; //feedback status from object grabber
-    int found_object_code_; //feedback status from object finder
+            const object_finder::objectFinderResultConstPtr& result, unsigned generation, bool is_table_surface,
+            TaskDoneFn done);
+    boost::mutex result_mutex_; // guards the members written by the done callbacks
+    unsigned goal_generation_; // bumped at the end of each goal
 
     //the following items are elements of the goal message
     geometry_msgs::PoseStamped pickup_pose_;
     geometry_msgs::PoseStamped dropoff_pose_;
-    int goal_action_code_, object_code_, perception_source_;
-    int vision_object_code_; //SHOULD be reconciled with ManipTask object codes
+    geometry_msgs::PoseStamped gripper_goal_pose_;
+    int object_code_, perception_source_;
     double surface_height_; // table-top height, as found by object_finder
     bool found_surface_height_;
 
-    //the following are used for logic in executeCB
-    bool working_on_task_; //true as long as goal is still in progress
-    int status_code_; //values to be published as feedback during action service
-    int action_code_, pickup_action_code_, dropoff_action_code_;
+    //steps of a goal; each sends a goal to object_finder or object_grabber, or (blind pickup pose)
+    // completes at once
+    TaskGraph task_graph_;
+    enum StepServer { FINDER, GRABBER };
+    std::vector<int> step_failure_codes_; // ManipTaskResult code to return if the step fails, by step
+    std::vector<StepServer> step_servers_; // action server each step sends its goal to, by step
+    bool overlap_perception_; // let perception run while the arm moves to its pre-pose
+    int addStep(const std::string &name, void (TaskActionServer::*start)(const TaskDoneFn&), int failure_code,
+            StepServer server);
+    void cancelRunningSteps();
+    void publishStatus(int status_code);
+    void startFindTableSurface(const TaskDoneFn &done);
+    void startGetPickupPose(const TaskDoneFn &done);
+    void startGrabObject(const TaskDoneFn &done);
+    void startStraddleObject(const TaskDoneFn &done);
+    void startCartMove(const TaskDoneFn &done);
+    void startDropoffObject(const TaskDoneFn &done);
+    void startMoveToPrePose(const TaskDoneFn &done);
+    void sendGrabberGoal(int success_code, const TaskDoneFn &done);
     ros::Publisher pose_publisher_;
 
 public:
@@ -78,10 +103,6 @@ object_grabber_ac_("object_grabber_action_service", true) {
     // do any other desired initializations here...specific to your implementation
     as_.start(); //start the server running
 
-    action_code_ = coordinator::ManipTaskGoal::NO_CURRENT_TASK;
-    status_code_ = coordinator::ManipTaskFeedback::NO_CURRENT_TASK;
-    working_on_task_ = false;
-
     //connect to the object_grabber server
     ROS_INFO("waiting for object-grabber action server: ");
     bool server_exists = false;
@@ -106,13 +127,24 @@ object_grabber_ac_("object_grabber_action_service", true) {
 
     pose_publisher_ = nh_.advertise<geometry_msgs::PoseStamped>("triad_display_pose", 1, true);
     found_surface_height_ = false;
+    goal_generation_ = 0;
+    //if the arm may block the camera's view on its way to the pre-pose, set this false
+    ros::NodeHandle nh_private("~");
+    nh_private.param("overlap_perception", overlap_perception_, true);
 }
 
 void TaskActionServer::objectFinderDoneCb_(const actionlib::SimpleClientGoalState& state,
-        const object_finder::objectFinderResultConstPtr& result) {
+        const object_finder::objectFinderResultConstPtr& result, unsigned generation, bool is_table_surface,
+        TaskDoneFn done) {
     ROS_INFO(" objectFinderDoneCb: server responded with state [%s]", state.toString().c_str());
-    //found_object_code_ = result->found_object_code;
+    boost::mutex::scoped_lock lock(result_mutex_);
+    if (generation != goal_generation_) {
+        ROS_WARN("ignoring result of a cancelled step");
+        return;
+    }
     ROS_INFO("got object code response = %d; ", result->found_object_code);
+    // pass this code back to the client
+    result_.object_finder_return_code = result->found_object_code;
     if (result->found_object_code == object_finder::objectFinderResult::OBJECT_CODE_NOT_RECOGNIZED) {
         ROS_WARN("object code not recognized");
     } else if (result->found_object_code == object_finder::objectFinderResult::OBJECT_FOUND) {
@@ -123,374 +155,268 @@ void TaskActionServer::objectFinderDoneCb_(const actionlib::SimpleClientGoalStat
                 pickup_pose_.pose.position.y,
                 pickup_pose_.pose.position.z);
         pose_publisher_.publish(pickup_pose_);
+        if (is_table_surface) {
+            surface_height_ = pickup_pose_.pose.position.z; // table-top height, as found by object_finder
+            found_surface_height_ = true;
+            ROS_INFO("found table ht = %f", surface_height_);
+        }
     } else {
         ROS_WARN("object not found!");
     }
-    //put this last--possible race condition with main!
-    // pass this code back to the client
-    result_.object_finder_return_code = found_object_code_;
-    found_object_code_ = result->found_object_code;
+    if (is_table_surface && result->found_object_code != object_finder::objectFinderResult::OBJECT_FOUND) {
+        found_surface_height_ = false;
+    }
+    done(result->found_object_code == object_finder::objectFinderResult::OBJECT_FOUND);
 }
 
 void TaskActionServer::objectGrabberDoneCb_(const actionlib::SimpleClientGoalState& state,
-        const object_grabber::object_grabberResultConstPtr& result) {
+        const object_grabber::object_grabberResultConstPtr& result, unsigned generation, int success_code,
+        TaskDoneFn done) {
     ROS_INFO(" objectGrabberDoneCb: server responded with state [%s]", state.toString().c_str());
-        
-    ROS_INFO("got result output = %d; ", result->return_code);
+    boost::mutex::scoped_lock lock(result_mutex_);
+    if (generation != goal_generation_) {
+        ROS_WARN("ignoring result of a cancelled step");
+        return;
+    }
 
-    //result_.des_flange_pose_stamped_wrt_torso = result->des_flange_pose_stamped_wrt_torso;
-    
+    ROS_INFO("got result output = %d; ", result->return_code);
+    if (result->return_code == object_grabber::object_grabberResult::FAILED_CANNOT_REACH) {
+        ROS_WARN("unreachable");
+    }
     //pass return code back to the client    
-    result_.object_grabber_return_code = object_grabber_return_code_;
-    object_grabber_return_code_ = result->return_code; //put this last, to avoid race condition
+    result_.object_grabber_return_code = result->return_code;
+    done(result->return_code == success_code);
 }
 
+int TaskActionServer::addStep(const std::string &name, void (TaskActionServer::*start)(const TaskDoneFn&),
+        int failure_code, StepServer server) {
+    step_failure_codes_.push_back(failure_code);
+    step_servers_.push_back(server);
+    return task_graph_.add_task(name, boost::bind(start, this, _1));
+}
 
-void TaskActionServer::executeCB(const actionlib::SimpleActionServer<coordinator::ManipTaskAction>::GoalConstPtr& goal) {
-    ROS_INFO("in executeCB: received manipulation task");
-
-    goal_action_code_ = goal->action_code; //verbatim from received goal
-    action_code_ = goal->action_code; //init: this value changes as state machine advances through steps
-    ROS_INFO("requested action code is: %d", goal_action_code_);
- 
-    if (goal_action_code_ == coordinator::ManipTaskGoal::DROPOFF_OBJECT) {
-        object_code_ = goal->object_code; //what type of object is this?   
-    } else if (goal_action_code_ == coordinator::ManipTaskGoal::GRAB_OBJECT) {
-        object_code_ = goal->object_code; //what type of object is this?     
-        ROS_INFO("object code is: %d", object_code_);
- 
-        if (goal->perception_source == coordinator::ManipTaskGoal::BLIND_MANIP) {
-            ROS_INFO("blind manipulation; using provided pick-up pose");
-            pickup_pose_ = goal->pickup_frame;
+//after run() is cancelled: steps still in progress have a goal active on their action server
+void TaskActionServer::cancelRunningSteps() {
+    bool cancel_finder = false, cancel_grabber = false;
+    for (int i = 0; i < task_graph_.n_tasks(); i++) {
+        if (task_graph_.status(i) == TaskGraph::CANCELED) {
+            if (step_servers_[i] == FINDER) cancel_finder = true;
+            else cancel_grabber = true;
         }
     }
-       else if (goal_action_code_ == coordinator::ManipTaskGoal::STRADDLE_OBJECT) {
-        object_code_ = goal->object_code; //what type of object is this?     
-        ROS_INFO("object code is: %d", object_code_);
-        pickup_pose_ = goal->pickup_frame;       
-    } else if (goal_action_code_ == coordinator::ManipTaskGoal::GET_PICKUP_POSE) {
-        ROS_INFO("object code is: %d", object_code_);
-        ROS_INFO("perception_source is: %d", goal->perception_source);
-        object_code_ = goal->object_code; //what type of object is this?
-        perception_source_ = goal->perception_source; //name sensor or provide coords
-        vision_object_code_ = object_code_; //same code
-    }
+    if (cancel_finder) object_finder_ac_.cancelGoal();
+    if (cancel_grabber) object_grabber_ac_.cancelGoal();
+}
 
-    status_code_ = coordinator::ManipTaskFeedback::RECEIVED_NEW_TASK; //coordinator::ManipTaskFeedback::RECEIVED_NEW_TASK;
-    working_on_task_ = true;
-    //do work here
-    while (working_on_task_) { //coordinator::ManipTaskResult::MANIP_SUCCESS) {
-        feedback_.feedback_status = status_code_;
-        as_.publishFeedback(feedback_);
-        //ROS_INFO("executeCB: status_code = %d", status_code_);
-        // each iteration, check if cancellation has been ordered
-
-        if (as_.isPreemptRequested()) {
-            ROS_WARN("goal cancelled!");
-            result_.manip_return_code = coordinator::ManipTaskResult::ABORTED;
-            action_code_ = coordinator::ManipTaskGoal::NO_CURRENT_TASK;
-            status_code_ = coordinator::ManipTaskFeedback::ABORTED;
-            working_on_task_ = false;
-            as_.setAborted(result_); // tell the client we have given up on this goal; send the result message as well
-            return; // done with callback
+void TaskActionServer::publishStatus(int status_code) {
+    feedback_.feedback_status = status_code;
+    as_.publishFeedback(feedback_);
+}
+
+void TaskActionServer::startFindTableSurface(const TaskDoneFn &done) {
+    ROS_INFO("serving request to find table surface");
+    publishStatus(coordinator::ManipTaskFeedback::PERCEPTION_BUSY);
+    object_finder_goal_.object_id = ObjectIdCodes::TABLE_SURFACE;
+    object_finder_goal_.known_surface_ht = false; //require find table height
+    object_finder_ac_.sendGoal(object_finder_goal_,
+            boost::bind(&TaskActionServer::objectFinderDoneCb_, this, _1, _2, goal_generation_, true, done));
+}
+
+void TaskActionServer::startGetPickupPose(const TaskDoneFn &done) {
+    ROS_INFO("establishing pick-up pose");
+    publishStatus(coordinator::ManipTaskFeedback::PERCEPTION_BUSY);
+    if (perception_source_ == coordinator::ManipTaskGoal::BLIND_MANIP) {
+        ROS_INFO("blind manipulation; using provided pick-up pose");
+        result_.object_pose = pickup_pose_;
+        done(true);
+    } else if (perception_source_ == coordinator::ManipTaskGoal::PCL_VISION) {
+        ROS_INFO("instructing finder to locate object %d", object_code_);
+        object_finder_goal_.object_id = object_code_;
+        if (found_surface_height_) {
+            object_finder_goal_.known_surface_ht = true;
+            object_finder_goal_.surface_ht = surface_height_;
+            ROS_INFO("using surface ht = %f", surface_height_);
+        } else {
+            object_finder_goal_.known_surface_ht = false; //require find table height
         }
-        //here is where we step through states:
-        switch (action_code_) {
-            case coordinator::ManipTaskGoal::FIND_TABLE_SURFACE:
-                ROS_INFO("serving request to find table surface");
-                found_object_code_ = object_finder::objectFinderResult::OBJECT_FINDER_BUSY;
-                object_finder_goal_.object_id = ObjectIdCodes::TABLE_SURFACE;
-                //vision_object_code_;
-                object_finder_goal_.known_surface_ht = false; //require find table height
-                //object_finder_goal_.surface_ht = 0.05; //this is ignored for known_surface_ht=false
-                object_finder_ac_.sendGoal(object_finder_goal_,
-                        boost::bind(&TaskActionServer::objectFinderDoneCb_, this, _1, _2));
-                action_code_ = coordinator::ManipTaskGoal::WAIT_FIND_TABLE_SURFACE;
-                ROS_INFO("executeCB: action_code, status_code = %d, %d", action_code_, status_code_);
-                ROS_INFO("waiting on perception");
-                break;
-            case coordinator::ManipTaskGoal::WAIT_FIND_TABLE_SURFACE:
-                if (found_object_code_ == object_finder::objectFinderResult::OBJECT_FOUND) {
-                    ROS_INFO("surface-finder success");
-                    surface_height_ = pickup_pose_.pose.position.z; // table-top height, as found by object_finder
-                    found_surface_height_ = true;
-                    ROS_INFO("found table ht = %f", surface_height_);
-                    as_.setSucceeded(result_); // return the "result" message to client, along with "success" status
-                    return; //done w/ callback
-                } else if (found_object_code_ == object_finder::objectFinderResult::OBJECT_FINDER_BUSY) {
-                    //ROS_INFO("waiting on perception"); //do nothing
-                } else {
-                    ROS_WARN("object-finder failure; aborting");
-                    action_code_ = coordinator::ManipTaskGoal::ABORT;
-                    result_.manip_return_code = coordinator::ManipTaskResult::FAILED_PERCEPTION;
-                    found_surface_height_ = false;
-                }
-
-                break;
-
-            case coordinator::ManipTaskGoal::GET_PICKUP_POSE:
-                ROS_INFO("establishing pick-up pose");
-                if (perception_source_ == coordinator::ManipTaskGoal::BLIND_MANIP) {
-                    ROS_INFO("blind manipulation; using provided pick-up pose");
-                    pickup_pose_ = goal->pickup_frame;
-                    result_.object_pose = pickup_pose_;
-                    //done with perception, but do fake waiting anyway
-                    //declare victor on finding object
-                    found_object_code_ = object_finder::objectFinderResult::OBJECT_FOUND;
-                    action_code_ = coordinator::ManipTaskGoal::WAIT_FOR_FINDER;
-                    status_code_ = coordinator::ManipTaskFeedback::PERCEPTION_BUSY;
-                } else if (perception_source_ == coordinator::ManipTaskGoal::PCL_VISION) {
-                    ROS_INFO("invoking object finder");
-                    found_object_code_ = object_finder::objectFinderResult::OBJECT_FINDER_BUSY;
-                    ROS_INFO("instructing finder to locate object %d", vision_object_code_);
-                    object_finder_goal_.object_id = vision_object_code_;
-                    if (found_surface_height_) {
-                        object_finder_goal_.known_surface_ht = true;
-                        object_finder_goal_.surface_ht = surface_height_;
-                        ROS_INFO("using surface ht = %f", surface_height_);
-                    } else {
-                        object_finder_goal_.known_surface_ht = false; //require find table height
-                        //object_finder_goal_.surface_ht = 0.05; //not needed
-                    }
-
-                    ROS_INFO("sending object-finder goal: ");
-
-                    object_finder_ac_.sendGoal(object_finder_goal_,
-                            boost::bind(&TaskActionServer::objectFinderDoneCb_, this, _1, _2));
-
-                    action_code_ = coordinator::ManipTaskGoal::WAIT_FOR_FINDER;
-                    ROS_INFO("waiting on perception");
-                } else {
-                    ROS_WARN("unrecognized perception mode; quitting");
-                    action_code_ = coordinator::ManipTaskGoal::ABORT;
-                    result_.manip_return_code = coordinator::ManipTaskResult::FAILED_PERCEPTION;
-                }
-
-                ROS_INFO("executeCB: action_code, status_code = %d, %d", action_code_, status_code_);
-                break;
-
-            case coordinator::ManipTaskGoal::WAIT_FOR_FINDER:
-                if (found_object_code_ == object_finder::objectFinderResult::OBJECT_FOUND) {
-                    ROS_INFO("object-finder success");
-                    //next step: use the pose to grab object:
-                    /* if (goal_action_code_ == coordinator::ManipTaskGoal::MANIP_OBJECT) {
-                        action_code_ = coordinator::ManipTaskGoal::GRAB_OBJECT;
-                        status_code_ = coordinator::ManipTaskFeedback::DROPOFF_PLANNING_BUSY;
-                    } else*/ {
-                        working_on_task_ = false; // test--set to goal achieved
-                        action_code_ = coordinator::ManipTaskGoal::NO_CURRENT_TASK;
-                        status_code_ = coordinator::ManipTaskFeedback::COMPLETED_MOVE;
-                        result_.manip_return_code = coordinator::ManipTaskResult::MANIP_SUCCESS;
-                        //object pose is in result message
-                        as_.setSucceeded(result_); // return the "result" message to client, along with "success" status
-                        return; //done w/ callback
-                    }
-                    //will later test for result code of object grabber, so initialize it to PENDING
-                    //(next step in state machine)
-                    object_grabber_return_code_ = object_grabber::object_grabberResult::PENDING;
-                } else if (found_object_code_ == object_finder::objectFinderResult::OBJECT_FINDER_BUSY) {
-                    //ROS_INFO("waiting on perception"); //continue waiting
-                } else {
-                    ROS_WARN("object-finder failure; aborting");
-                    action_code_ = coordinator::ManipTaskGoal::ABORT;
-                    result_.manip_return_code = coordinator::ManipTaskResult::FAILED_PERCEPTION;
-                }
-                break;
-
-            case coordinator::ManipTaskGoal::GRAB_OBJECT:
-                status_code_ = coordinator::ManipTaskFeedback::PICKUP_MOTION_BUSY;
-                ROS_INFO("executeCB: action_code, status_code = %d, %d", action_code_, status_code_);
-                //ros::Duration(2.0).sleep();
-                //if here, then presumably have a valid pose for object of interest; grab it! 
-                //send object-grabber action code to grab specified object
-                object_grabber_goal_.action_code = object_grabber::object_grabberGoal::GRAB_OBJECT;//pickup_action_code_; //specify the object to be grabbed 
-                object_grabber_goal_.object_frame = pickup_pose_; //and the object's current pose
-                object_grabber_goal_.object_id = object_code_; // = goal->object_code;
-                object_grabber_goal_.grasp_option = object_grabber::object_grabberGoal::DEFAULT_GRASP_STRATEGY; //from above
-                
-                ROS_INFO("sending goal to grab object: ");
-                object_grabber_ac_.sendGoal(object_grabber_goal_,
-                        boost::bind(&TaskActionServer::objectGrabberDoneCb_, this, _1, _2));
-
-                action_code_ = coordinator::ManipTaskGoal::WAIT_FOR_GRAB_OBJECT;
-                status_code_ = coordinator::ManipTaskFeedback::PICKUP_MOTION_BUSY;
-                //will inspect this status to see if object grasp is eventually successful
-                object_grabber_return_code_ = object_grabber::object_grabberResult::OBJECT_GRABBER_BUSY;
-
-                break;
-
-            case coordinator::ManipTaskGoal::WAIT_FOR_GRAB_OBJECT:
-                if (object_grabber_return_code_ == object_grabber::object_grabberResult::OBJECT_ACQUIRED) { //success!
-                    ROS_INFO("acquired object");
-
-
-                    /*if (goal_action_code_ == coordinator::ManipTaskGoal::MANIP_OBJECT) {
-                        //for manip command, have more steps to complete:
-                        action_code_ = coordinator::ManipTaskGoal::DROPOFF_OBJECT;
-                        status_code_ = coordinator::ManipTaskFeedback::PICKUP_SUCCESSFUL;
-                    } else*/ { //if just a grab command, we are now done
-                        working_on_task_ = false; // test--set to goal achieved
-                        action_code_ = coordinator::ManipTaskGoal::NO_CURRENT_TASK;
-                        status_code_ = coordinator::ManipTaskFeedback::COMPLETED_MOVE;
-                        result_.manip_return_code = coordinator::ManipTaskResult::MANIP_SUCCESS;
-                        //object pose is in result message
-                        as_.setSucceeded(result_); // return the "result" message to client, along with "success" status
-                        return; //done w/ callback
-                    }
-
-
-                } else if (object_grabber_return_code_ == object_grabber::object_grabberResult::OBJECT_GRABBER_BUSY) {
-                    // do nothing--just wait patiently
-                    //ROS_INFO("waiting for object grab");
-                } else {
-                    ROS_WARN("trouble with acquiring object");
-                    action_code_ = coordinator::ManipTaskGoal::ABORT;
-                    result_.manip_return_code = coordinator::ManipTaskResult::FAILED_PICKUP;
-                }
-                break;
-
-            case coordinator::ManipTaskGoal::CART_MOVE_TO_GRIPPER_POSE:
-                status_code_ = coordinator::ManipTaskFeedback::MOVE_BUSY;
-                ROS_INFO("executeCB: action_code, status_code = %d, %d", action_code_, status_code_);
-                object_grabber_goal_.action_code = object_grabber::object_grabberGoal::CART_MOVE_CURRENT_TO_CART_GOAL;//code for cart move
-                object_grabber_goal_.object_frame = goal->gripper_goal_frame; //get the move destination
-                //object_grabber_goal_.object_id = object_code_; // = goal->object_code;
-                //object_grabber_goal_.grasp_option = object_grabber::object_grabberGoal::DEFAULT_GRASP_STRATEGY; //from above
-                
-                ROS_INFO("sending goal to move gripper along Cartesian path to specified destination: ");
-                object_grabber_ac_.sendGoal(object_grabber_goal_,
-                        boost::bind(&TaskActionServer::objectGrabberDoneCb_, this, _1, _2));
-
-                action_code_ = coordinator::ManipTaskGoal::WAIT_FOR_MOVE;
-                status_code_ = coordinator::ManipTaskFeedback::MOVE_BUSY;
-                //will inspect this status to see if object grasp is eventually successful
-                object_grabber_return_code_ = object_grabber::object_grabberResult::OBJECT_GRABBER_BUSY;
-
-                break;
-
-             case coordinator::ManipTaskGoal::STRADDLE_OBJECT:
-                status_code_ = coordinator::ManipTaskFeedback::MOVE_BUSY;
-                ROS_INFO("executeCB: action_code, status_code = %d, %d", action_code_, status_code_);
-                //ros::Duration(2.0).sleep();
-                //if here, then presumably have a valid pose for object of interest; grab it! 
-                //send object-grabber action code to grab specified object
-                object_grabber_goal_.action_code = object_grabber::object_grabberGoal::STRADDLE_OBJECT;//pickup_action_code_; //specify the object to be grabbed 
-                object_grabber_goal_.object_frame = pickup_pose_; //and the object's current pose
-                object_grabber_goal_.object_id = object_code_; // = goal->object_code;
-                object_grabber_goal_.grasp_option = object_grabber::object_grabberGoal::DEFAULT_GRASP_STRATEGY; //from above
-                
-                ROS_INFO("sending goal to straddle object: ");
-                object_grabber_ac_.sendGoal(object_grabber_goal_,
-                        boost::bind(&TaskActionServer::objectGrabberDoneCb_, this, _1, _2));
-
-                action_code_ = coordinator::ManipTaskGoal::WAIT_FOR_MOVE;
-                status_code_ = coordinator::ManipTaskFeedback::MOVE_BUSY;
-                //will inspect this status to see if object grasp is eventually successful
-                object_grabber_return_code_ = object_grabber::object_grabberResult::OBJECT_GRABBER_BUSY;
-
-                break;
-                
-            case coordinator::ManipTaskGoal::DROPOFF_OBJECT:
-                status_code_ = coordinator::ManipTaskFeedback::DROPOFF_MOTION_BUSY; //coordinator::ManipTaskResult::MANIP_SUCCESS; //code 0
-                ROS_INFO("executeCB: action_code, status_code = %d, %d", action_code_, status_code_);
-                object_grabber_goal_.action_code = object_grabber::object_grabberGoal::DROPOFF_OBJECT;//dropoff_action_code_; //specify the object to be grabbed 
-                object_grabber_goal_.object_id = object_code_; // = goal->object_code;
-                dropoff_pose_= goal->dropoff_frame;
-                object_grabber_goal_.object_frame = dropoff_pose_; //and the object's current pose
-                object_grabber_goal_.grasp_option = object_grabber::object_grabberGoal::DEFAULT_GRASP_STRATEGY; //from above
-
-                        
-                ROS_INFO("sending goal to drop off object: ");
-                object_grabber_ac_.sendGoal(object_grabber_goal_,
-                        boost::bind(&TaskActionServer::objectGrabberDoneCb_, this, _1, _2));
-
-                action_code_ = coordinator::ManipTaskGoal::WAIT_FOR_DROPOFF_OBJECT;
-                //will inspect this status to see if object grasp is eventually successful
-                object_grabber_return_code_ = object_grabber::object_grabberResult::OBJECT_GRABBER_BUSY;
-
-                break;
-
-
-            case coordinator::ManipTaskGoal::WAIT_FOR_DROPOFF_OBJECT:
-                //ROS_INFO("object_grabber_return_code_ = %d",object_grabber_return_code_);
-                if (object_grabber_return_code_ == object_grabber::object_grabberResult::SUCCESS) { //success!
-                    ROS_INFO("switch/case happiness!  dropped off object; manip complete");
-                    working_on_task_ = false; // test--set to goal achieved
-                    action_code_ = coordinator::ManipTaskGoal::NO_CURRENT_TASK;
-                    status_code_ = coordinator::ManipTaskFeedback::COMPLETED_DROPOFF;
-
-                    result_.manip_return_code = coordinator::ManipTaskResult::MANIP_SUCCESS;
-                    as_.setSucceeded(result_); // return the "result" message to client, along with "success" status
-                    return; //done w/ callback
-                } else if (object_grabber_return_code_ == object_grabber::object_grabberResult::OBJECT_GRABBER_BUSY) {
-                    // do nothing--just wait patiently
-                    //ROS_INFO("waiting for object dropoff");
-                } else {
-                    ROS_WARN("trouble with acquiring object");
-                    action_code_ = coordinator::ManipTaskGoal::ABORT;
-                    result_.manip_return_code = coordinator::ManipTaskResult::FAILED_DROPOFF;
-                }
-                break;
-
-            case coordinator::ManipTaskGoal::MOVE_TO_PRE_POSE:
-                status_code_ = coordinator::ManipTaskFeedback::PREPOSE_MOVE_BUSY;
-                object_grabber_goal_.action_code = object_grabber::object_grabberGoal::MOVE_TO_WAITING_POSE; //specify the object to be grabbed 
-                ROS_INFO("sending goal to move to pre-pose: ");
-                object_grabber_ac_.sendGoal(object_grabber_goal_,
-                        boost::bind(&TaskActionServer::objectGrabberDoneCb_, this, _1, _2));
-
-                action_code_ = coordinator::ManipTaskGoal::WAIT_FOR_MOVE;
-                //will inspect this status to see if object grasp is eventually successful
-                object_grabber_return_code_ = object_grabber::object_grabberResult::OBJECT_GRABBER_BUSY;
-                break;
-            case coordinator::ManipTaskGoal::WAIT_FOR_MOVE:
-                if (object_grabber_return_code_ == object_grabber::object_grabberResult::SUCCESS) { //success!
-                    ROS_INFO("completed move");
-                    working_on_task_ = false; // test--set to goal achieved
-                    action_code_ = coordinator::ManipTaskGoal::NO_CURRENT_TASK;
-                    status_code_ = coordinator::ManipTaskFeedback::COMPLETED_MOVE;
-                    result_.manip_return_code = coordinator::ManipTaskResult::MANIP_SUCCESS;
-                    as_.setSucceeded(result_); // return the "result" message to client, along with "success" status
-                    return; //done w/ callback
-                }
-                else if(object_grabber_return_code_ == object_grabber::object_grabberResult::FAILED_CANNOT_REACH) {
-                    ROS_WARN("unreachable");
-                     working_on_task_ = false; // test--set to goal achieved
-                    action_code_ = coordinator::ManipTaskGoal::NO_CURRENT_TASK;
-                    status_code_ = coordinator::ManipTaskFeedback::COMPLETED_MOVE;
-                    result_.manip_return_code = coordinator::ManipTaskResult::FAILED_MOVE;
-                    as_.setSucceeded(result_); // return the "result" message to client, along with "success" status
-                    return; //done w/ callback            
-                }
-                else {
-                    ROS_INFO("object_grabber_return_code_ = %d",object_grabber_return_code_);
-                    ros::Duration(0.5).sleep();
-                }
-
-                break;
-
-            case coordinator::ManipTaskGoal::ABORT:
-                ROS_WARN("aborting goal...");
-                //retain reason for failure to report back to client
-                //result_.manip_return_code = coordinator::ManipTaskResult::ABORTED;
-                action_code_ = coordinator::ManipTaskGoal::NO_CURRENT_TASK;
-                status_code_ = coordinator::ManipTaskFeedback::ABORTED;
-                working_on_task_ = false;
-                as_.setAborted(result_); // tell the client we have given up on this goal; send the result message as well
-                return; // done with callback
-
-            default:
-                ROS_WARN("executeCB: error--case not recognized");
-                working_on_task_ = false;
-                break;
+        ROS_INFO("sending object-finder goal: ");
+        object_finder_ac_.sendGoal(object_finder_goal_,
+                boost::bind(&TaskActionServer::objectFinderDoneCb_, this, _1, _2, goal_generation_, false, done));
+    } else {
+        ROS_WARN("unrecognized perception mode; quitting");
+        done(false);
+    }
+}
+
+//send object_grabber_goal_; the step succeeds if the grabber returns success_code
+void TaskActionServer::sendGrabberGoal(int success_code, const TaskDoneFn &done) {
+    object_grabber_ac_.sendGoal(object_grabber_goal_,
+            boost::bind(&TaskActionServer::objectGrabberDoneCb_, this, _1, _2, goal_generation_, success_code, done));
+}
+
+void TaskActionServer::startGrabObject(const TaskDoneFn &done) {
+    publishStatus(coordinator::ManipTaskFeedback::PICKUP_MOTION_BUSY);
+    //if here, then presumably have a valid pose for object of interest; grab it! 
+    object_grabber_goal_.action_code = object_grabber::object_grabberGoal::GRAB_OBJECT;
+    object_grabber_goal_.object_frame = pickup_pose_; //and the object's current pose
+    object_grabber_goal_.object_id = object_code_;
+    object_grabber_goal_.grasp_option = object_grabber::object_grabberGoal::DEFAULT_GRASP_STRATEGY;
+    ROS_INFO("sending goal to grab object: ");
+    sendGrabberGoal(object_grabber::object_grabberResult::OBJECT_ACQUIRED, done);
+}
+
+void TaskActionServer::startStraddleObject(const TaskDoneFn &done) {
+    publishStatus(coordinator::ManipTaskFeedback::MOVE_BUSY);
+    object_grabber_goal_.action_code = object_grabber::object_grabberGoal::STRADDLE_OBJECT;
+    object_grabber_goal_.object_frame = pickup_pose_; //and the object's current pose
+    object_grabber_goal_.object_id = object_code_;
+    object_grabber_goal_.grasp_option = object_grabber::object_grabberGoal::DEFAULT_GRASP_STRATEGY;
+    ROS_INFO("sending goal to straddle object: ");
+    sendGrabberGoal(object_grabber::object_grabberResult::SUCCESS, done);
+}
+
+void TaskActionServer::startCartMove(const TaskDoneFn &done) {
+    publishStatus(coordinator::ManipTaskFeedback::MOVE_BUSY);
+    object_grabber_goal_.action_code = object_grabber::object_grabberGoal::CART_MOVE_CURRENT_TO_CART_GOAL;
+    object_grabber_goal_.object_frame = gripper_goal_pose_; //get the move destination
+    ROS_INFO("sending goal to move gripper along Cartesian path to specified destination: ");
+    sendGrabberGoal(object_grabber::object_grabberResult::SUCCESS, done);
+}
+
+void TaskActionServer::startDropoffObject(const TaskDoneFn &done) {
+    publishStatus(coordinator::ManipTaskFeedback::DROPOFF_MOTION_BUSY);
+    object_grabber_goal_.action_code = object_grabber::object_grabberGoal::DROPOFF_OBJECT;
+    object_grabber_goal_.object_id = object_code_;
+    object_grabber_goal_.object_frame = dropoff_pose_;
+    object_grabber_goal_.grasp_option = object_grabber::object_grabberGoal::DEFAULT_GRASP_STRATEGY;
+    ROS_INFO("sending goal to drop off object: ");
+    sendGrabberGoal(object_grabber::object_grabberResult::SUCCESS, done);
+}
+
+void TaskActionServer::startMoveToPrePose(const TaskDoneFn &done) {
+    publishStatus(coordinator::ManipTaskFeedback::PREPOSE_MOVE_BUSY);
+    object_grabber_goal_.action_code = object_grabber::object_grabberGoal::MOVE_TO_WAITING_POSE;
+    ROS_INFO("sending goal to move to pre-pose: ");
+    sendGrabberGoal(object_grabber::object_grabberResult::SUCCESS, done);
+}
+
+void TaskActionServer::executeCB(const actionlib::SimpleActionServer<coordinator::ManipTaskAction>::GoalConstPtr& goal) {
+    ROS_INFO("in executeCB: received manipulation task");
+    int action_code = goal->action_code;
+    ROS_INFO("requested action code is: %d", action_code);
+    object_code_ = goal->object_code; //what type of object is this?
+    perception_source_ = goal->perception_source; //name sensor or provide coords
+    bool uses_pickup_pose = action_code == coordinator::ManipTaskGoal::GET_PICKUP_POSE
+            || action_code == coordinator::ManipTaskGoal::GRAB_OBJECT
+            || action_code == coordinator::ManipTaskGoal::MANIP_OBJECT;
+    if ((uses_pickup_pose && perception_source_ == coordinator::ManipTaskGoal::BLIND_MANIP)
+            || action_code == coordinator::ManipTaskGoal::STRADDLE_OBJECT) {
+        ROS_INFO("using provided pick-up pose");
+        pickup_pose_ = goal->pickup_frame;
+    }
+    dropoff_pose_ = goal->dropoff_frame;
+    gripper_goal_pose_ = goal->gripper_goal_frame;
+    publishStatus(coordinator::ManipTaskFeedback::RECEIVED_NEW_TASK);
+
+    //build the steps for this goal
+    task_graph_.clear();
+    step_failure_codes_.clear();
+    step_servers_.clear();
+    switch (action_code) {
+        case coordinator::ManipTaskGoal::FIND_TABLE_SURFACE:
+            addStep("find_table_surface", &TaskActionServer::startFindTableSurface,
+                    coordinator::ManipTaskResult::FAILED_PERCEPTION, FINDER);
+            break;
+        case coordinator::ManipTaskGoal::GET_PICKUP_POSE:
+            addStep("get_pickup_pose", &TaskActionServer::startGetPickupPose,
+                    coordinator::ManipTaskResult::FAILED_PERCEPTION, FINDER);
+            break;
+        case coordinator::ManipTaskGoal::GRAB_OBJECT:
+            addStep("grab_object", &TaskActionServer::startGrabObject,
+                    coordinator::ManipTaskResult::FAILED_PICKUP, GRABBER);
+            break;
+        case coordinator::ManipTaskGoal::STRADDLE_OBJECT:
+            addStep("straddle_object", &TaskActionServer::startStraddleObject,
+                    coordinator::ManipTaskResult::FAILED_MOVE, GRABBER);
+            break;
+        case coordinator::ManipTaskGoal::CART_MOVE_TO_GRIPPER_POSE:
+            addStep("cart_move", &TaskActionServer::startCartMove,
+                    coordinator::ManipTaskResult::FAILED_MOVE, GRABBER);
+            break;
+        case coordinator::ManipTaskGoal::DROPOFF_OBJECT:
+            addStep("dropoff_object", &TaskActionServer::startDropoffObject,
+                    coordinator::ManipTaskResult::FAILED_DROPOFF, GRABBER);
+            break;
+        case coordinator::ManipTaskGoal::MOVE_TO_PRE_POSE:
+            addStep("move_to_pre_pose", &TaskActionServer::startMoveToPrePose,
+                    coordinator::ManipTaskResult::FAILED_MOVE, GRABBER);
+            break;
+        case coordinator::ManipTaskGoal::MANIP_OBJECT:
+        {
+            //arm to pre-pose, concurrent w/ perception (table surface, if not yet known, then object);
+            // then grab, then dropoff
+            int pre_pose = addStep("move_to_pre_pose", &TaskActionServer::startMoveToPrePose,
+                    coordinator::ManipTaskResult::FAILED_MOVE, GRABBER);
+            int first_perception = -1;
+            if (perception_source_ == coordinator::ManipTaskGoal::PCL_VISION && !found_surface_height_) {
+                first_perception = addStep("find_table_surface", &TaskActionServer::startFindTableSurface,
+                        coordinator::ManipTaskResult::FAILED_PERCEPTION, FINDER);
+            }
+            int find_object = addStep("get_pickup_pose", &TaskActionServer::startGetPickupPose,
+                    coordinator::ManipTaskResult::FAILED_PERCEPTION, FINDER);
+            if (first_perception >= 0) {
+                task_graph_.add_dependency(find_object, first_perception);
+            } else {
+                first_perception = find_object;
+            }
+            if (!overlap_perception_) {
+                task_graph_.add_dependency(first_perception, pre_pose);
+            }
+            int grab = addStep("grab_object", &TaskActionServer::startGrabObject,
+                    coordinator::ManipTaskResult::FAILED_PICKUP, GRABBER);
+            task_graph_.add_dependency(grab, pre_pose);
+            task_graph_.add_dependency(grab, find_object);
+            int dropoff = addStep("dropoff_object", &TaskActionServer::startDropoffObject,
+                    coordinator::ManipTaskResult::FAILED_DROPOFF, GRABBER);
+            task_graph_.add_dependency(dropoff, grab);
+            break;
         }
+        default:
+            ROS_WARN("executeCB: error--case not recognized");
+            result_.manip_return_code = coordinator::ManipTaskResult::ABORTED;
+            as_.setAborted(result_);
+            return;
+    }
 
+    //run the steps; each wakes this thread from its done callback.  The 0.1 sec period is only
+    // for checking whether the client has cancelled the goal
+    bool succeeded = task_graph_.run(boost::bind(&actionlib::SimpleActionServer<coordinator::ManipTaskAction>::isPreemptRequested, &as_), 0.1);
+    {
+        //from here on, done callbacks of this goal's steps are stale
+        boost::mutex::scoped_lock lock(result_mutex_);
+        goal_generation_++;
+    }
+    ROS_INFO("executeCB: step timing:\n%s", task_graph_.report().c_str());
+    if (succeeded) {
+        result_.manip_return_code = coordinator::ManipTaskResult::MANIP_SUCCESS;
+        publishStatus(action_code == coordinator::ManipTaskGoal::DROPOFF_OBJECT
+                || action_code == coordinator::ManipTaskGoal::MANIP_OBJECT ?
+                coordinator::ManipTaskFeedback::COMPLETED_DROPOFF : coordinator::ManipTaskFeedback::COMPLETED_MOVE);
+        as_.setSucceeded(result_); // return the "result" message to client, along with "success" status
+        return;
+    }
+    int failed_step = task_graph_.failed_task();
+    if (failed_step >= 0) {
+        ROS_WARN("step %d failed; aborting", failed_step);
+        //retain reason for failure to report back to client
+        result_.manip_return_code = step_failure_codes_[failed_step];
+    } else {
+        ROS_WARN("goal cancelled!");
+        cancelRunningSteps();
+        result_.manip_return_code = coordinator::ManipTaskResult::ABORTED;
     }
-    ROS_INFO("executeCB: I should not be here...");
-    //if we survive to here, then the goal was successfully accomplished; inform the client
-    result_.manip_return_code = coordinator::ManipTaskResult::ABORTED;
-    as_.setAborted(result_); // return the "result" message to client, along with "success" status
-    return;
+    publishStatus(coordinator::ManipTaskFeedback::ABORTED);
+    as_.setAborted(result_); // tell the client we have given up on this goal; send the result message as well
 }
 
 int main(int argc, char** argv) {
@@ -500,10 +426,6 @@ int main(int argc, char** argv) {
     TaskActionServer taskActionServer; //create a task action server
 
     ROS_INFO("main going into loop");
-    while (ros::ok()) {
-        ros::spinOnce(); //NEED spins, or action server does not respond
-        ros::Duration(0.1).sleep();
-    }
+    ros::spin(); //NEED spins, or action server does not respond
     return 0;
 }
-
@@ -150,71 +150,24 @@ int main(int argc, char** argv) {
     ROS_INFO("connected to action server"); // if here, then we connected to the server;
 
 
-    ROS_INFO("sending a goal: move to pre-pose");
-    g_goal_done = false;
-    goal.action_code = coordinator::ManipTaskGoal::MOVE_TO_PRE_POSE;
-    action_client.sendGoal(goal, &doneCb, &activeCb, &feedbackCb);
-    while (!g_goal_done) {
-        ros::Duration(0.1).sleep();
-    }
-
-    //send vision request to find table top:
-    ROS_INFO("sending a goal: seeking table top");
-    g_goal_done = false;
-    goal.action_code = coordinator::ManipTaskGoal::FIND_TABLE_SURFACE;
-
-    action_client.sendGoal(goal, &doneCb, &activeCb, &feedbackCb);
-    while (!g_goal_done) {
-        ros::Duration(0.1).sleep();
-    }
-
-
+    //the first MANIP_OBJECT goal also moves the arm to its pre-pose, and finds the table top,
+    // concurrently
     while (ros::ok()) { //manipulation test loop--keep retrying
         //send a manipulation code, including vision, grasp and drop-off
         g_goal_done = false;
         n_attempts++;
 
-        ROS_INFO("sending a goal: find block");
-        goal.action_code = coordinator::ManipTaskGoal::GET_PICKUP_POSE;
+        ROS_INFO("sending a goal: find, grab and drop off block");
+        goal.action_code = coordinator::ManipTaskGoal::MANIP_OBJECT;
         goal.object_code = ObjectIdCodes::TOY_BLOCK_ID;
         goal.perception_source = coordinator::ManipTaskGoal::PCL_VISION;
+        //goal.dropoff_frame was already set at top; 
         action_client.sendGoal(goal, &doneCb, &activeCb, &feedbackCb);
         while (!g_goal_done) {
             ros::Duration(0.1).sleep();
         }
         if (g_callback_status != coordinator::ManipTaskResult::MANIP_SUCCESS) {
-            ROS_ERROR("failed to find block");
-        }
-        if (g_callback_status == coordinator::ManipTaskResult::MANIP_SUCCESS) {
-            //found object; attempt manipulation
-            g_object_pose = g_result.object_pose;
-            g_goal_done = false;
-            goal.action_code = coordinator::ManipTaskGoal::GRAB_OBJECT;
-            goal.pickup_frame = g_result.object_pose;
-            goal.object_code = ObjectIdCodes::TOY_BLOCK_ID;
-            //goal.perception_source= coordinator::ManipTaskGoal::BLIND_MANIP;
-            action_client.sendGoal(goal, &doneCb, &activeCb, &feedbackCb);
-            while (!g_goal_done) {
-                ros::Duration(0.1).sleep();
-            }
-            if (g_callback_status != coordinator::ManipTaskResult::MANIP_SUCCESS) {
-                ROS_ERROR("failed to grab block");
-            }
-        }
-        if (g_callback_status == coordinator::ManipTaskResult::MANIP_SUCCESS) {
-            //if still good, attempt object drop-off   
-
-            g_goal_done = false;
-            goal.action_code = coordinator::ManipTaskGoal::DROPOFF_OBJECT;
-            //goal.dropoff_frame was already set at top; 
-            goal.object_code = ObjectIdCodes::TOY_BLOCK_ID; //assumes robot is holding TOY_BLOCK object
-            action_client.sendGoal(goal, &doneCb, &activeCb, &feedbackCb);
-            while (!g_goal_done) {
-                ros::Duration(0.1).sleep();
-            }
-            if (g_callback_status != coordinator::ManipTaskResult::MANIP_SUCCESS) {
-                ROS_ERROR("failed to drop off block");
-            }
+            ROS_ERROR("failed to find, grab or drop off block");
         }
         g_ntasks_done++;
 
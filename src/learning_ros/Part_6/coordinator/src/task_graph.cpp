@@ -0,0 +1,134 @@
+// task_graph.cpp: implementation of TaskGraph; see task_graph.h
+#include <coordinator/task_graph.h>
+#include <boost/bind.hpp>
+#include <stdio.h>
+
+TaskGraph::TaskGraph() {
+    failed_task_ = -1;
+    generation_ = 0;
+}
+
+void TaskGraph::clear() {
+    boost::mutex::scoped_lock lock(mutex_);
+    tasks_.clear();
+    failed_task_ = -1;
+    generation_++;
+}
+
+int TaskGraph::add_task(const std::string &name, const TaskStartFn &start) {
+    Task task;
+    task.name = name;
+    task.start = start;
+    task.status = WAITING;
+    task.t_start = 0.0;
+    task.t_end = 0.0;
+    tasks_.push_back(task);
+    return tasks_.size() - 1;
+}
+
+void TaskGraph::add_dependency(int task, int prerequisite) {
+    tasks_[task].prerequisites.push_back(prerequisite);
+}
+
+double TaskGraph::elapsed() const {
+    return 1.0e-6 * (boost::posix_time::microsec_clock::universal_time() - run_start_).total_microseconds();
+}
+
+//called from the done callbacks, i.e. from whatever thread the action client uses
+void TaskGraph::task_done(unsigned generation, int task, bool succeeded) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (generation != generation_ || tasks_[task].status != RUNNING) {
+        return; // from before a clear(), or canceled
+    }
+    tasks_[task].status = succeeded ? SUCCEEDED : FAILED;
+    tasks_[task].t_end = elapsed();
+    if (!succeeded && failed_task_ < 0) {
+        failed_task_ = task;
+    }
+    task_done_cond_.notify_all();
+}
+
+bool TaskGraph::run(const boost::function<bool()> &should_cancel, double check_period) {
+    boost::mutex::scoped_lock lock(mutex_);
+    run_start_ = boost::posix_time::microsec_clock::universal_time();
+    std::vector<int> ready;
+    while (true) {
+        if (should_cancel && should_cancel()) {
+            for (int i = 0; i < (int) tasks_.size(); i++) {
+                if (tasks_[i].status == RUNNING) {
+                    tasks_[i].status = CANCELED;
+                    tasks_[i].t_end = elapsed();
+                } else if (tasks_[i].status == WAITING) {
+                    tasks_[i].status = SKIPPED;
+                }
+            }
+            return false;
+        }
+        int n_running = 0;
+        ready.clear();
+        for (int i = 0; i < (int) tasks_.size(); i++) {
+            if (tasks_[i].status == RUNNING) {
+                n_running++;
+            } else if (tasks_[i].status == WAITING && failed_task_ < 0) {
+                bool is_ready = true;
+                for (int j = 0; j < (int) tasks_[i].prerequisites.size(); j++) {
+                    if (tasks_[tasks_[i].prerequisites[j]].status != SUCCEEDED) {
+                        is_ready = false;
+                    }
+                }
+                if (is_ready) {
+                    tasks_[i].status = RUNNING;
+                    tasks_[i].t_start = elapsed();
+                    ready.push_back(i);
+                }
+            }
+        }
+        if (!ready.empty()) {
+            //a step may complete from within its start function, so start w/o the lock
+            unsigned generation = generation_;
+            lock.unlock();
+            for (int k = 0; k < (int) ready.size(); k++) {
+                tasks_[ready[k]].start(boost::bind(&TaskGraph::task_done, this, generation, ready[k], _1));
+            }
+            lock.lock();
+            continue;
+        }
+        if (n_running == 0) {
+            break;
+        }
+        task_done_cond_.timed_wait(lock, boost::posix_time::microseconds((long) (1.0e6 * check_period)));
+    }
+    bool all_succeeded = true;
+    for (int i = 0; i < (int) tasks_.size(); i++) {
+        if (tasks_[i].status == WAITING) {
+            tasks_[i].status = SKIPPED; // after a failure, or never ready
+        }
+        if (tasks_[i].status != SUCCEEDED) {
+            all_succeeded = false;
+        }
+    }
+    return all_succeeded;
+}
+
+std::string TaskGraph::report() const {
+    static const char *status_names[] = {"waiting", "running", "succeeded", "failed", "skipped", "canceled"};
+    std::string table = "step                     start(s)  duration(s)  status\n";
+    char line[128];
+    double t_last = 0.0;
+    for (int i = 0; i < (int) tasks_.size(); i++) {
+        const Task &task = tasks_[i];
+        if (task.status == SKIPPED || task.status == WAITING) {
+            snprintf(line, sizeof(line), "%-24s %8s  %11s  %s\n", task.name.c_str(), "-", "-",
+                    status_names[task.status]);
+        } else {
+            double t_end = (task.status == RUNNING) ? task.t_start : task.t_end;
+            snprintf(line, sizeof(line), "%-24s %8.3f  %11.3f  %s\n", task.name.c_str(), task.t_start,
+                    t_end - task.t_start, status_names[task.status]);
+            if (t_end > t_last) t_last = t_end;
+        }
+        table += line;
+    }
+    snprintf(line, sizeof(line), "total: %.3f s", t_last);
+    table += line;
+    return table;
+}
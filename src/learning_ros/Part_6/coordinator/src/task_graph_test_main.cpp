@@ -0,0 +1,108 @@
+// task_graph_test_main.cpp
+// exercise TaskGraph w/ simulated steps: each step is a thread that sleeps for the step's
+// duration, then calls its done function, as an action client's done callback would
+
+#include <coordinator/task_graph.h>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <stdio.h>
+
+const double TIME_SCALE = 0.01; // real sec per step-duration sec
+
+boost::mutex g_mutex;
+int g_n_running = 0; // simulated steps in progress
+int g_max_running = 0;
+
+void simulated_step(double duration, bool succeed, TaskDoneFn done) {
+    boost::this_thread::sleep(boost::posix_time::microseconds((long) (1.0e6 * TIME_SCALE * duration)));
+    {
+        boost::mutex::scoped_lock lock(g_mutex);
+        g_n_running--;
+    }
+    done(succeed);
+}
+
+void start_simulated_step(double duration, bool succeed, const TaskDoneFn &done) {
+    {
+        boost::mutex::scoped_lock lock(g_mutex);
+        g_n_running++;
+        if (g_n_running > g_max_running) g_max_running = g_n_running;
+    }
+    boost::thread(boost::bind(&simulated_step, duration, succeed, done)).detach();
+}
+
+TaskStartFn step(double duration, bool succeed = true) {
+    return boost::bind(&start_simulated_step, duration, succeed, _1);
+}
+
+bool cancel_after(boost::posix_time::ptime t_cancel) {
+    return boost::posix_time::microsec_clock::universal_time() > t_cancel;
+}
+
+int main() {
+    TaskGraph graph;
+    bool ok;
+
+    //pick-and-place steps, as command_bundler's MANIP_OBJECT: perception runs while the arm moves
+    int pre_pose = graph.add_task("move_to_pre_pose", step(4.0));
+    int find_table = graph.add_task("find_table_surface", step(1.5));
+    int find_block = graph.add_task("find_block", step(1.5));
+    int grab = graph.add_task("grab_block", step(2.0));
+    int dropoff = graph.add_task("dropoff_block", step(2.0));
+    graph.add_dependency(find_block, find_table);
+    graph.add_dependency(grab, pre_pose);
+    graph.add_dependency(grab, find_block);
+    graph.add_dependency(dropoff, grab);
+    ok = graph.run();
+    printf("pick and place:\n%s\n\n", graph.report().c_str());
+    if (!ok || g_max_running != 2) {
+        printf("FAILED: pick and place should succeed, w/ perception concurrent w/ the arm move\n");
+        return 1;
+    }
+
+    //perception fails while the arm moves: the move finishes, grab is skipped
+    graph.clear();
+    pre_pose = graph.add_task("move_to_pre_pose", step(4.0));
+    find_block = graph.add_task("find_block", step(1.5, false));
+    grab = graph.add_task("grab_block", step(2.0));
+    graph.add_dependency(grab, pre_pose);
+    graph.add_dependency(grab, find_block);
+    ok = graph.run();
+    printf("failed perception:\n%s\n\n", graph.report().c_str());
+    if (ok || graph.failed_task() != find_block || graph.status(pre_pose) != TaskGraph::SUCCEEDED
+            || graph.status(grab) != TaskGraph::SKIPPED) {
+        printf("FAILED: failed step should be reported, the step in progress waited for, and the rest skipped\n");
+        return 1;
+    }
+
+    //a step that completes from within its start function
+    graph.clear();
+    int blind = graph.add_task("blind_pickup_pose", step(0.0));
+    grab = graph.add_task("grab_block", step(1.0));
+    graph.add_dependency(grab, blind);
+    if (!graph.run()) {
+        printf("FAILED: step that completes at once\n");
+        return 1;
+    }
+
+    //cancel while a step is in progress: run() returns w/o waiting for it, and its later completion
+    // is ignored, even after clear()
+    graph.clear();
+    int slow = graph.add_task("slow_move", step(50.0));
+    boost::posix_time::ptime t_cancel = boost::posix_time::microsec_clock::universal_time()
+            + boost::posix_time::microseconds((long) (1.0e6 * TIME_SCALE * 2.0));
+    ok = graph.run(boost::bind(&cancel_after, t_cancel), 0.1 * TIME_SCALE);
+    if (ok || graph.status(slow) != TaskGraph::CANCELED || g_n_running != 1) {
+        printf("FAILED: cancel should return while the step is still in progress\n");
+        return 1;
+    }
+    graph.clear();
+    int next = graph.add_task("next_goal", step(60.0));
+    boost::this_thread::sleep(boost::posix_time::microseconds((long) (1.0e6 * TIME_SCALE * 55.0)));
+    if (graph.status(next) != TaskGraph::WAITING) {
+        printf("FAILED: completion of a cancelled step should be ignored\n");
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,65 @@
+//
+// Radius-density clustering on a uniform voxel grid.
+//
+// Points are binned into cubic cells with edge = search radius, so all neighbors of a point within
+// that radius lie in the 27 surrounding cells.  For every seed point (optionally restricted to a
+// region), the number of neighbors within the radius is counted in parallel; the seed with the most
+// neighbors is the density peak, and the cluster is the set of points within cluster_radius of the peak.
+// Cost is near-linear in the number of points, instead of quadratic as with exhaustive pairwise tests.
+//
+
+#ifndef PCL_RECOGNITION_DENSITY_CLUSTER_H
+#define PCL_RECOGNITION_DENSITY_CLUSTER_H
+
+#include <vector>
+#include <Eigen/Eigen>
+#include <boost/unordered_map.hpp>
+#include <boost/cstdint.hpp>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+class DensityCluster {
+public:
+    DensityCluster();
+
+    // use the points of cloud selected by indices (all points if indices is empty); NaN points are skipped
+    void set_input_cloud(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, const std::vector<int> &indices);
+    void set_input_cloud(const pcl::PointCloud<pcl::PointXYZ> &cloud, const std::vector<int> &indices);
+
+    // neighbor-count radius, used to find the density peak (also the grid cell size)
+    void set_radius(double radius) { radius_ = radius; }
+    // only points within seed_range of seed_center are candidates for the density peak
+    void set_seed_region(const Eigen::Vector3f &seed_center, double seed_range) {
+        seed_center_ = seed_center; seed_range_ = seed_range; use_seed_region_ = true; }
+    void clear_seed_region() { use_seed_region_ = false; }
+    // cluster members are points within cluster_radius of the peak (default: the neighbor-count radius)
+    void set_cluster_radius(double cluster_radius) { cluster_radius_ = cluster_radius; }
+    // if true, cluster membership ignores z, i.e. uses a cylinder along z (e.g. the camera axis) around the peak
+    void set_membership_ignores_z(bool ignore_z) { ignore_z_ = ignore_z; }
+
+    // find the densest cluster; returns false if there are no candidate seeds.
+    // cluster_indices and peak_index refer to the original cloud
+    bool find_densest_cluster(std::vector<int> &cluster_indices, Eigen::Vector3f &centroid, int &peak_index);
+    // number of neighbors of the peak found by the most recent search
+    int get_peak_count() const { return peak_count_; }
+
+private:
+    std::vector<Eigen::Vector3f> pts_;  // input points, sorted by grid cell
+    std::vector<int> cloud_indices_;    // index into the original cloud of each entry of pts_
+    boost::unordered_map<boost::int64_t, std::pair<int, int> > cells_;  // cell key -> (first, count) in pts_
+    std::vector<int> neighbor_counts_;
+
+    double radius_, cluster_radius_, seed_range_;
+    Eigen::Vector3f seed_center_;
+    bool use_seed_region_, ignore_z_;
+    int peak_count_;
+
+    template <typename PointT>
+    void load_points(const pcl::PointCloud<PointT> &cloud, const std::vector<int> &indices);
+    void build_grid();
+    void cell_coords(const Eigen::Vector3f &pt, int &ix, int &iy, int &iz) const;
+    static boost::int64_t cell_key(int ix, int iy, int iz);
+    int count_neighbors(int i) const;
+};
+
+#endif //PCL_RECOGNITION_DENSITY_CLUSTER_H
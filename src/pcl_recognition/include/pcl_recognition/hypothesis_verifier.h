@@ -0,0 +1,73 @@
+//
+// ICP refinement and global verification of recognition hypotheses.
+//
+// Each hypothesis is a rototranslation of the model into the scene (e.g. from Hough or GC grouping).
+// The scene search tree is built once, in set_scene_cloud(), and shared by every ICP run; the hypotheses
+// are then refined concurrently, one ICP object per thread, with the model used directly as the ICP
+// source and the hypothesis as the initial guess (so no transformed model copy is made per hypothesis).
+// The refined instances are finally handed to pcl::GlobalHypothesesVerification.
+//
+
+#ifndef PCL_RECOGNITION_HYPOTHESIS_VERIFIER_H
+#define PCL_RECOGNITION_HYPOTHESIS_VERIFIER_H
+
+#include <vector>
+#include <Eigen/Eigen>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/registration/icp.h>
+
+template <typename PointT>
+class HypothesisVerifier {
+public:
+    typedef pcl::PointCloud<PointT> Cloud;
+    typedef std::vector<Eigen::Matrix4f, Eigen::aligned_allocator<Eigen::Matrix4f> > TransformVector;
+
+    HypothesisVerifier();
+
+    // set the scene and build its search tree; the tree is reused until the scene changes
+    void set_scene_cloud(const typename Cloud::ConstPtr &scene);
+
+    void set_icp_max_iterations(int icp_max_iter) {icp_max_iter_ = icp_max_iter;}
+    void set_icp_corr_distance(double icp_corr_distance) {icp_corr_distance_ = icp_corr_distance;}
+
+    void set_hv_inlier_th(double hv_inlier_th) {hv_inlier_th_ = hv_inlier_th;}
+    void set_hv_occlusion_th(double hv_occlusion_th) {hv_occlusion_th_ = hv_occlusion_th;}
+    void set_hv_regularizer(double hv_regularizer) {hv_regularizer_ = hv_regularizer;}
+    void set_hv_rad_clutter(double hv_rad_clutter) {hv_rad_clutter_ = hv_rad_clutter;}
+    void set_hv_clutter_reg(double hv_clutter_reg) {hv_clutter_reg_ = hv_clutter_reg;}
+    void set_hv_detect_clutter(bool hv_detect_clutter) {hv_detect_clutter_ = hv_detect_clutter;}
+    void set_hv_rad_normals(double hv_rad_normals) {hv_rad_normals_ = hv_rad_normals;}
+
+    // refine every hypothesis (model -> scene rototranslation) with ICP, in parallel; returns the number that converged
+    int refine(const typename Cloud::ConstPtr &model, const TransformVector &rototranslations);
+    // run global hypotheses verification on the refined instances; mask[i] is true if instance i is accepted
+    bool verify(std::vector<bool> &mask);
+
+    // results of the most recent refine(); the instance clouds are reused (overwritten) by the next call
+    const std::vector<typename Cloud::ConstPtr> &get_registered_instances() const {return registered_instances_;}
+    const TransformVector &get_refined_transforms() const {return refined_transforms_;}
+    const std::vector<bool> &get_converged() const {return converged_;}
+
+private:
+    typename Cloud::ConstPtr scene_;
+    typename pcl::search::KdTree<PointT>::Ptr scene_tree_;
+
+    // one ICP object per thread, created once and reused across calls
+    std::vector<boost::shared_ptr<pcl::IterativeClosestPoint<PointT, PointT> > > icp_pool_;
+    // one output cloud per hypothesis; grows as needed and keeps its capacity
+    std::vector<typename Cloud::Ptr> instance_buffers_;
+
+    std::vector<typename Cloud::ConstPtr> registered_instances_;
+    TransformVector refined_transforms_;
+    std::vector<bool> converged_;
+    std::vector<char> converged_flags_;  // written by the worker threads (vector<bool> elements share bytes)
+
+    int icp_max_iter_;
+    double icp_corr_distance_;
+    double hv_inlier_th_, hv_occlusion_th_, hv_regularizer_, hv_rad_clutter_, hv_clutter_reg_, hv_rad_normals_;
+    bool hv_detect_clutter_;
+};
+
+#endif //PCL_RECOGNITION_HYPOTHESIS_VERIFIER_H
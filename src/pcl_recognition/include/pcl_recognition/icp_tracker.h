@@ -0,0 +1,80 @@
+//
+// Frame-to-frame ICP pose tracking, coarse to fine.
+//
+// The pose found for one frame is the initial guess for the next, so a part that moves a little between
+// frames needs only a few iterations.  Each call runs a schedule of levels: typically some iterations on
+// voxel-downsampled clouds with a wide correspondence distance, then a few at full resolution with a
+// tight one.  The target (and its downsampled copies) and their search trees are built in set_target()
+// and reused by every call until the target changes.
+//
+
+#ifndef PCL_RECOGNITION_ICP_TRACKER_H
+#define PCL_RECOGNITION_ICP_TRACKER_H
+
+#include <vector>
+#include <Eigen/Eigen>
+#include <boost/shared_ptr.hpp>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/registration/icp.h>
+
+class IcpTracker {
+public:
+    typedef pcl::PointXYZ PointT;
+    typedef pcl::PointCloud<PointT> Cloud;
+
+    IcpTracker();
+
+    // add a level to the schedule, run in the order added; voxel_size <= 0 means full resolution.
+    // if no level is added, a default schedule is used: 10 iterations at 1cm voxels, then 3 at full resolution
+    void add_level(double voxel_size, int max_iterations, double max_corr_distance);
+    void clear_levels();
+
+    // set the (static) target; downsampled copies and search trees are built here, once
+    void set_target(const Cloud::ConstPtr &target);
+    bool has_target() const { return (bool) target_; }
+
+    // pose (source -> target) used as the initial guess for the next call to track()
+    void set_pose(const Eigen::Matrix4f &pose) { pose_ = pose; }
+    const Eigen::Matrix4f &get_pose() const { return pose_; }
+
+    // align source to the target, starting from the current pose; if the final level converges, the
+    // result becomes the current pose.  aligned is the source transformed by the result
+    bool track(const Cloud::ConstPtr &source, Cloud &aligned);
+
+    // statistics of the most recent call to track()
+    int get_iterations() const { return iterations_; }    // total over all levels
+    double get_fitness() const { return fitness_; }        // mean squared distance of the final level's inliers
+    double get_time_ms() const { return time_ms_; }
+
+private:
+    // exposes the iteration count, which pcl::IterativeClosestPoint keeps protected
+    class CountingIcp : public pcl::IterativeClosestPoint<PointT, PointT> {
+    public:
+        int get_iterations() const { return nr_iterations_; }
+    };
+
+    struct Level {
+        double voxel_size;
+        int max_iterations;
+        double max_corr_distance;
+        Cloud::ConstPtr target;                         // downsampled target (or the full target)
+        pcl::search::KdTree<PointT>::Ptr target_tree;
+        Cloud::Ptr source;                              // downsampled source buffer, reused every call
+        boost::shared_ptr<CountingIcp> icp;
+    };
+    std::vector<Level> levels_;
+
+    Cloud::ConstPtr target_;
+    Cloud aligned_coarse_;  // output buffer of the coarse levels
+    Eigen::Matrix4f pose_;
+
+    int iterations_;
+    double fitness_, time_ms_;
+
+    void prepare_level(Level &level);
+    void downsample(const Cloud::ConstPtr &input, double voxel_size, Cloud &output) const;
+};
+
+#endif //PCL_RECOGNITION_ICP_TRACKER_H
@@ -0,0 +1,89 @@
+//
+// Implicit shape model (ISM) training and recognition, with the model trained once, offline.
+//
+// train() computes normals and FPFH features of the training clouds, trains a pcl::ism model and saves
+// it to a file.  A recognizer then calls load_model() once and find_objects() for each incoming cloud,
+// so a query costs only the features of that cloud.  Normals and features are computed with OpenMP;
+// matching of features to the codebook and casting of votes run in parallel over the keypoints, and
+// the mean-shift searches for vote peaks run in parallel over their starting points.
+// The voting and peak search follow pcl::ism::ImplicitShapeModelEstimation::findObjects() and
+// pcl::features::ISMVoteList::findStrongestPeaks(), so models trained by pcl::ism work unchanged.
+//
+
+#ifndef PCL_RECOGNITION_ISM_RECOGNIZER_H
+#define PCL_RECOGNITION_ISM_RECOGNIZER_H
+
+#include <string>
+#include <vector>
+#include <Eigen/Eigen>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/kdtree/kdtree_flann.h>
+#include <pcl/recognition/implicit_shape_model.h>
+
+class IsmRecognizer {
+public:
+    typedef pcl::PointCloud<pcl::PointXYZ> Cloud;
+    typedef std::vector<pcl::ISMPeak, Eigen::aligned_allocator<pcl::ISMPeak> > PeakVector;
+
+    IsmRecognizer();
+
+    // these must match between training and recognition; defaults are those of the pcl ism tutorial
+    void set_normal_radius(double normal_radius) {normal_radius_ = normal_radius;}
+    void set_feature_radius(double feature_radius) {feature_radius_ = feature_radius;}
+    void set_sampling_size(float sampling_size) {sampling_size_ = sampling_size;}
+
+    // train a model from clouds and their class ids, and save it to filename
+    bool train(const std::vector<Cloud::Ptr> &clouds, const std::vector<unsigned int> &classes, const std::string &filename);
+    // load a trained model; done once, before any call to find_objects()
+    bool load_model(const std::string &filename);
+    bool have_model() const {return have_model_;}
+    int get_num_classes() const {return have_model_ ? model_->number_of_classes_ : 0;}
+
+    // find instances of class_id in cloud; peaks are in order of decreasing density.
+    // peaks closer than 10 sigma of the class to a stronger one are suppressed, as in the pcl ism tutorial
+    bool find_objects(const Cloud::ConstPtr &cloud, int class_id, PeakVector &peaks);
+
+    // votes cast by the most recent call to find_objects()
+    const Cloud::Ptr &get_votes() const {return votes_;}
+    // cloud in white with the votes in red, for display
+    void get_colored_cloud(const Cloud &cloud, pcl::PointCloud<pcl::PointXYZRGB> &colored) const;
+
+private:
+    typedef pcl::Histogram<153> FeatureType;
+
+    // exposes the sampling, feature and local-frame steps of pcl's ISM, which are protected
+    class Estimator : public pcl::ism::ImplicitShapeModelEstimation<153, pcl::PointXYZ, pcl::Normal> {
+    public:
+        void sample(Cloud::ConstPtr cloud, pcl::PointCloud<pcl::Normal>::ConstPtr normals,
+                    Cloud::Ptr sampled_cloud, pcl::PointCloud<pcl::Normal>::Ptr sampled_normals) {
+            this->simplifyCloud(cloud, normals, sampled_cloud, sampled_normals); }
+        void features(Cloud::Ptr sampled_cloud, pcl::PointCloud<pcl::Normal>::Ptr sampled_normals,
+                      pcl::PointCloud<FeatureType>::Ptr features) {
+            this->estimateFeatures(sampled_cloud, sampled_normals, features); }
+        Eigen::Matrix3f normal_frame(const pcl::Normal &normal) { return this->alignYCoordWithNormal(normal); }
+    };
+
+    void configure(Estimator &estimator);
+    void compute_normals(const Cloud::ConstPtr &cloud, pcl::PointCloud<pcl::Normal> &normals) const;
+    void cast_votes(const Cloud &sampled_cloud, const pcl::PointCloud<pcl::Normal> &sampled_normals,
+                    const pcl::PointCloud<FeatureType> &features, int class_id);
+    void find_peaks(int class_id, double sigma, double non_maxima_radius, PeakVector &peaks);
+    double shift_mean(const Eigen::Vector3f &center, double sigma, Eigen::Vector3f &shifted) const;
+
+    Estimator estimator_;
+    pcl::ism::ImplicitShapeModelEstimation<153, pcl::PointXYZ, pcl::Normal>::ISMModelPtr model_;
+    bool have_model_;
+    double normal_radius_, feature_radius_;
+    float sampling_size_;
+
+    // buffers reused from call to call
+    Cloud::Ptr sampled_cloud_;
+    pcl::PointCloud<pcl::Normal>::Ptr normals_, sampled_normals_;
+    pcl::PointCloud<FeatureType>::Ptr features_;
+    Cloud::Ptr votes_;
+    std::vector<float> vote_strengths_;
+    pcl::KdTreeFLANN<pcl::PointXYZ> vote_tree_;
+};
+
+#endif //PCL_RECOGNITION_ISM_RECOGNIZER_H
@@ -1,2 +1,5 @@
 #!/bin/bash
-rosrun pcl_recognition implicit_shape_model `rospack find pcl_recognition`/data/coke.stl/pcd/ism_train_cat.pcd 0 `rospack find pcl_recognition`/pcd/ism_train_horse.pcd 1 `rospack find pcl_recognition`/pcd/ism_train_lioness.pcd 2 `rospack find pcl_recognition`/pcd/ism_train_michael.pcd 3 `rospack find pcl_recognition`/pcd/ism_train_wolf.pcd 4 `rospack find pcl_recognition`/pcd/ism_test_cat.pcd 0
+# train once (offline), then recognize with the saved model
+PCD=`rospack find pcl_recognition`/pcd
+rosrun pcl_recognition ism_train $PCD/trained_ism_model.txt $PCD/ism_train_cat.pcd 0 $PCD/ism_train_horse.pcd 1 $PCD/ism_train_lioness.pcd 2 $PCD/ism_train_michael.pcd 3 $PCD/ism_train_wolf.pcd 4
+rosrun pcl_recognition implicit_shape_model $PCD/trained_ism_model.txt 0 $PCD/ism_test_cat.pcd
@@ -3,10 +3,9 @@
 //
 
 #include <pcl_recognition/pcl_recognition.h>  //a local library with some utility fncs
+#include <pcl_recognition/density_cluster.h>
 #include <ros/package.h>
 
-#define sq(a)   (pow(a,2))
-
 PclUtils *g_pcl_utils_ptr;
 
 std::string find_in_package(std::string filename) {
@@ -56,53 +55,26 @@ void find_indices_of_plane_from_patch(pcl::PointCloud<pcl::PointXYZRGB>::Ptr inp
 
 void sphare_filter(pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr, pcl::PointCloud<pcl::PointXYZ>::Ptr patch_cloud_ptr,
                    vector<int> &indices, vector<int> &filtered_indices, double &centroid_indices, double filter_range) {
-    // find largest segment in the indices
-    double sq_range = sq(filter_range);
-    double best_indices = -1;
-    int best_cnt = -1;
-    double x, y, z;
-
+    // find largest segment in the indices: the densest point (most neighbors within filter_range), among points
+    // within filter_range of the patch centroid, then all points within filter_range (in x-y) of that point
     Eigen::Vector3f centroid = Eigen::MatrixXf::Zero(3, 1);
     for (int i = 0; i < patch_cloud_ptr->points.size(); ++i) {
         centroid += patch_cloud_ptr->points[i].getVector3fMap();
     }
     centroid /= patch_cloud_ptr->points.size();
 
-    for (int i = 0; i < indices.size(); ++i) {
-        int current_cnt = 0;
-        x = sq(centroid[0] - input_cloud_ptr->points[indices[i]].x);
-        y = sq(centroid[1] - input_cloud_ptr->points[indices[i]].y);
-        z = sq(centroid[2] - input_cloud_ptr->points[indices[i]].z);
-        if ((x + y + z) <= sq_range) {
-            for (int j = 0; j < indices.size(); ++j) {
-                x = sq(input_cloud_ptr->points[indices[i]].x - input_cloud_ptr->points[indices[j]].x);
-                y = sq(input_cloud_ptr->points[indices[i]].y - input_cloud_ptr->points[indices[j]].y);
-                z = sq(input_cloud_ptr->points[indices[i]].z - input_cloud_ptr->points[indices[j]].z);
-                // cout << "x:" << x << ", y:" << y << ", z:" << z << ", sum:" << x+y+z << endl;
-                if ((x + y + z) <= sq_range) {
-                    current_cnt++;
-                }
-            }
-            if (current_cnt > best_cnt) {
-                best_indices = indices[i];
-                best_cnt = current_cnt;
-            }
-        }
-    }
-    //cout << "the best indices is: " << best_indices << endl;
-    filtered_indices.clear();
-    for (int k = 0; k < indices.size(); ++k) {
-        //x = sq(transformed_cloud_ptr->points[best_indices].x - transformed_cloud_ptr->points[indices[k]].x);
-        //y = sq(transformed_cloud_ptr->points[best_indices].y - transformed_cloud_ptr->points[indices[k]].y);
-        x = sq(input_cloud_ptr->points[best_indices].x - input_cloud_ptr->points[indices[k]].x);
-        y = sq(input_cloud_ptr->points[best_indices].y - input_cloud_ptr->points[indices[k]].y);
-        z = sq(input_cloud_ptr->points[best_indices].z - input_cloud_ptr->points[indices[k]].z);
-        if ((x + y) <= sq_range) {
-            filtered_indices.push_back(indices[k]);
-        }
+    DensityCluster density_cluster;
+    density_cluster.set_input_cloud(*input_cloud_ptr, indices);
+    density_cluster.set_radius(filter_range);
+    density_cluster.set_seed_region(centroid, filter_range);
+    density_cluster.set_membership_ignores_z(true);
+    Eigen::Vector3f cluster_centroid;
+    int best_index = -1;
+    if (!density_cluster.find_densest_cluster(filtered_indices, cluster_centroid, best_index)) {
+        ROS_WARN("no plane points near the patch centroid");
     }
     cout << "number of points after sphare filter = " << filtered_indices.size() << endl;
-    centroid_indices = best_indices;
+    centroid_indices = best_index;
 }
 
 void find_normal_centroid(pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr, vector<int> &indices,
@@ -0,0 +1,161 @@
+//
+// Radius-density clustering on a uniform voxel grid; see density_cluster.h
+//
+
+#include <pcl_recognition/density_cluster.h>
+#include <algorithm>
+#include <math.h>
+
+DensityCluster::DensityCluster()
+{
+    radius_ = 0.1;
+    cluster_radius_ = -1.0;  // <0: same as radius_
+    seed_range_ = 0.0;
+    seed_center_ = Eigen::Vector3f::Zero();
+    use_seed_region_ = false;
+    ignore_z_ = false;
+    peak_count_ = 0;
+}
+
+template <typename PointT>
+void DensityCluster::load_points(const pcl::PointCloud<PointT> &cloud, const std::vector<int> &indices)
+{
+    int n = indices.empty() ? cloud.points.size() : indices.size();
+    pts_.clear();
+    cloud_indices_.clear();
+    pts_.reserve(n);
+    cloud_indices_.reserve(n);
+    for (int k = 0; k < n; ++k) {
+        int i = indices.empty() ? k : indices[k];
+        const PointT &p = cloud.points[i];
+        if (!pcl_isfinite(p.x) || !pcl_isfinite(p.y) || !pcl_isfinite(p.z)) continue;
+        pts_.push_back(Eigen::Vector3f(p.x, p.y, p.z));
+        cloud_indices_.push_back(i);
+    }
+}
+
+void DensityCluster::set_input_cloud(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, const std::vector<int> &indices)
+{
+    load_points(cloud, indices);
+}
+
+void DensityCluster::set_input_cloud(const pcl::PointCloud<pcl::PointXYZ> &cloud, const std::vector<int> &indices)
+{
+    load_points(cloud, indices);
+}
+
+void DensityCluster::cell_coords(const Eigen::Vector3f &pt, int &ix, int &iy, int &iz) const
+{
+    float inv = 1.0 / radius_;
+    ix = (int) floorf(pt[0] * inv);
+    iy = (int) floorf(pt[1] * inv);
+    iz = (int) floorf(pt[2] * inv);
+}
+
+boost::int64_t DensityCluster::cell_key(int ix, int iy, int iz)
+{
+    const boost::int64_t mask = (1 << 21) - 1;
+    return (((boost::int64_t) ix & mask) << 42) | (((boost::int64_t) iy & mask) << 21) | ((boost::int64_t) iz & mask);
+}
+
+// sort points by cell, so each cell's points are contiguous, and record where each cell starts
+void DensityCluster::build_grid()
+{
+    int n = pts_.size();
+    std::vector<std::pair<boost::int64_t, int> > keyed(n);
+    int ix, iy, iz;
+    for (int i = 0; i < n; ++i) {
+        cell_coords(pts_[i], ix, iy, iz);
+        keyed[i] = std::make_pair(cell_key(ix, iy, iz), i);
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    std::vector<Eigen::Vector3f> sorted_pts(n);
+    std::vector<int> sorted_indices(n);
+    cells_.clear();
+    for (int i = 0; i < n; ++i) {
+        sorted_pts[i] = pts_[keyed[i].second];
+        sorted_indices[i] = cloud_indices_[keyed[i].second];
+        if (i == 0 || keyed[i].first != keyed[i - 1].first) {
+            cells_[keyed[i].first] = std::make_pair(i, 0);
+        }
+        cells_[keyed[i].first].second++;
+    }
+    pts_.swap(sorted_pts);
+    cloud_indices_.swap(sorted_indices);
+}
+
+int DensityCluster::count_neighbors(int i) const
+{
+    const Eigen::Vector3f &p = pts_[i];
+    float sq_range = radius_ * radius_;
+    int ix, iy, iz;
+    cell_coords(p, ix, iy, iz);
+    int count = 0;
+    for (int dx = -1; dx <= 1; ++dx) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dz = -1; dz <= 1; ++dz) {
+                boost::unordered_map<boost::int64_t, std::pair<int, int> >::const_iterator it =
+                        cells_.find(cell_key(ix + dx, iy + dy, iz + dz));
+                if (it == cells_.end()) continue;
+                int end = it->second.first + it->second.second;
+                for (int j = it->second.first; j < end; ++j) {
+                    if ((pts_[j] - p).squaredNorm() <= sq_range) count++;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+bool DensityCluster::find_densest_cluster(std::vector<int> &cluster_indices, Eigen::Vector3f &centroid, int &peak_index)
+{
+    cluster_indices.clear();
+    peak_count_ = 0;
+    if (pts_.empty() || radius_ <= 0.0) return false;
+    build_grid();
+
+    // candidate seeds
+    int n = pts_.size();
+    float sq_seed_range = seed_range_ * seed_range_;
+    std::vector<int> seeds;
+    seeds.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        if (!use_seed_region_ || (pts_[i] - seed_center_).squaredNorm() <= sq_seed_range) seeds.push_back(i);
+    }
+    if (seeds.empty()) return false;
+
+    // neighbor counts are independent per seed: count them in parallel
+    int nseeds = seeds.size();
+    neighbor_counts_.resize(nseeds);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int s = 0; s < nseeds; ++s) {
+        neighbor_counts_[s] = count_neighbors(seeds[s]);
+    }
+    // ties go to the first seed in cloud order, as an exhaustive scan would
+    int best = 0;
+    for (int s = 1; s < nseeds; ++s) {
+        int c = neighbor_counts_[s], cb = neighbor_counts_[best];
+        if (c > cb || (c == cb && cloud_indices_[seeds[s]] < cloud_indices_[seeds[best]])) best = s;
+    }
+    int peak = seeds[best];
+    peak_count_ = neighbor_counts_[best];
+    peak_index = cloud_indices_[peak];
+
+    // members: within cluster_radius of the peak (a sphere, or a cylinder along z)
+    double r = (cluster_radius_ > 0.0) ? cluster_radius_ : radius_;
+    float sq_r = r * r;
+    const Eigen::Vector3f &p = pts_[peak];
+    centroid = Eigen::Vector3f::Zero();
+    for (int i = 0; i < n; ++i) {
+        Eigen::Vector3f d = pts_[i] - p;
+        float dist_sq = ignore_z_ ? d.head<2>().squaredNorm() : d.squaredNorm();
+        if (dist_sq <= sq_r) {
+            cluster_indices.push_back(cloud_indices_[i]);
+            centroid += pts_[i];
+        }
+    }
+    centroid /= cluster_indices.size();  // includes the peak itself, so never empty
+    std::sort(cluster_indices.begin(), cluster_indices.end());
+    return true;
+}
@@ -44,13 +44,12 @@
 #include <pcl/keypoints/uniform_sampling.h>
 #include <pcl/recognition/cg/hough_3d.h>
 #include <pcl/recognition/cg/geometric_consistency.h>
-#include <pcl/recognition/hv/hv_go.h>
-#include <pcl/registration/icp.h>
 #include <pcl/visualization/pcl_visualizer.h>
 #include <pcl/kdtree/kdtree_flann.h>
 #include <pcl/kdtree/impl/kdtree_flann.hpp>
 #include <pcl/common/transforms.h>
 #include <pcl/console/parse.h>
+#include <pcl_recognition/hypothesis_verifier.h>
 
  typedef pcl::PointXYZRGBA PointType;
  typedef pcl::Normal NormalType;
@@ -401,70 +400,34 @@ else
 }
 
   /**
-   * Generates clouds for each instances found
+   * ICP and Hypothesis Verification
+   * the scene search tree is built once; all hypotheses are refined in parallel
    */
-   std::vector<pcl::PointCloud<PointType>::ConstPtr> instances;
-
-   for (size_t i = 0; i < rototranslations.size (); ++i)
-   {
-    pcl::PointCloud<PointType>::Ptr rotated_model (new pcl::PointCloud<PointType> ());
-    pcl::transformPointCloud (*model, *rotated_model, rototranslations[i]);
-    instances.push_back (rotated_model);
-}
-
-  /**
-   * ICP
-   */
-   std::vector<pcl::PointCloud<PointType>::ConstPtr> registered_instances;
-   if (true)
+   HypothesisVerifier<PointType> verifier;
+   verifier.set_icp_max_iterations (icp_max_iter_);
+   verifier.set_icp_corr_distance (icp_corr_distance_);
+   verifier.set_hv_inlier_th (hv_inlier_th_);
+   verifier.set_hv_occlusion_th (hv_occlusion_th_);
+   verifier.set_hv_regularizer (hv_regularizer_);
+   verifier.set_hv_rad_clutter (hv_rad_clutter_);
+   verifier.set_hv_clutter_reg (hv_clutter_reg_);
+   verifier.set_hv_detect_clutter (hv_detect_clutter_);
+   verifier.set_hv_rad_normals (hv_rad_normals_);
+   verifier.set_scene_cloud (scene);
+
+   cout << "--- ICP ---------" << endl;
+   verifier.refine (model, rototranslations);
+   const std::vector<pcl::PointCloud<PointType>::ConstPtr> &registered_instances = verifier.get_registered_instances ();
+   const std::vector<bool> &converged = verifier.get_converged ();
+   for (size_t i = 0; i < converged.size (); ++i)
    {
-    cout << "--- ICP ---------" << endl;
-
-    for (size_t i = 0; i < rototranslations.size (); ++i)
-    {
-      pcl::IterativeClosestPoint<PointType, PointType> icp;
-      icp.setMaximumIterations (icp_max_iter_);
-      icp.setMaxCorrespondenceDistance (icp_corr_distance_);
-      icp.setInputTarget (scene);
-      icp.setInputSource (instances[i]);
-      pcl::PointCloud<PointType>::Ptr registered (new pcl::PointCloud<PointType>);
-      icp.align (*registered);
-      registered_instances.push_back (registered);
-      cout << "Instance " << i << " ";
-      if (icp.hasConverged ())
-      {
-        cout << "Aligned!" << endl;
-    }
-    else
-    {
-        cout << "Not Aligned!" << endl;
-    }
+    cout << "Instance " << i << " " << (converged[i] ? "Aligned!" : "Not Aligned!") << endl;
 }
-
 cout << "-----------------" << endl << endl;
-}
 
-  /**
-   * Hypothesis Verification
-   */
    cout << "--- Hypotheses Verification ---" << endl;
   std::vector<bool> hypotheses_mask;  // Mask Vector to identify positive hypotheses
-
-  pcl::GlobalHypothesesVerification<PointType, PointType> GoHv;
-
-  GoHv.setSceneCloud (scene);  // Scene Cloud
-  GoHv.addModels (registered_instances, true);  //Models to verify
-
-  GoHv.setInlierThreshold (hv_inlier_th_);
-  GoHv.setOcclusionThreshold (hv_occlusion_th_);
-  GoHv.setRegularizer (hv_regularizer_);
-  GoHv.setRadiusClutter (hv_rad_clutter_);
-  GoHv.setClutterRegularizer (hv_clutter_reg_);
-  GoHv.setDetectClutter (hv_detect_clutter_);
-  GoHv.setRadiusNormals (hv_rad_normals_);
-
-  GoHv.verify ();
-  GoHv.getMask (hypotheses_mask);  // i-element TRUE if hvModels[i] verifies hypotheses
+  verifier.verify (hypotheses_mask);  // i-element TRUE if registered_instances[i] verifies hypotheses
 
   for (int i = 0; i < hypotheses_mask.size (); i++)
   {
@@ -479,6 +442,18 @@ cout << "-----------------" << endl << endl;
 }
 cout << "-------------------------------" << endl;
 
+  /**
+   * Generates clouds for each instances found, for display only
+   */
+   std::vector<pcl::PointCloud<PointType>::ConstPtr> instances;
+
+   for (size_t i = 0; i < rototranslations.size (); ++i)
+   {
+    pcl::PointCloud<PointType>::Ptr rotated_model (new pcl::PointCloud<PointType> ());
+    pcl::transformPointCloud (*model, *rotated_model, rototranslations[i]);
+    instances.push_back (rotated_model);
+}
+
   /**
    *  Visualization
    */
@@ -0,0 +1,114 @@
+//
+// ICP refinement and global verification of recognition hypotheses; see hypothesis_verifier.h
+//
+
+#include <pcl_recognition/hypothesis_verifier.h>
+#include <pcl/recognition/hv/hv_go.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+template <typename PointT>
+HypothesisVerifier<PointT>::HypothesisVerifier()
+{
+    icp_max_iter_ = 5;
+    icp_corr_distance_ = 0.005;
+    hv_inlier_th_ = 0.005;
+    hv_occlusion_th_ = 0.01;
+    hv_regularizer_ = 3.0;
+    hv_rad_clutter_ = 0.03;
+    hv_clutter_reg_ = 5.0;
+    hv_detect_clutter_ = true;
+    hv_rad_normals_ = 0.05;
+    scene_tree_.reset(new pcl::search::KdTree<PointT>);
+}
+
+template <typename PointT>
+void HypothesisVerifier<PointT>::set_scene_cloud(const typename Cloud::ConstPtr &scene)
+{
+    scene_ = scene;
+    scene_tree_->setInputCloud(scene_);
+}
+
+template <typename PointT>
+int HypothesisVerifier<PointT>::refine(const typename Cloud::ConstPtr &model, const TransformVector &rototranslations)
+{
+    int n = rototranslations.size();
+    registered_instances_.resize(n);
+    refined_transforms_.resize(n);
+    converged_flags_.assign(n, 0);
+    if (!scene_ || n == 0) {
+        converged_.assign(n, false);
+        return 0;
+    }
+
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    while ((int) icp_pool_.size() < nthreads) {
+        icp_pool_.push_back(boost::shared_ptr<pcl::IterativeClosestPoint<PointT, PointT> >(
+                new pcl::IterativeClosestPoint<PointT, PointT>));
+    }
+    while ((int) instance_buffers_.size() < n) {
+        instance_buffers_.push_back(typename Cloud::Ptr(new Cloud));
+    }
+    // every ICP searches the same, already built, scene tree; force_no_recompute keeps setInputTarget from rebuilding it
+    for (int t = 0; t < nthreads; ++t) {
+        pcl::IterativeClosestPoint<PointT, PointT> &icp = *icp_pool_[t];
+        icp.setMaximumIterations(icp_max_iter_);
+        icp.setMaxCorrespondenceDistance(icp_corr_distance_);
+        icp.setSearchMethodTarget(scene_tree_, true);
+        icp.setInputTarget(scene_);
+        icp.setInputSource(model);
+    }
+
+    // hypotheses are independent, but ICP run times vary, so hand them out one at a time
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < n; ++i) {
+        int t = 0;
+#ifdef _OPENMP
+        t = omp_get_thread_num();
+#endif
+        pcl::IterativeClosestPoint<PointT, PointT> &icp = *icp_pool_[t];
+        // the model is the source and the hypothesis the initial guess, so align() writes the transformed, refined model
+        icp.align(*instance_buffers_[i], rototranslations[i]);
+        refined_transforms_[i] = icp.getFinalTransformation();
+        converged_flags_[i] = icp.hasConverged() ? 1 : 0;
+        registered_instances_[i] = instance_buffers_[i];
+    }
+
+    int nconverged = 0;
+    converged_.resize(n);
+    for (int i = 0; i < n; ++i) {
+        converged_[i] = (converged_flags_[i] != 0);
+        if (converged_[i]) nconverged++;
+    }
+    return nconverged;
+}
+
+template <typename PointT>
+bool HypothesisVerifier<PointT>::verify(std::vector<bool> &mask)
+{
+    mask.clear();
+    if (!scene_ || registered_instances_.empty()) return false;
+
+    pcl::GlobalHypothesesVerification<PointT, PointT> GoHv;
+    GoHv.setSceneCloud(scene_);
+    GoHv.addModels(registered_instances_, true);
+
+    GoHv.setInlierThreshold(hv_inlier_th_);
+    GoHv.setOcclusionThreshold(hv_occlusion_th_);
+    GoHv.setRegularizer(hv_regularizer_);
+    GoHv.setRadiusClutter(hv_rad_clutter_);
+    GoHv.setClutterRegularizer(hv_clutter_reg_);
+    GoHv.setDetectClutter(hv_detect_clutter_);
+    GoHv.setRadiusNormals(hv_rad_normals_);
+
+    GoHv.verify();
+    GoHv.getMask(mask);  // i-element TRUE if registered_instances_[i] verifies
+    return true;
+}
+
+template class HypothesisVerifier<pcl::PointXYZRGB>;
+template class HypothesisVerifier<pcl::PointXYZRGBA>;
@@ -0,0 +1,111 @@
+//
+// Frame-to-frame ICP pose tracking, coarse to fine; see icp_tracker.h
+//
+
+#include <pcl_recognition/icp_tracker.h>
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/console/time.h>   // TicToc
+
+IcpTracker::IcpTracker()
+{
+    pose_ = Eigen::Matrix4f::Identity();
+    iterations_ = 0;
+    fitness_ = 0.0;
+    time_ms_ = 0.0;
+}
+
+void IcpTracker::add_level(double voxel_size, int max_iterations, double max_corr_distance)
+{
+    Level level;
+    level.voxel_size = voxel_size;
+    level.max_iterations = max_iterations;
+    level.max_corr_distance = max_corr_distance;
+    level.source.reset(new Cloud);
+    level.icp.reset(new CountingIcp);
+    levels_.push_back(level);
+    if (target_) prepare_level(levels_.back());
+}
+
+void IcpTracker::clear_levels()
+{
+    levels_.clear();
+}
+
+void IcpTracker::downsample(const Cloud::ConstPtr &input, double voxel_size, Cloud &output) const
+{
+    pcl::VoxelGrid<PointT> voxel_grid;
+    voxel_grid.setInputCloud(input);
+    voxel_grid.setLeafSize(voxel_size, voxel_size, voxel_size);
+    voxel_grid.filter(output);
+}
+
+// build this level's target and its search tree, and bind them to the level's ICP
+void IcpTracker::prepare_level(Level &level)
+{
+    if (level.voxel_size > 0.0) {
+        Cloud::Ptr downsampled(new Cloud);
+        downsample(target_, level.voxel_size, *downsampled);
+        level.target = downsampled;
+    } else {
+        level.target = target_;
+    }
+    level.target_tree.reset(new pcl::search::KdTree<PointT>);
+    level.target_tree->setInputCloud(level.target);
+    // force_no_recompute: setInputTarget must not rebuild the tree
+    level.icp->setSearchMethodTarget(level.target_tree, true);
+    level.icp->setInputTarget(level.target);
+    level.icp->setMaximumIterations(level.max_iterations);
+    level.icp->setMaxCorrespondenceDistance(level.max_corr_distance);
+}
+
+void IcpTracker::set_target(const Cloud::ConstPtr &target)
+{
+    target_ = target;
+    if (levels_.empty()) {
+        add_level(0.01, 10, 0.05);  // prepares the level, since the target is now set
+        add_level(0.0, 3, 0.01);
+        return;
+    }
+    for (size_t i = 0; i < levels_.size(); ++i) {
+        prepare_level(levels_[i]);
+    }
+}
+
+bool IcpTracker::track(const Cloud::ConstPtr &source, Cloud &aligned)
+{
+    pcl::console::TicToc time;
+    time.tic();
+    iterations_ = 0;
+    fitness_ = 0.0;
+    if (!target_ || !source || source->empty()) {
+        time_ms_ = time.toc();
+        return false;
+    }
+
+    Eigen::Matrix4f guess = pose_;
+    bool converged = false;
+    int nlevels = levels_.size();
+    for (int i = 0; i < nlevels; ++i) {
+        Level &level = levels_[i];
+        if (level.voxel_size > 0.0) {
+            downsample(source, level.voxel_size, *level.source);
+            level.icp->setInputSource(level.source);
+        } else {
+            level.icp->setInputSource(source);
+        }
+        // only the last level's output is needed; the others go to a scratch buffer
+        Cloud &output = (i == nlevels - 1) ? aligned : aligned_coarse_;
+        level.icp->align(output, guess);
+        iterations_ += level.icp->get_iterations();
+        converged = level.icp->hasConverged();
+        if (converged) guess = level.icp->getFinalTransformation();
+    }
+    if (converged) {
+        // mean squared distance of inliers, measured with the final level's tree and correspondence distance
+        const Level &last = levels_.back();
+        fitness_ = last.icp->getFitnessScore(last.max_corr_distance * last.max_corr_distance);
+        pose_ = guess;
+    }
+    time_ms_ = time.toc();
+    return converged;
+}
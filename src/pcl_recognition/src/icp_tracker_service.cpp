@@ -0,0 +1,105 @@
+/* ICP tracking service: refines the pose of a part that moves a little between frames.
+   Each request aligns a source cloud to the target, starting from the pose found by the previous request,
+   coarse to fine (see icp_tracker.h).  The target may be loaded once from a pcd/ply file given on the
+   command line, or sent with a request; its search trees are reused until a new target arrives.
+   usage: rosrun pcl_recognition icp_tracker_service [target.pcd]
+   */
+
+#include <ros/ros.h>
+#include <pcl/io/pcd_io.h>
+#include <pcl/io/ply_io.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <pcl_recognition/icp_tracker.h>
+#include <pcl_recognition/IcpTrack.h>
+
+IcpTracker g_tracker;
+IcpTracker::Cloud::Ptr g_source(new IcpTracker::Cloud);
+IcpTracker::Cloud g_aligned;
+
+Eigen::Matrix4f pose_to_matrix(const geometry_msgs::Pose &pose) {
+    Eigen::Quaternionf q(pose.orientation.w, pose.orientation.x, pose.orientation.y, pose.orientation.z);
+    Eigen::Matrix4f matrix = Eigen::Matrix4f::Identity();
+    if (q.norm() > 0.0) matrix.block<3, 3>(0, 0) = q.normalized().toRotationMatrix();
+    matrix(0, 3) = pose.position.x;
+    matrix(1, 3) = pose.position.y;
+    matrix(2, 3) = pose.position.z;
+    return matrix;
+}
+
+geometry_msgs::Pose matrix_to_pose(const Eigen::Matrix4f &matrix) {
+    Eigen::Matrix3f rotation = matrix.block<3, 3>(0, 0);
+    Eigen::Quaternionf q(rotation);
+    geometry_msgs::Pose pose;
+    pose.position.x = matrix(0, 3);
+    pose.position.y = matrix(1, 3);
+    pose.position.z = matrix(2, 3);
+    pose.orientation.x = q.x();
+    pose.orientation.y = q.y();
+    pose.orientation.z = q.z();
+    pose.orientation.w = q.w();
+    return pose;
+}
+
+bool track_callback(pcl_recognition::IcpTrackRequest& request, pcl_recognition::IcpTrackResponse& response) {
+    response.target_tree_reused = true;
+    if (request.target.width * request.target.height > 0) {
+        IcpTracker::Cloud::Ptr target(new IcpTracker::Cloud);
+        pcl::fromROSMsg(request.target, *target);
+        g_tracker.set_target(target);
+        response.target_tree_reused = false;
+        ROS_INFO("new target: %d points", (int) target->size());
+    }
+    if (!g_tracker.has_target()) {
+        ROS_WARN("no target; provide one in the request or on the command line");
+        response.converged = false;
+        return true;
+    }
+    if (request.reset) {
+        g_tracker.set_pose(pose_to_matrix(request.initial_guess));
+    }
+    pcl::fromROSMsg(request.source, *g_source);
+
+    response.converged = g_tracker.track(g_source, g_aligned);
+    response.pose = matrix_to_pose(g_tracker.get_pose());
+    response.iterations = g_tracker.get_iterations();
+    response.fitness = g_tracker.get_fitness();
+    response.time_ms = g_tracker.get_time_ms();
+    ROS_INFO("%s: %d iterations, fitness %g, %.1f ms", response.converged ? "converged" : "NOT converged",
+            response.iterations, response.fitness, response.time_ms);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    ros::init(argc, argv, "icp_tracker_service");
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+
+    // schedule: coarse iterations on a voxel grid, then a few at full resolution
+    double coarse_voxel_size, coarse_corr_distance, fine_corr_distance;
+    int coarse_iterations, fine_iterations;
+    nh_private.param("coarse_voxel_size", coarse_voxel_size, 0.01);
+    nh_private.param("coarse_iterations", coarse_iterations, 10);
+    nh_private.param("coarse_corr_distance", coarse_corr_distance, 0.05);
+    nh_private.param("fine_iterations", fine_iterations, 3);
+    nh_private.param("fine_corr_distance", fine_corr_distance, 0.01);
+    if (coarse_iterations > 0) g_tracker.add_level(coarse_voxel_size, coarse_iterations, coarse_corr_distance);
+    g_tracker.add_level(0.0, fine_iterations, fine_corr_distance);
+
+    if (argc > 1) {
+        std::string fname(argv[1]);
+        IcpTracker::Cloud::Ptr target(new IcpTracker::Cloud);
+        bool is_ply = fname.size() > 4 && fname.compare(fname.size() - 4, 4, ".ply") == 0;
+        int ret = is_ply ? pcl::io::loadPLYFile(fname, *target) : pcl::io::loadPCDFile(fname, *target);
+        if (ret < 0) {
+            ROS_ERROR("error loading target %s", fname.c_str());
+            return 1;
+        }
+        g_tracker.set_target(target);
+        ROS_INFO("loaded target %s: %d points", fname.c_str(), (int) target->size());
+    }
+
+    ros::ServiceServer service = nh.advertiseService("icp_track", track_callback);
+    ROS_INFO("ready to track, on service icp_track");
+    ros::spin();
+    return 0;
+}
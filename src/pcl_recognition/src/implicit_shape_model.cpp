@@ -1,109 +1,93 @@
+/* implicit shape model recognizer: loads a model trained offline by ism_train, once, then finds objects of
+   the given class in each cloud.
+   usage: rosrun pcl_recognition implicit_shape_model model_file.txt class_id [test.pcd]
+   with a test.pcd, the result is shown in a viewer; otherwise clouds arriving on topic "ism_cloud" are
+   searched, and the peaks (candidate object centers) are published on topic "ism_peaks"
+   */
+
 #include <iostream>
+#include <stdlib.h>
+#include <ros/ros.h>
+#include <pcl_ros/point_cloud.h>
 #include <pcl/io/pcd_io.h>
-#include <pcl/features/normal_3d.h>
-#include <pcl/features/feature.h>
+#include <pcl/console/time.h>   // TicToc
 #include <pcl/visualization/cloud_viewer.h>
-#include <pcl/features/fpfh.h>
-#include <pcl/features/impl/fpfh.hpp>
-#include <pcl/recognition/implicit_shape_model.h>
-#include <pcl/recognition/impl/implicit_shape_model.hpp>
+#include <pcl_recognition/ism_recognizer.h>
+
+IsmRecognizer g_recognizer;
+int g_class_id;
+ros::Publisher g_peaks_pub;
+
+void
+find_objects (const IsmRecognizer::Cloud::ConstPtr &cloud, IsmRecognizer::PeakVector &peaks)
+{
+	pcl::console::TicToc time;
+	time.tic ();
+	g_recognizer.find_objects (cloud, g_class_id, peaks);
+	ROS_INFO ("class %d: %d peaks from %d votes, in %.1f ms", g_class_id, (int) peaks.size (),
+		(int) g_recognizer.get_votes ()->size (), time.toc ());
+	for (size_t i_peak = 0; i_peak < peaks.size (); i_peak++)
+		ROS_INFO ("  peak at (%f, %f, %f), density %f", peaks[i_peak].x, peaks[i_peak].y, peaks[i_peak].z, peaks[i_peak].density);
+}
+
+void
+cloud_callback (const IsmRecognizer::Cloud::ConstPtr &cloud)
+{
+	IsmRecognizer::PeakVector peaks;
+	find_objects (cloud, peaks);
+
+	pcl::PointCloud<pcl::PointXYZ> peak_cloud;
+	for (size_t i_peak = 0; i_peak < peaks.size (); i_peak++)
+		peak_cloud.points.push_back (pcl::PointXYZ (peaks[i_peak].x, peaks[i_peak].y, peaks[i_peak].z));
+	peak_cloud.width = peak_cloud.points.size ();
+	peak_cloud.height = 1;
+	peak_cloud.header = cloud->header;
+	g_peaks_pub.publish (peak_cloud);
+}
 
 int
 main (int argc, char** argv)
 {
-	if (argc == 0 || argc % 2 == 0)
+	ros::init (argc, argv, "implicit_shape_model");
+	ros::NodeHandle nh;
+	if (argc < 3)
+	{
+		std::cout << "usage: " << argv[0] << " model_file.txt class_id [test.pcd]" << std::endl;
 		return (-1);
+	}
 
-	unsigned int number_of_training_clouds = (argc - 3) / 2;
-
-	pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> normal_estimator;
-	normal_estimator.setRadiusSearch (25.0);
-
-	std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> training_clouds;
-	std::vector<pcl::PointCloud<pcl::Normal>::Ptr> training_normals;
-	std::vector<unsigned int> training_classes;
-
-	for (unsigned int i_cloud = 0; i_cloud < number_of_training_clouds - 1; i_cloud++)
+	if (!g_recognizer.load_model (argv[1]))
 	{
-		pcl::PointCloud<pcl::PointXYZ>::Ptr tr_cloud(new pcl::PointCloud<pcl::PointXYZ> ());
-		if ( pcl::io::loadPCDFile <pcl::PointXYZ> (argv[i_cloud * 2 + 1], *tr_cloud) == -1 )
-			return (-1);
-
-		pcl::PointCloud<pcl::Normal>::Ptr tr_normals = (new pcl::PointCloud<pcl::Normal>)->makeShared ();
-		normal_estimator.setInputCloud (tr_cloud);
-		normal_estimator.compute (*tr_normals);
-
-		unsigned int tr_class = static_cast<unsigned int> (strtol (argv[i_cloud * 2 + 2], 0, 10));
-
-		training_clouds.push_back (tr_cloud);
-		training_normals.push_back (tr_normals);
-		training_classes.push_back (tr_class);
+		std::cout << "error loading model " << argv[1] << std::endl;
+		return (-1);
 	}
-
-	pcl::FPFHEstimation<pcl::PointXYZ, pcl::Normal, pcl::Histogram<153> >::Ptr fpfh
-		(new pcl::FPFHEstimation<pcl::PointXYZ, pcl::Normal, pcl::Histogram<153> >);
-	fpfh->setRadiusSearch (30.0);
-	pcl::Feature< pcl::PointXYZ, pcl::Histogram<153> >::Ptr feature_estimator(fpfh);
-
-	pcl::ism::ImplicitShapeModelEstimation<153, pcl::PointXYZ, pcl::Normal> ism;
-	ism.setFeatureEstimator(feature_estimator);
-	ism.setTrainingClouds (training_clouds);
-	ism.setTrainingNormals (training_normals);
-	ism.setTrainingClasses (training_classes);
-	ism.setSamplingSize (2.0f);
-
-	pcl::ism::ImplicitShapeModelEstimation<153, pcl::PointXYZ, pcl::Normal>::ISMModelPtr model = boost::shared_ptr<pcl::features::ISMModel>
-		(new pcl::features::ISMModel);
-	ism.trainISM (model);
-
-	std::string file ("trained_ism_model.txt");
-	model->saveModelToFile (file);
-
-	model->loadModelFromfile (file);
-
-	unsigned int testing_class = static_cast<unsigned int> (strtol (argv[argc - 1], 0, 10));
-	pcl::PointCloud<pcl::PointXYZ>::Ptr testing_cloud (new pcl::PointCloud<pcl::PointXYZ> ());
-	if ( pcl::io::loadPCDFile <pcl::PointXYZ> (argv[argc - 2], *testing_cloud) == -1 )
+	g_class_id = static_cast<int> (strtol (argv[2], 0, 10));
+	if (g_class_id < 0 || g_class_id >= g_recognizer.get_num_classes ())
+	{
+		std::cout << "class_id must be in 0.." << g_recognizer.get_num_classes () - 1 << std::endl;
 		return (-1);
+	}
 
-	pcl::PointCloud<pcl::Normal>::Ptr testing_normals = (new pcl::PointCloud<pcl::Normal>)->makeShared ();
-	normal_estimator.setInputCloud (testing_cloud);
-	normal_estimator.compute (*testing_normals);
+	if (argc < 4)
+	{
+		g_peaks_pub = nh.advertise<pcl::PointCloud<pcl::PointXYZ> > ("ism_peaks", 1);
+		ros::Subscriber cloud_sub = nh.subscribe ("ism_cloud", 1, cloud_callback);
+		ROS_INFO ("waiting for clouds on topic ism_cloud");
+		ros::spin ();
+		return (0);
+	}
 
-	boost::shared_ptr<pcl::features::ISMVoteList<pcl::PointXYZ> > vote_list = ism.findObjects (
-		model,
-		testing_cloud,
-		testing_normals,
-		testing_class);
+	IsmRecognizer::Cloud::Ptr testing_cloud (new IsmRecognizer::Cloud ());
+	if ( pcl::io::loadPCDFile <pcl::PointXYZ> (argv[3], *testing_cloud) == -1 )
+		return (-1);
 
-	double radius = model->sigmas_[testing_class] * 10.0;
-	double sigma = model->sigmas_[testing_class];
-	std::vector<pcl::ISMPeak, Eigen::aligned_allocator<pcl::ISMPeak> > strongest_peaks;
-	vote_list->findStrongestPeaks (strongest_peaks, testing_class, radius, sigma);
+	IsmRecognizer::PeakVector strongest_peaks;
+	find_objects (testing_cloud, strongest_peaks);
 
 	pcl::PointCloud <pcl::PointXYZRGB>::Ptr colored_cloud = (new pcl::PointCloud<pcl::PointXYZRGB>)->makeShared ();
-
-	colored_cloud->height = 0;
-	colored_cloud->width = 1;
+	g_recognizer.get_colored_cloud (*testing_cloud, *colored_cloud);
 
 	pcl::PointXYZRGB point;
-
-	/*
-	point.r = 255;
-	point.g = 255;
-	point.b = 255;
-
-	for (size_t i_point = 0; i_point < testing_cloud->points.size (); i_point++)
-	{
-		point.x = testing_cloud->points[i_point].x;
-		point.y = testing_cloud->points[i_point].y;
-		point.z = testing_cloud->points[i_point].z;
-		colored_cloud->points.push_back (point);
-	}
-	colored_cloud->height += testing_cloud->points.size ();
-*/
-	colored_cloud = vote_list->getColoredCloud(testing_cloud);
-
 	point.r = 255;
 	point.g = 0;
 	point.b = 0;
@@ -114,7 +98,7 @@ main (int argc, char** argv)
 		point.z = strongest_peaks[i_vote].z;
 		colored_cloud->points.push_back (point);
 	}
-	colored_cloud->height += strongest_peaks.size ();
+	colored_cloud->width = colored_cloud->points.size ();
 
 	pcl::visualization::CloudViewer viewer ("Result viewer");
 	viewer.showCloud (colored_cloud);
@@ -123,4 +107,4 @@ main (int argc, char** argv)
 	}
 
 	return (0);
-}
\ No newline at end of file
+}
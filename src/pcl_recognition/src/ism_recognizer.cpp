@@ -0,0 +1,248 @@
+//
+// Implicit shape model training and recognition; see ism_recognizer.h
+//
+
+#include <pcl_recognition/ism_recognizer.h>
+#include <pcl/features/normal_3d_omp.h>
+#include <pcl/features/fpfh_omp.h>
+#include <pcl/features/impl/fpfh.hpp>
+#include <pcl/features/impl/fpfh_omp.hpp>
+#include <pcl/recognition/impl/implicit_shape_model.hpp>
+#include <limits>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+IsmRecognizer::IsmRecognizer()
+{
+    normal_radius_ = 25.0;
+    feature_radius_ = 30.0;
+    sampling_size_ = 2.0f;
+    have_model_ = false;
+    model_.reset(new pcl::features::ISMModel);
+    sampled_cloud_.reset(new Cloud);
+    normals_.reset(new pcl::PointCloud<pcl::Normal>);
+    sampled_normals_.reset(new pcl::PointCloud<pcl::Normal>);
+    features_.reset(new pcl::PointCloud<FeatureType>);
+    votes_.reset(new Cloud);
+}
+
+void IsmRecognizer::configure(Estimator &estimator)
+{
+    pcl::FPFHEstimationOMP<pcl::PointXYZ, pcl::Normal, FeatureType>::Ptr fpfh
+            (new pcl::FPFHEstimationOMP<pcl::PointXYZ, pcl::Normal, FeatureType>);
+    fpfh->setRadiusSearch(feature_radius_);
+    pcl::Feature<pcl::PointXYZ, FeatureType>::Ptr feature_estimator(fpfh);
+    estimator.setFeatureEstimator(feature_estimator);
+    estimator.setSamplingSize(sampling_size_);
+}
+
+void IsmRecognizer::compute_normals(const Cloud::ConstPtr &cloud, pcl::PointCloud<pcl::Normal> &normals) const
+{
+    pcl::NormalEstimationOMP<pcl::PointXYZ, pcl::Normal> normal_estimator;
+    normal_estimator.setRadiusSearch(normal_radius_);
+    normal_estimator.setInputCloud(cloud);
+    normal_estimator.compute(normals);
+}
+
+bool IsmRecognizer::train(const std::vector<Cloud::Ptr> &clouds, const std::vector<unsigned int> &classes, const std::string &filename)
+{
+    if (clouds.empty() || clouds.size() != classes.size()) return false;
+    std::vector<pcl::PointCloud<pcl::Normal>::Ptr> normals(clouds.size());
+    for (size_t i = 0; i < clouds.size(); ++i) {
+        normals[i].reset(new pcl::PointCloud<pcl::Normal>);
+        compute_normals(clouds[i], *normals[i]);
+    }
+
+    Estimator ism;
+    configure(ism);
+    ism.setTrainingClouds(clouds);
+    ism.setTrainingNormals(normals);
+    ism.setTrainingClasses(classes);
+    if (!ism.trainISM(model_)) return false;
+    have_model_ = true;
+    return model_->saveModelToFile(const_cast<std::string &>(filename));
+}
+
+bool IsmRecognizer::load_model(const std::string &filename)
+{
+    model_.reset(new pcl::features::ISMModel);
+    have_model_ = model_->loadModelFromfile(const_cast<std::string &>(filename));
+    if (have_model_) configure(estimator_);
+    return have_model_;
+}
+
+bool IsmRecognizer::find_objects(const Cloud::ConstPtr &cloud, int class_id, PeakVector &peaks)
+{
+    peaks.clear();
+    votes_->clear();
+    vote_strengths_.clear();
+    if (!have_model_ || class_id < 0 || class_id >= (int) model_->number_of_classes_) return false;
+    if (!cloud || cloud->empty()) return false;
+
+    compute_normals(cloud, *normals_);
+    estimator_.sample(cloud, normals_, sampled_cloud_, sampled_normals_);
+    if (sampled_cloud_->empty()) return true;
+    estimator_.features(sampled_cloud_, sampled_normals_, features_);
+
+    cast_votes(*sampled_cloud_, *sampled_normals_, *features_, class_id);
+    double sigma = model_->sigmas_[class_id];
+    find_peaks(class_id, sigma, 10.0 * sigma, peaks);
+    return true;
+}
+
+// each keypoint's feature selects its nearest codebook cluster; every word of that cluster that belongs to
+// class_id casts a vote for the object center
+void IsmRecognizer::cast_votes(const Cloud &sampled_cloud, const pcl::PointCloud<pcl::Normal> &sampled_normals,
+                               const pcl::PointCloud<FeatureType> &features, int class_id)
+{
+    const int n_key_points = sampled_cloud.size();
+    const int n_clusters = model_->number_of_clusters_;
+    const int n_dims = model_->descriptors_dimension_;
+
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    std::vector<Cloud::VectorType> thread_votes(nthreads);
+    std::vector<std::vector<float> > thread_strengths(nthreads);
+
+#pragma omp parallel
+    {
+        int t = 0;
+#ifdef _OPENMP
+        t = omp_get_thread_num();
+#endif
+        Eigen::VectorXf descriptor(n_dims);
+#pragma omp for schedule(static)
+        for (int i = 0; i < n_key_points; ++i) {
+            for (int d = 0; d < n_dims; ++d) descriptor[d] = features.points[i].histogram[d];
+            if (descriptor.sum() < std::numeric_limits<float>::epsilon()) continue;
+            int best = 0;
+            float best_dist = std::numeric_limits<float>::max();
+            for (int c = 0; c < n_clusters; ++c) {
+                float dist = (descriptor - model_->clusters_centers_.row(c).transpose()).squaredNorm();
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = c;
+                }
+            }
+
+            Eigen::Matrix3f frame_transpose = estimator_.normal_frame(sampled_normals.points[i]).transpose();
+            Eigen::Vector3f key_point = sampled_cloud.points[i].getVector3fMap();
+            float statistical_weight = model_->statistical_weights_[class_id][best];
+            const std::vector<unsigned int> &words = model_->clusters_[best];
+            for (size_t w = 0; w < words.size(); ++w) {
+                unsigned int index = words[w];
+                if ((int) model_->classes_[index] != class_id) continue;
+                Eigen::Vector3f direction(model_->directions_to_center_(index, 0),
+                                          model_->directions_to_center_(index, 1),
+                                          model_->directions_to_center_(index, 2));
+                float strength = statistical_weight * model_->learned_weights_[index];
+                if (strength <= std::numeric_limits<float>::epsilon()) continue;
+                Eigen::Vector3f vote = key_point + frame_transpose * direction;
+                thread_votes[t].push_back(pcl::PointXYZ(vote[0], vote[1], vote[2]));
+                thread_strengths[t].push_back(strength);
+            }
+        }
+    }
+
+    // merge in thread order; with the static schedule the vote order is that of a serial pass
+    for (int t = 0; t < nthreads; ++t) {
+        votes_->points.insert(votes_->points.end(), thread_votes[t].begin(), thread_votes[t].end());
+        vote_strengths_.insert(vote_strengths_.end(), thread_strengths[t].begin(), thread_strengths[t].end());
+    }
+    votes_->width = votes_->points.size();
+    votes_->height = 1;
+    votes_->is_dense = true;
+}
+
+// one mean-shift step with a Gaussian kernel; returns the density at center (0 if no votes are near)
+double IsmRecognizer::shift_mean(const Eigen::Vector3f &center, double sigma, Eigen::Vector3f &shifted) const
+{
+    std::vector<int> indices;
+    std::vector<float> sq_dists;
+    pcl::PointXYZ pt(center[0], center[1], center[2]);
+    int n = vote_tree_.radiusSearch(pt, 3.0 * sigma, indices, sq_dists);
+    Eigen::Vector3f weighted_sum = Eigen::Vector3f::Zero();
+    double density = 0.0;
+    for (int j = 0; j < n; ++j) {
+        double kernel = vote_strengths_[indices[j]] * exp(-sq_dists[j] / (sigma * sigma));
+        weighted_sum += votes_->points[indices[j]].getVector3fMap() * static_cast<float>(kernel);
+        density += kernel;
+    }
+    shifted = (density > 0.0) ? Eigen::Vector3f(weighted_sum / static_cast<float>(density)) : center;
+    return density;
+}
+
+// mean shift from starting points spread over the votes, then greedy non-maxima suppression
+void IsmRecognizer::find_peaks(int class_id, double sigma, double non_maxima_radius, PeakVector &peaks)
+{
+    const int n_votes = votes_->size();
+    if (n_votes == 0) return;
+    vote_tree_.setInputCloud(votes_);
+
+    const int NUM_INIT_PTS = 100;
+    const double FINAL_EPS = sigma / 100.0;
+    const int MAX_SHIFTS = 100;
+    std::vector<Eigen::Vector3f, Eigen::aligned_allocator<Eigen::Vector3f> > centers(NUM_INIT_PTS);
+    std::vector<double> densities(NUM_INIT_PTS);
+
+    // the searches are independent, and their lengths vary
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < NUM_INIT_PTS; ++i) {
+        Eigen::Vector3f center = votes_->points[(long) n_votes * i / NUM_INIT_PTS].getVector3fMap();
+        Eigen::Vector3f shifted;
+        for (int k = 0; k < MAX_SHIFTS; ++k) {
+            shift_mean(center, sigma, shifted);
+            bool done = (shifted - center).norm() <= FINAL_EPS;
+            center = shifted;
+            if (done) break;
+        }
+        centers[i] = center;
+        densities[i] = shift_mean(center, sigma, shifted);
+    }
+
+    std::vector<bool> available(NUM_INIT_PTS, true);
+    while (true) {
+        int best = -1;
+        for (int i = 0; i < NUM_INIT_PTS; ++i) {
+            if (available[i] && (best < 0 || densities[i] > densities[best])) best = i;
+        }
+        if (best < 0) break;
+        pcl::ISMPeak peak;
+        peak.x = centers[best][0];
+        peak.y = centers[best][1];
+        peak.z = centers[best][2];
+        peak.density = densities[best];
+        peak.class_id = class_id;
+        peaks.push_back(peak);
+        available[best] = false;
+        for (int i = 0; i < NUM_INIT_PTS; ++i) {
+            if (available[i] && (centers[best] - centers[i]).norm() < non_maxima_radius) available[i] = false;
+        }
+    }
+}
+
+void IsmRecognizer::get_colored_cloud(const Cloud &cloud, pcl::PointCloud<pcl::PointXYZRGB> &colored) const
+{
+    colored.clear();
+    colored.points.reserve(cloud.size() + votes_->size());
+    pcl::PointXYZRGB point;
+    point.r = 255;
+    point.g = 255;
+    point.b = 255;
+    for (size_t i = 0; i < cloud.size(); ++i) {
+        point.getVector3fMap() = cloud.points[i].getVector3fMap();
+        colored.points.push_back(point);
+    }
+    point.g = 0;
+    point.b = 0;
+    for (size_t i = 0; i < votes_->size(); ++i) {
+        point.getVector3fMap() = votes_->points[i].getVector3fMap();
+        colored.points.push_back(point);
+    }
+    colored.width = colored.points.size();
+    colored.height = 1;
+}
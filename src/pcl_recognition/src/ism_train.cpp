@@ -0,0 +1,46 @@
+/* offline training for the implicit shape model recognizer: trains a model from labeled clouds and saves it,
+   so the recognizer (implicit_shape_model) need only load it
+   usage: rosrun pcl_recognition ism_train model_file.txt train_1.pcd class_1 [train_2.pcd class_2 ...]
+   */
+
+#include <iostream>
+#include <stdlib.h>
+#include <pcl/io/pcd_io.h>
+#include <pcl/console/time.h>   // TicToc
+#include <pcl_recognition/ism_recognizer.h>
+
+int
+main (int argc, char** argv)
+{
+	if (argc < 4 || argc % 2 != 0)
+	{
+		std::cout << "usage: " << argv[0] << " model_file.txt train_1.pcd class_1 [train_2.pcd class_2 ...]" << std::endl;
+		return (-1);
+	}
+	std::string model_file (argv[1]);
+
+	std::vector<IsmRecognizer::Cloud::Ptr> training_clouds;
+	std::vector<unsigned int> training_classes;
+	for (int i_arg = 2; i_arg < argc; i_arg += 2)
+	{
+		IsmRecognizer::Cloud::Ptr tr_cloud (new IsmRecognizer::Cloud ());
+		if ( pcl::io::loadPCDFile <pcl::PointXYZ> (argv[i_arg], *tr_cloud) == -1 )
+		{
+			std::cout << "error loading " << argv[i_arg] << std::endl;
+			return (-1);
+		}
+		training_clouds.push_back (tr_cloud);
+		training_classes.push_back (static_cast<unsigned int> (strtol (argv[i_arg + 1], 0, 10)));
+	}
+
+	pcl::console::TicToc time;
+	time.tic ();
+	IsmRecognizer recognizer;
+	if (!recognizer.train (training_clouds, training_classes, model_file))
+	{
+		std::cout << "training failed" << std::endl;
+		return (-1);
+	}
+	std::cout << "trained on " << training_clouds.size () << " clouds in " << time.toc () << " ms; saved model to " << model_file << std::endl;
+	return (0);
+}
@@ -2,16 +2,69 @@
 
 #include <pcl_recognition/pcl_recognition.h>
 
-const double DISTANCE_TOLERANCE = pow(0.002, 2);
+const double DISTANCE_TOLERANCE = 0.002; //selected points match snapshot points within this distance (m)
 
 bool display_kinect = false;
 sensor_msgs::PointCloud2 ros_cloud;
 pcl::PointCloud<pcl::PointXYZRGB>::Ptr pclKinect_clr_ptr(new pcl::PointCloud<pcl::PointXYZRGB>); //pointer for color version of pointcloud
 pcl::PointCloud<pcl::PointXYZ>::Ptr pclSelected_ptr(new pcl::PointCloud<pcl::PointXYZ>); //pointer for color version of pointcloud
 pcl::PointCloud<pcl::PointXYZRGB>::Ptr pclEditing_ptr(new pcl::PointCloud<pcl::PointXYZRGB>); //pointer for color version of pointcloud
-pcl::PointCloud<pcl::PointXYZRGB>::Ptr temp_ptr(new pcl::PointCloud<pcl::PointXYZRGB>); //pointer for color version of pointcloud
 ros::Publisher pubCloud;
 
+//spatial index over the current kinect snapshot, built once per snapshot;
+//the editing cloud is kept as a set of snapshot indices, so add/delete/dedupe are index operations
+pcl::KdTreeFLANN<pcl::PointXYZRGB> snapshot_kdtree;
+vector<bool> in_editing_cloud; //one flag per snapshot point
+vector<int> nn_indices; //scratch buffers for kdtree queries
+vector<float> nn_sqr_dists;
+
+void index_snapshot() {
+    snapshot_kdtree.setInputCloud(pclKinect_clr_ptr);
+    in_editing_cloud.assign(pclKinect_clr_ptr->points.size(), false);
+}
+
+pcl::PointXYZRGB to_query_point(const pcl::PointXYZ &pt) {
+    pcl::PointXYZRGB query;
+    query.x = pt.x;
+    query.y = pt.y;
+    query.z = pt.z;
+    return query;
+}
+
+//flag the snapshot point nearest each selected point (if within tolerance); a point already in the cloud stays there once
+void add_selected_points() {
+    const double tol_sqr = DISTANCE_TOLERANCE * DISTANCE_TOLERANCE;
+    for (int i = 0; i < pclSelected_ptr->points.size(); ++i) {
+        if (snapshot_kdtree.nearestKSearch(to_query_point(pclSelected_ptr->points[i]), 1, nn_indices, nn_sqr_dists) > 0
+                && nn_sqr_dists[0] < tol_sqr) {
+            in_editing_cloud[nn_indices[0]] = true;
+        }
+    }
+}
+
+//unflag every snapshot point within tolerance of a selected point
+void delete_selected_points() {
+    for (int i = 0; i < pclSelected_ptr->points.size(); ++i) {
+        int nfound = snapshot_kdtree.radiusSearch(to_query_point(pclSelected_ptr->points[i]), DISTANCE_TOLERANCE,
+                nn_indices, nn_sqr_dists);
+        for (int k = 0; k < nfound; ++k) {
+            in_editing_cloud[nn_indices[k]] = false;
+        }
+    }
+}
+
+//regenerate the editing cloud from the flags, and save it
+void update_editing_cloud(const char* fname) {
+    pclEditing_ptr->points.clear();
+    for (int j = 0; j < in_editing_cloud.size(); ++j) {
+        if (in_editing_cloud[j]) pclEditing_ptr->points.push_back(pclKinect_clr_ptr->points[j]);
+    }
+    pclEditing_ptr->width = pclEditing_ptr->points.size();
+    pclEditing_ptr->height = 1;
+    ROS_INFO("snapshot with points %d; saving to file %s", (int)pclEditing_ptr->points.size(), fname);
+    pcl::io::savePCDFile(fname, *pclEditing_ptr, true);
+}
+
 void timerCallback(const ros::TimerEvent&)
 {
     if (display_kinect) {
@@ -43,30 +96,19 @@ int main(int argc, char** argv) {
         ros::Duration(0.1).sleep();
     }
     utils.get_kinect_points(pclKinect_clr_ptr);
+    index_snapshot();
     display_kinect = true;
     ros::spinOnce();
     ROS_INFO("Please select point cloud in \'/camera/depth_registered/points\' topic using \'Publish Selected points\'");
 
-    double x, y, z;
     while (!utils.got_selected_points()) {
         ros::spinOnce();
         ros::Duration(0.1).sleep();
     }
     utils.reset_got_selected_points();
     utils.get_selected_points(pclSelected_ptr);
-    for (int i = 0; i < pclSelected_ptr->points.size(); ++i) {
-        for (int j = 0; j < pclKinect_clr_ptr->points.size(); ++j) {
-            x = pow(pclKinect_clr_ptr->points[j].x - pclSelected_ptr->points[i].x, 2);
-            y = pow(pclKinect_clr_ptr->points[j].y - pclSelected_ptr->points[i].y, 2);
-            z = pow(pclKinect_clr_ptr->points[j].z - pclSelected_ptr->points[i].z, 2);
-            if (sqrt(x + y +z ) < DISTANCE_TOLERANCE) {
-                pclEditing_ptr->points.push_back(pclKinect_clr_ptr->points[j]);
-                break;
-            }
-        }
-    }
-    ROS_INFO("snapshot with points %d; saving to file %s", (int)pclEditing_ptr->points.size(), argv[1]);
-    pcl::io::savePCDFile(argv[1], *pclEditing_ptr, true);
+    add_selected_points();
+    update_editing_cloud(argv[1]);
     display_kinect = false;
     ros::spinOnce();
 
@@ -82,36 +124,8 @@ int main(int argc, char** argv) {
             }
             utils.reset_got_selected_points();
             utils.get_selected_points(pclSelected_ptr);
-            temp_ptr->points.clear();
-            for (int i = 0; i < pclSelected_ptr->points.size(); ++i) {
-                for (int j = 0; j < pclKinect_clr_ptr->points.size(); ++j) {
-                    x = pow(pclKinect_clr_ptr->points[j].x - pclSelected_ptr->points[i].x, 2);
-                    y = pow(pclKinect_clr_ptr->points[j].y - pclSelected_ptr->points[i].y, 2);
-                    z = pow(pclKinect_clr_ptr->points[j].z - pclSelected_ptr->points[i].z, 2);
-                    if (x + y +z < DISTANCE_TOLERANCE) {
-                        temp_ptr->points.push_back(pclKinect_clr_ptr->points[j]);
-                        break;
-                    }
-                }
-            }
-            bool in_cloud = false;
-            for (int i = 0; i < temp_ptr->points.size(); ++i) {
-                for (int j = 0; j < pclEditing_ptr->points.size(); ++j) {
-                    x = pow(pclEditing_ptr->points[j].x - temp_ptr->points[i].x, 2);
-                    y = pow(pclEditing_ptr->points[j].y - temp_ptr->points[i].y, 2);
-                    z = pow(pclEditing_ptr->points[j].z - temp_ptr->points[i].z, 2);
-                    if (x + y +z < DISTANCE_TOLERANCE) {
-                        in_cloud = true;
-                        break;
-                    }
-                }
-                if (!in_cloud) {
-                    pclEditing_ptr->points.push_back(temp_ptr->points[i]);
-                }
-                in_cloud = false;
-            }
-            ROS_INFO("snapshot with points %d; saving to file %s", (int)pclEditing_ptr->points.size(), argv[1]);
-            pcl::io::savePCDFile(argv[1], *pclEditing_ptr, true);
+            add_selected_points();
+            update_editing_cloud(argv[1]);
         } else if (input.compare("-") == 0) {
         	ROS_INFO("Please select point cloud in \'/editing_cloud\' topic using \'Publish Selected points\'");
             while (!utils.got_selected_points()) {
@@ -120,26 +134,8 @@ int main(int argc, char** argv) {
             }
             utils.reset_got_selected_points();
             utils.get_selected_points(pclSelected_ptr);
-            bool in_cloud = false;
-            temp_ptr->points.clear();
-            for (int i = 0; i < pclEditing_ptr->points.size(); ++i) {
-                for (int j = 0; j < pclSelected_ptr->points.size(); ++j) {
-                    x = pow(pclEditing_ptr->points[i].x - pclSelected_ptr->points[j].x, 2);
-                    y = pow(pclEditing_ptr->points[i].y - pclSelected_ptr->points[j].y, 2);
-                    z = pow(pclEditing_ptr->points[i].z - pclSelected_ptr->points[j].z, 2);
-                    if (x + y + z < DISTANCE_TOLERANCE) {
-                        in_cloud = true;
-                        break;
-                    }
-                }
-                if (!in_cloud) {
-                    temp_ptr->points.push_back(pclEditing_ptr->points[i]);
-                }
-                in_cloud = false;
-            }
-            pcl::copyPointCloud(*temp_ptr, *pclEditing_ptr);
-            ROS_INFO("snapshot with points %d; saving to file %s", (int)pclEditing_ptr->points.size(), argv[1]);
-            pcl::io::savePCDFile(argv[1], *pclEditing_ptr, true);
+            delete_selected_points();
+            update_editing_cloud(argv[1]);
         } else if (input.compare("r") == 0 || input.compare("R") == 0) {
             ROS_INFO("waiting for kinect data...");
             
@@ -149,6 +145,7 @@ int main(int argc, char** argv) {
                 ros::Duration(0.1).sleep();
             }
             utils.get_kinect_points(pclKinect_clr_ptr);
+            index_snapshot();
             display_kinect = true;
             ros::spinOnce();
 
@@ -160,20 +157,8 @@ int main(int argc, char** argv) {
             }
             utils.reset_got_selected_points();
             utils.get_selected_points(pclSelected_ptr);
-            pclEditing_ptr->points.clear();
-            for (int i = 0; i < pclSelected_ptr->points.size(); ++i) {
-                for (int j = 0; j < pclKinect_clr_ptr->points.size(); ++j) {
-                    x = pow(pclKinect_clr_ptr->points[j].x - pclSelected_ptr->points[i].x, 2);
-                    y = pow(pclKinect_clr_ptr->points[j].y - pclSelected_ptr->points[i].y, 2);
-                    z = pow(pclKinect_clr_ptr->points[j].z - pclSelected_ptr->points[i].z, 2);
-                    if (sqrt(x + y +z ) < DISTANCE_TOLERANCE) {
-                        pclEditing_ptr->points.push_back(pclKinect_clr_ptr->points[j]);
-                        break;
-                    }
-                }
-            }
-            ROS_INFO("snapshot with points %d; saving to file %s", (int)pclEditing_ptr->points.size(), argv[1]);
-            pcl::io::savePCDFile(argv[1], *pclEditing_ptr, true);
+            add_selected_points();
+            update_editing_cloud(argv[1]);
             display_kinect = false;
             ros::spinOnce();
         } else if (input.compare("q") == 0 || input.compare("Q") == 0) {